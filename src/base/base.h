@@ -15,3 +15,4 @@ static constexpr size_t kInfSize = std::numeric_limits<size_t>::max();
 #include "type.h"
 #include "data_structures.h"
 #include "geometry2d.h"
+#include "parallel.h"
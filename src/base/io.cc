@@ -0,0 +1,37 @@
+#include "io.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace agl {
+bool is_regular_file(const char *filename) {
+  struct stat st;
+  return stat(filename, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+mapped_file::mapped_file(const char *filename) : data_(nullptr), size_(0) {
+  const int fd = open(filename, O_RDONLY);
+  CHECK_PERROR(fd != -1);
+  struct stat st;
+  CHECK_PERROR(fstat(fd, &st) == 0);
+  // パイプ等は st_size が 0 なので、そのままでは空のファイルとして読んでしまう
+  CHECK_MSG(S_ISREG(st.st_mode), "mapped_file needs a regular file");
+  size_ = std::size_t(st.st_size);
+  // 長さ 0 は mmap できない
+  if (size_ > 0) {
+    void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK_PERROR(addr != MAP_FAILED);
+    data_ = static_cast<const char*>(addr);
+  }
+  close(fd);
+}
+
+void mapped_file::advise_sequential() const {
+  if (data_ != nullptr) madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+}
+
+mapped_file::~mapped_file() {
+  if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+}
+}  // namespace agl
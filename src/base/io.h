@@ -53,4 +53,25 @@ template<typename T>
 void write_binary(std::ostream &os, const T &t) {
   CHECK_PERROR(os.write((char*)&t, sizeof(T)));
 }
+
+// 通常のファイルなら true. パイプや FIFO は mmap できない
+bool is_regular_file(const char *filename);
+
+// 通常のファイル全体を読み取り専用で mmap する
+class mapped_file {
+ public:
+  explicit mapped_file(const char *filename);
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+  ~mapped_file();
+
+  const char *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  // 先頭から順に読むことを OS に伝える
+  void advise_sequential() const;
+
+ private:
+  const char *data_;
+  std::size_t size_;
+};
 }  // namespace agl
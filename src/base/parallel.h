@@ -0,0 +1,33 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace agl {
+// 0 以下なら hardware_concurrency を使う
+inline int resolve_num_threads(int num_threads) {
+  if (num_threads > 0) return num_threads;
+  return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+// [0, n) の各 i について f(i, thread_id) を呼ぶ
+// i は num_threads 本のスレッドに先着順で割り振られる (thread_id は [0, num_threads) )
+template<typename F>
+void parallel_for(int n, int num_threads, F f) {
+  num_threads = std::max(1, std::min(num_threads, n));
+  if (num_threads == 1) {
+    for (int i = 0; i < n; i++) f(i, 0);
+    return;
+  }
+
+  std::atomic<int> next(0);
+  std::vector<std::thread> threads;
+  for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+    threads.emplace_back([&next, &f, n, thread_id]() {
+      for (int i = next++; i < n; i = next++) f(i, thread_id);
+    });
+  }
+  for (auto& th : threads) th.join();
+}
+}  // namespace agl
@@ -2,20 +2,24 @@
 #include <queue>
 
 DEFINE_int32(cut_tree_goal_oriented_dfs_aster_ub, 2, "bi_dinitz's goal oriented search relaxation");
+DEFINE_bool(cut_tree_warm_start, false, "bi_dinitz keeps the flow while consecutive max flows share the sink");
+DEFINE_int32(cut_tree_warm_start_budget, 64, "bi_dinitz gives up the kept flow when a max flow from s scans more than this times deg(s) arcs");
+DEFINE_string(cut_tree_residual_graph_layout, "aos", "bi_dinitz's residual graph layout: aos (array of structures), soa (structure of arrays)");
 
 using namespace std;
 
 namespace agl {
 
-bool bi_dinitz::bi_dfs(int s, int t) {
+template<class residual_graph_t>
+bool basic_bi_dinitz<residual_graph_t>::bi_dfs(int s, int t) {
   queue<int> qs, qt;
   qs.push(s); qt.push(t);
   level_[s].first = level_[t].second = 0;
   bfs_revision_[s] = s_side_bfs_revision_;
   bfs_revision_[t] = t_side_bfs_revision_;
 
-  size_t qs_next_get_cap = e_[s].size();
-  size_t qt_next_get_cap = e_[t].size();
+  size_t qs_next_get_cap = degree(s);
+  size_t qt_next_get_cap = degree(t);
   int slevel_ = 0, tlevel_ = 0;
   while (qs.size() != 0 && qt.size() != 0) {
     bool path_found = false;
@@ -23,17 +27,19 @@ bool bi_dinitz::bi_dfs(int s, int t) {
       int size = int(qs.size());
       for (int _ = 0; _ < size; _++) {
         const int v = qs.front(); qs.pop();
-        qs_next_get_cap -= e_[v].size();
-        for (auto& t : e_[v]) {
-          if (t.cap(graph_revision_) == 0 || bfs_revision_[t.to_] == s_side_bfs_revision_) continue;
-          if (bfs_revision_[t.to_] == t_side_bfs_revision_) {
+        qs_next_get_cap -= degree(v);
+        arcs_.scan(v);
+        for (auto a : arcs_.arcs(v)) {
+          const int w = arcs_.to(a);
+          if (arcs_.cap(a) == 0 || bfs_revision_[w] == s_side_bfs_revision_) continue;
+          if (bfs_revision_[w] == t_side_bfs_revision_) {
             path_found = true;
             continue;
           }
-          bfs_revision_[t.to_] = s_side_bfs_revision_;
-          level_[t.to_].first = slevel_ + 1;
-          qs_next_get_cap += e_[t.to_].size();
-          qs.push(t.to_);
+          bfs_revision_[w] = s_side_bfs_revision_;
+          level_[w].first = slevel_ + 1;
+          qs_next_get_cap += degree(w);
+          qs.push(w);
         }
       }
       slevel_++;
@@ -41,17 +47,19 @@ bool bi_dinitz::bi_dfs(int s, int t) {
       int size = int(qt.size());
       for (int _ = 0; _ < size; _++) {
         const int v = qt.front(); qt.pop();
-        qt_next_get_cap -= e_[v].size();
-        for (auto& t : e_[v]) {
-          if (e_[t.to_][t.rev_].cap(graph_revision_) == 0 || bfs_revision_[t.to_] == t_side_bfs_revision_) continue;
-          if (bfs_revision_[t.to_] == s_side_bfs_revision_) {
+        qt_next_get_cap -= degree(v);
+        arcs_.scan(v);
+        for (auto a : arcs_.arcs(v)) {
+          const int w = arcs_.to(a);
+          if (arcs_.rev_cap(a) == 0 || bfs_revision_[w] == t_side_bfs_revision_) continue;
+          if (bfs_revision_[w] == s_side_bfs_revision_) {
             path_found = true;
             continue;
           }
-          bfs_revision_[t.to_] = t_side_bfs_revision_;
-          level_[t.to_].second = tlevel_ + 1;
-          qt_next_get_cap += e_[t.to_].size();
-          qt.push(t.to_);
+          bfs_revision_[w] = t_side_bfs_revision_;
+          level_[w].second = tlevel_ + 1;
+          qt_next_get_cap += degree(w);
+          qt.push(w);
         }
       }
       tlevel_++;
@@ -64,180 +72,449 @@ bool bi_dinitz::bi_dfs(int s, int t) {
   return false;
 }
 
-int bi_dinitz::dfs(int v, int t, bool use_slevel, int f) {
-  // cut_tree_goal_oriented_dfs_aster_ub >= 3 を設定すると、dfs中に同じ辺を使ってしまい、辺のコストが破綻して f < 0 となることがある
-  CHECK(f >= 0);
+// 路の辺の根元の頂点は辿る時に scan 済
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::augment_dfs_path(cap_t limit) {
+  cap_t f = limit;
+  size_t saturated = dfs_path_.size();
+  for (size_t i = 0; i < dfs_path_.size(); i++) {
+    const cap_t c = arcs_.cap(dfs_path_[i]);
+    if (c < f) f = c, saturated = i;
+  }
+  // cut_tree_goal_oriented_dfs_aster_ub >= 3 を設定すると、路が同じ辺を2度使ってしまい、辺のコストが破綻して f < 0 となることがある
+  CHECK(f > cap_t());
+  for (auto a : dfs_path_) arcs_.push(a, f);
+  dfs_path_.resize(saturated);
+  dfs_state_.resize(saturated);
+  return f;
+}
 
-  if (v == t) return f;
+// 再帰の代わりに辿っている路をスタックで持つ
+// t に着いたら路に流し、最初に飽和した辺の根元から探索を続ける (s からやり直さない)
+// 行き止まりの頂点からは1つ戻り、戻った先の iter_ を進める
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::dfs(int s, int t) {
+  cap_t flow = 0;
+  dfs_path_.clear();
+  dfs_state_.clear();
+  bool use_slevel = true;
+  int v = s;
   if (dfs_revision_[v] != bfs_revision_[v]) {
     dfs_revision_[v] = bfs_revision_[v];
     iter_[v] = 0;
   }
-  for (int &i = iter_[v]; i < int(e_[v].size()); i++) {
-    E& _e = e_[v][i];
-    const int cap = _e.cap(graph_revision_);
-    if (cap == 0 || bfs_revision_[_e.to_] / 2 != s_side_bfs_revision_ / 2) continue;
-
-    bool rec;
-    if (use_slevel) rec = bfs_revision_[_e.to_] == t_side_bfs_revision_ || level_[v].first < level_[_e.to_].first;
-    else rec = bfs_revision_[_e.to_] == t_side_bfs_revision_ && level_[v].second > level_[_e.to_].second;
-    if (!rec) continue;
-
-    bool next_slevel_ = use_slevel && bfs_revision_[_e.to_] == s_side_bfs_revision_;
-    int d = dfs(_e.to_, t, next_slevel_, min(f, cap));
-    if (d > 0) {
-      _e.add_cap(-d, graph_revision_);
-      e_[_e.to_][_e.rev_].add_cap(d, graph_revision_);
-      return d;
+  while (true) {
+    if (v == t) {
+      flow += augment_dfs_path(numeric_limits<cap_t>::max());
+      v = dfs_vertex(dfs_path_.size(), s);
+      use_slevel = dfs_path_.empty() || (dfs_state_.back() && bfs_revision_[v] == s_side_bfs_revision_);
+      continue;
+    }
+
+    // v から level_ に沿って進める辺を探す
+    arcs_.scan(v);
+    bool advanced = false;
+    for (int &i = iter_[v]; i < degree(v); i++) {
+      const auto _e = arcs_.arc(v, i);
+      const int to = arcs_.to(_e);
+      if (arcs_.cap(_e) == 0 || bfs_revision_[to] / 2 != s_side_bfs_revision_ / 2) continue;
+
+      bool rec;
+      if (use_slevel) rec = bfs_revision_[to] == t_side_bfs_revision_ || level_[v].first < level_[to].first;
+      else rec = bfs_revision_[to] == t_side_bfs_revision_ && level_[v].second > level_[to].second;
+      if (!rec) continue;
+
+      dfs_path_.push_back(_e);
+      dfs_state_.push_back(use_slevel);
+      use_slevel = use_slevel && bfs_revision_[to] == s_side_bfs_revision_;
+      v = to;
+      if (dfs_revision_[v] != bfs_revision_[v]) {
+        dfs_revision_[v] = bfs_revision_[v];
+        iter_[v] = 0;
+      }
+      advanced = true;
+      break;
     }
+    if (advanced) continue;
+
+    // 行き止まり
+    if (dfs_path_.empty()) break;
+    v = dfs_vertex(dfs_path_.size() - 1, s);
+    use_slevel = dfs_state_.back();
+    dfs_path_.pop_back();
+    dfs_state_.pop_back();
+    iter_[v]++;
   }
-  return 0;
+  return flow;
 }
 
-void bi_dinitz::add_undirected_edge(int f, int t, int c) {
-  e_[f].push_back(E(t, int(e_[t].size()), c));
-  e_[t].push_back(E(f, int(e_[f].size()) - 1, c));
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::reset_revision() {
+  arcs_.reset();
+  reset_bfs_revision();
 }
 
-void bi_dinitz::reset_revision() {
-  for (int v = 0; v < n_; v++) for (auto& e : e_[v]) e.reset();
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::reset_bfs_revision() {
   memset(bfs_revision_.data(), 0, sizeof(bfs_revision_[0]) * bfs_revision_.size());
   memset(dfs_revision_.data(), 0, sizeof(dfs_revision_[0]) * dfs_revision_.size());
   s_side_bfs_revision_ = 2;
   t_side_bfs_revision_ = 3;
-  graph_revision_ = 0;
 }
 
-int bi_dinitz::goal_oriented_dfs_inner(int v, int flow, int astar_cost) {
-  if (v == goal_oriented_bfs_root_)
-    return flow;
-
+// dfs と同じく路をスタックで持つ. dfs_state_ には A* のコストを入れる
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::goal_oriented_dfs_inner(int start, cap_t flow) {
+  cap_t total = 0;
+  dfs_path_.clear();
+  dfs_state_.clear();
+  int v = start, astar_cost = 0;
   if (dfs_revision_[v] != s_side_bfs_revision_) {
     dfs_revision_[v] = s_side_bfs_revision_;
     iter_[v] = 0;
   }
-  for (int &i = iter_[v]; i < int(e_[v].size()); i++) {
-    E& to_edge = e_[v][i];
-    int to = to_edge.to_;
-    int add_aster_cost = goal_oriented_bfs_depth_[to] - goal_oriented_bfs_depth_[v] + 1;
-    if (add_aster_cost == 2) return 0; //コストの増える頂点は辿らない
-    int n_astar_cost = astar_cost + add_aster_cost;
-    if (n_astar_cost > FLAGS_cut_tree_goal_oriented_dfs_aster_ub) {
-      //sort済なので, これより後で自身の深さよりも浅い頂点は存在しない
-      return 0;
+  while (total < flow) {
+    if (v == goal_oriented_bfs_root_) {
+      total += augment_dfs_path(flow - total);
+      v = dfs_vertex(dfs_path_.size(), start);
+      astar_cost = dfs_state_.empty() ? 0 : dfs_state_.back() + goal_oriented_bfs_depth_[v] - goal_oriented_bfs_depth_[dfs_vertex(dfs_path_.size() - 1, start)] + 1;
+      continue;
     }
-    int cap = to_edge.cap(graph_revision_);
-    if (cap == 0) continue;
-    int d = goal_oriented_dfs_inner(to, min(flow, cap), n_astar_cost);
-    if (d > 0) {
-      to_edge.add_cap(-d, graph_revision_);
-      e_[to_edge.to_][to_edge.rev_].add_cap(d, graph_revision_);
-      return d;
+
+    arcs_.scan(v);
+    bool advanced = false;
+    for (int &i = iter_[v]; i < degree(v); i++) {
+      const auto to_edge = arcs_.arc(v, i);
+      int to = arcs_.to(to_edge);
+      int add_aster_cost = goal_oriented_bfs_depth_[to] - goal_oriented_bfs_depth_[v] + 1;
+      if (add_aster_cost == 2) break; //コストの増える頂点は辿らない
+      int n_astar_cost = astar_cost + add_aster_cost;
+      if (n_astar_cost > FLAGS_cut_tree_goal_oriented_dfs_aster_ub) {
+        //sort済なので, これより後で自身の深さよりも浅い頂点は存在しない
+        break;
+      }
+      if (arcs_.cap(to_edge) == 0) continue;
+
+      dfs_path_.push_back(to_edge);
+      dfs_state_.push_back(astar_cost);
+      astar_cost = n_astar_cost;
+      v = to;
+      if (dfs_revision_[v] != s_side_bfs_revision_) {
+        dfs_revision_[v] = s_side_bfs_revision_;
+        iter_[v] = 0;
+      }
+      advanced = true;
+      break;
     }
+    if (advanced) continue;
+
+    // 行き止まり
+    if (dfs_path_.empty()) break;
+    v = dfs_vertex(dfs_path_.size() - 1, start);
+    astar_cost = dfs_state_.back();
+    dfs_path_.pop_back();
+    dfs_state_.pop_back();
+    iter_[v]++;
   }
-
-  return 0;
+  return total;
 }
 
 //v -> goal_oriented_bfs_root_ にflowを出来る限り送る
-int bi_dinitz::goal_oriented_dfs(int v) {
-  int flow = 0;
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::goal_oriented_dfs(int v, cap_t upper_bound) {
+  cap_t flow = 0;
   s_side_bfs_revision_ += 2;
   t_side_bfs_revision_ += 2;
 
-  for (auto it = e_[v].begin(); it != e_[v].end(); ++it) {
-    auto& to_edge = *it;
-    while (to_edge.cap(graph_revision_) > 0) {
-      int add = goal_oriented_dfs_inner(to_edge.to_, to_edge.cap(graph_revision_), 0);
+  arcs_.scan(v);
+  for (auto to_edge : arcs_.arcs(v)) {
+    while (arcs_.cap(to_edge) > 0 && flow < upper_bound) {
+      cap_t add = goal_oriented_dfs_inner(arcs_.to(to_edge), min(arcs_.cap(to_edge), upper_bound - flow));
       if (add == 0) break;
       flow += add;
-      to_edge.add_cap(-add, graph_revision_);
-      e_[to_edge.to_][to_edge.rev_].add_cap(add, graph_revision_);
+      arcs_.push(to_edge, add);
     }
   }
   return flow;
 }
 
-void bi_dinitz::add_vertex() {
+template<class residual_graph_t>
+basic_bi_dinitz<residual_graph_t>::basic_bi_dinitz(const G& g) : n_(g.num_vertices()) {
+  std::vector<int> degree(n_);
+  for (int v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
+    degree[v]++;
+    degree[agl::to(e)]++;
+  }
+  init(degree);
+  for (int v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
+    arcs_.add_undirected_edge(v, agl::to(e));
+  }
+}
+
+template<class residual_graph_t>
+basic_bi_dinitz<residual_graph_t>::basic_bi_dinitz(const vector<pair<V, V>>& edges, int num_vs) : n_(num_vs) {
+  std::vector<int> degree(n_);
+  for (auto& uv : edges) degree[uv.first]++, degree[uv.second]++;
+  init(degree);
+  for (auto& uv : edges) {
+    arcs_.add_undirected_edge(uv.first, uv.second);
+  }
+}
+
+template<class residual_graph_t>
+basic_bi_dinitz<residual_graph_t>::basic_bi_dinitz(vector<pair<V, V>>&& edges, int num_vs) : n_(num_vs) {
+  std::vector<int> degree(n_);
+  for (auto& uv : edges) degree[uv.first]++, degree[uv.second]++;
+  init(degree);
+
+  //こまめに解放しながら辺を追加していく
+  while (edges.size() >= 1) {
+    std::size_t loop = std::max(edges.size() / 2, size_t(10000));
+    loop = std::min(loop, edges.size());
+    while (loop--) {
+      auto& uv = edges.back();
+      arcs_.add_undirected_edge(uv.first, uv.second);
+      edges.pop_back();
+    }
+    edges.shrink_to_fit();
+  }
+}
+
+template<class residual_graph_t>
+basic_bi_dinitz<residual_graph_t>::basic_bi_dinitz(vector<pair<V, weighted_edge<cap_t>>>&& edges, int num_vs) : n_(num_vs) {
+  std::vector<int> degree(n_);
+  for (auto& e : edges) degree[e.first]++, degree[agl::to(e.second)]++;
+  init(degree);
+
+  //こまめに解放しながら辺を追加していく
+  while (edges.size() >= 1) {
+    std::size_t loop = std::max(edges.size() / 2, size_t(10000));
+    loop = std::min(loop, edges.size());
+    while (loop--) {
+      auto& e = edges.back();
+      arcs_.add_undirected_edge(e.first, agl::to(e.second), agl::weight(e.second));
+      edges.pop_back();
+    }
+    edges.shrink_to_fit();
+  }
+}
+
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::init(const vector<int>& degree) {
+  level_.resize(n_);
+  iter_.resize(n_);
+  bfs_revision_.resize(n_);
+  dfs_revision_.resize(n_);
+  s_side_bfs_revision_ = 2;
+  t_side_bfs_revision_ = 3;
+  goal_oriented_bfs_root_ = -1;
+  warm_sink_ = -1;
+  warm_backoff_ = warm_skip_ = 0;
+  arcs_.init(degree);
+}
+
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::add_vertex(int num_reserved_edges) {
   level_.emplace_back();
   iter_.emplace_back();
   bfs_revision_.emplace_back();
   dfs_revision_.emplace_back();
-  e_.emplace_back();
+  discard_warm_state();
+  arcs_.add_vertex(num_reserved_edges);
+  // goal oriented search から見て、到達できない頂点として扱う
+  if (!goal_oriented_bfs_depth_.empty()) goal_oriented_bfs_depth_.push_back(n_);
   n_++;
 }
 
-void bi_dinitz::reconnect_edge(E& rm, int sside_vtx, int tside_vtx) {
-  const int to = rm.to_;
-  const int to_rev = rm.rev_;
-  E& rm_rev = e_[to][to_rev];
-  const int from = rm_rev.to_;
-  const int from_rev = rm_rev.rev_;
-
-  add_undirected_edge(sside_vtx, tside_vtx, 1);
-  E& se = e_[sside_vtx].back();
-  E& te = e_[tside_vtx].back();
-
-  rm.to_ = sside_vtx;
-  rm.rev_ = te.rev_;
-  rm_rev.to_ = tside_vtx;
-  rm_rev.rev_ = se.rev_;
-
-  se.to_ = from;
-  se.rev_ = from_rev;
-  te.to_ = to;
-  te.rev_ = to_rev;
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx) {
+  discard_warm_state();
+  arcs_.reconnect_edge(rm, sside_vtx, tside_vtx);
 }
 
-int bi_dinitz::max_flow_core(int s, int t) {
+namespace {
+// 頂点毎の配列 a を new_id に従って並べ直す. 対応する元の頂点の無い所は init
+template<class T>
+void compact_vertex_array(const vector<int>& new_id, int new_n, const T& init, vector<T>* a) {
+  vector<T> ret(new_n, init);
+  for (size_t v = 0; v < a->size(); v++) {
+    if (new_id[v] != -1) ret[new_id[v]] = (*a)[v];
+  }
+  a->swap(ret);
+}
+} // namespace
+
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::compact(const vector<int>& new_id, int new_n) {
+  CHECK(int(new_id.size()) == n_);
+  discard_warm_state();
+  compact_vertex_array(new_id, new_n, pair<int, int>(), &level_);
+  compact_vertex_array(new_id, new_n, 0, &iter_);
+  compact_vertex_array(new_id, new_n, 0, &bfs_revision_);
+  compact_vertex_array(new_id, new_n, 0, &dfs_revision_);
+  if (!goal_oriented_bfs_depth_.empty()) {
+    compact_vertex_array(new_id, new_n, new_n, &goal_oriented_bfs_depth_);
+  }
+  if (goal_oriented_bfs_root_ != -1) goal_oriented_bfs_root_ = new_id[goal_oriented_bfs_root_];
+  dfs_path_.clear();
+  dfs_state_.clear();
+  arcs_.compact(new_id, new_n);
+  n_ = new_n;
+}
+
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::max_flow_core(int s, int t, cap_t upper_bound) {
   assert(s != t);
+
+  // s, t の容量に達したら、それ以上流れないので最後の bfs を待たずに終える
+  // (cut は {s} か {t} 側から残余グラフを辿れば求まる)
+  const cap_t capacity_s = arcs_.capacity(s), capacity_t = arcs_.capacity(t);
+  auto finished = [&](cap_t f) {
+    if (!is_lt(f, capacity_s)) {
+      reason_for_finishing_bfs_ = kQsIsEmpty;
+    } else if (!is_lt(f, capacity_t)) {
+      reason_for_finishing_bfs_ = kQtIsEmpty;
+    } else if (f >= upper_bound) {
+      reason_for_finishing_bfs_ = kReachedUpperBound;
+    } else {
+      return false;
+    }
+    return true;
+  };
+
+  if (warm_sink_ == t) {
+    // warm_augment も revision を進めるので、溢れる前に戻しておく
+    if (s_side_bfs_revision_ >= numeric_limits<decltype(s_side_bfs_revision_)>::max() / 2) {
+      reset_bfs_revision();
+    }
+    // s が前の s なら、その湧き出しの続きから
+    cap_t flow = warm_excess(s);
+    bool gave_up = false;
+    int64_t budget = int64_t(FLAGS_cut_tree_warm_start_budget) * degree(s);
+    while (!finished(flow)) {
+      const cap_t f = warm_augment(s, min({capacity_s, capacity_t, upper_bound}) - flow, &budget, &gave_up);
+      if (gave_up) break;
+      if (f == 0) {
+        // s から辿れる頂点に湧き出し口は無いので、そこが cut の s 側
+        reason_for_finishing_bfs_ = kQsIsEmpty;
+        break;
+      }
+      flow += f;
+    }
+    if (!gave_up) {
+      warm_backoff_ = 0;
+      return flow;
+    }
+    // 遠くまで探さないと流せない時は、残した flow を捨ててはじめから流す
+    // 続けて諦めるなら、しばらく (諦める度に倍の回数) flow を残さない
+    warm_backoff_ = min(max(1, warm_backoff_ * 2), 1 << 10);
+    warm_skip_ = warm_backoff_;
+  }
+
+  discard_warm_state();
   reset_graph();
 
-  int flow = 0;
-  int preflow = 0;
+  cap_t flow = 0;
+  cap_t preflow = 0;
   if (goal_oriented_bfs_root_ == t) {
-    preflow = goal_oriented_dfs(s);
+    preflow = goal_oriented_dfs(s, upper_bound);
   }
 
-  if (preflow == int(e_[s].size())) {
-    reason_for_finishing_bfs_ = kQsIsEmpty;
-  } else {
+  const bool used_bi_dfs = !finished(preflow);
+  if (used_bi_dfs) {
     s_side_bfs_revision_ += 2;
     t_side_bfs_revision_ += 2;
 
-    int bfs_counter = 0;
     for (;; s_side_bfs_revision_ += 2, t_side_bfs_revision_ += 2) {
-      // fprintf(stderr, "bfs_start\n");
       bool path_found = bi_dfs(s, t);
-      bfs_counter++;
       if (!path_found) break;
-      while (true) {
-        int f = dfs(s, t, true, numeric_limits<int>::max());
-        if (f == 0) break;
-        flow += f;
-      }
+      flow += dfs(s, t);
+      if (finished(flow + preflow)) break;
     }
-    // fprintf(stderr, "bfs_counter : %d\n", bfs_counter);
   }
-  // fprintf(stderr, "(%d,%d) : preflow = %d, flow = %d\n", s, t, preflow, flow);
-  if (flow == 0 && preflow > 0) {
-    if (int(e_[s].size()) == preflow) {
-      // logging::preflow_eq_degree++;
+
+  // goal oriented search だけで流し切れるなら、そちらの方が速い
+  if (FLAGS_cut_tree_warm_start && used_bi_dfs) {
+    if (warm_skip_ > 0) {
+      warm_skip_--;
+    } else {
+      warm_sink_ = t;
+      add_warm_excess(s, flow + preflow);
     }
-    // logging::flow_eq_0++;
-  } else {
-    // fprintf(stderr, "// logging::getcap_counter : %lld\n", // logging::getcap_counter);
-    // fprintf(stderr, "// logging::addcap_counter : %lld\n", // logging::addcap_counter);
   }
   return flow + preflow;
 }
 
-int bi_dinitz::max_flow(int s, int t) {
-  int ans = max_flow_core(s, t);
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::add_warm_excess(int v, cap_t f) {
+  if (int(warm_excess_.size()) < n_) warm_excess_.resize(n_);
+  if (warm_excess_[v] == cap_t()) warm_sources_.push_back(v);
+  warm_excess_[v] += f;
+}
+
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::discard_warm_state() {
+  for (int v : warm_sources_) warm_excess_[v] = cap_t();
+  warm_sources_.clear();
+  warm_sink_ = -1;
+}
+
+// 近くの前の s に流せれば、毎回 t の周りまで探さずに済む
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::warm_augment(int s, cap_t limit, int64_t* budget, bool* gave_up) {
+  if (int(warm_parent_.size()) < n_) warm_parent_.resize(n_);
+  s_side_bfs_revision_ += 2;
+  t_side_bfs_revision_ += 2;
+  warm_queue_.clear();
+  warm_queue_.push_back(s);
+  bfs_revision_[s] = s_side_bfs_revision_;
+  int found = -1;
+  for (size_t i = 0; i < warm_queue_.size() && found == -1; i++) {
+    const int v = warm_queue_[i];
+    *budget -= degree(v);
+    if (*budget < 0) {
+      *gave_up = true;
+      return 0;
+    }
+    arcs_.scan(v);
+    for (auto a : arcs_.arcs(v)) {
+      const int w = arcs_.to(a);
+      if (arcs_.cap(a) == 0 || bfs_revision_[w] == s_side_bfs_revision_) continue;
+      bfs_revision_[w] = s_side_bfs_revision_;
+      warm_parent_[w] = a;
+      if (w == warm_sink_ || is_lt(cap_t(), warm_excess(w))) {
+        found = w;
+        break;
+      }
+      warm_queue_.push_back(w);
+    }
+  }
+  if (found == -1) return 0;
+
+  dfs_path_.clear();
+  for (int v = found; v != s; v = arcs_.from(warm_parent_[v])) dfs_path_.push_back(warm_parent_[v]);
+  reverse(dfs_path_.begin(), dfs_path_.end());
+  dfs_state_.assign(dfs_path_.size(), 0);
+  if (found != warm_sink_) limit = min(limit, warm_excess_[found]);
+  const cap_t f = augment_dfs_path(limit);
+  if (found != warm_sink_) warm_excess_[found] -= f;
+  add_warm_excess(s, f);
+  return f;
+}
+
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::max_flow(int s, int t) {
+  cap_t ans = max_flow_core(s, t, numeric_limits<cap_t>::max());
   return ans;
 }
 
-bool bi_dinitz::path_dont_exists_to_t(const int v) const {
+template<class residual_graph_t>
+typename basic_bi_dinitz<residual_graph_t>::cap_t basic_bi_dinitz<residual_graph_t>::max_flow(int s, int t, cap_t upper_bound) {
+  return max_flow_core(s, t, upper_bound);
+}
+
+template<class residual_graph_t>
+bool basic_bi_dinitz<residual_graph_t>::path_dont_exists_to_t(const int v) const {
   if (reason_for_finishing_bfs_ == kQsIsEmpty) {
     //sから到達可能な頂点のbfs_revision_には、必ずs_side_bfs_revision_が代入されている
     return bfs_revision_[v] == s_side_bfs_revision_;
@@ -247,7 +524,8 @@ bool bi_dinitz::path_dont_exists_to_t(const int v) const {
   }
 }
 
-bool bi_dinitz::path_dont_exists_from_s(const int v) const {
+template<class residual_graph_t>
+bool basic_bi_dinitz<residual_graph_t>::path_dont_exists_from_s(const int v) const {
   if (reason_for_finishing_bfs_ == kQsIsEmpty) {
     //sから到達不可能
     return bfs_revision_[v] != s_side_bfs_revision_;
@@ -258,15 +536,18 @@ bool bi_dinitz::path_dont_exists_from_s(const int v) const {
 }
 
 //フローを流す前に実行する
-void bi_dinitz::reset_graph() {
-  graph_revision_++;
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::reset_graph() {
+  arcs_.next_revision();
   if (s_side_bfs_revision_ >= numeric_limits<decltype(s_side_bfs_revision_)>::max() / 2) {
     reset_revision();
   }
 }
 
 //rootを起点にbfsをして、 s -> rootのflowを高速化する
-void bi_dinitz::goal_oriented_bfs_init(int root) {
+template<class residual_graph_t>
+void basic_bi_dinitz<residual_graph_t>::goal_oriented_bfs_init(int root) {
+  discard_warm_state();
   goal_oriented_bfs_root_ = root;
   goal_oriented_bfs_depth_.clear();
   goal_oriented_bfs_depth_.resize(n_, n_); // bfsの深さをn(=INF)で初期化
@@ -278,28 +559,27 @@ void bi_dinitz::goal_oriented_bfs_init(int root) {
   while (!q.empty()) {
     const int v = q.front(); q.pop();
     const int ndepth = goal_oriented_bfs_depth_[v] + 1;
-    for (auto& to_edge : e_[v]) {
-      if (goal_oriented_bfs_depth_[to_edge.to_] > ndepth) {
-        goal_oriented_bfs_depth_[to_edge.to_] = ndepth;
-        q.push(to_edge.to_);
+    for (auto to_edge : arcs_.arcs(v)) {
+      const int to = arcs_.to(to_edge);
+      if (goal_oriented_bfs_depth_[to] > ndepth) {
+        goal_oriented_bfs_depth_[to] = ndepth;
+        q.push(to);
       }
     }
   }
 
   //sort edges by depth order
+  // 辺は両向きにあるので隣接頂点の深さの差は -1, 0, 1 のどれかで、hub 毎に呼んでも O(n + m) で並べられる
+  const auto& dep = goal_oriented_bfs_depth_;
   for (int v = 0; v < n_; v++) {
-    auto& dep = goal_oriented_bfs_depth_;
-    sort(e_[v].begin(), e_[v].end(), [&dep](const E& l, const E& r) {
-      return dep[l.to_] < dep[r.to_];
-    });
-
-    //reset rev_ edge's "rev_" value
-    for (int i = 0; i < int(e_[v].size()); i++) {
-      const E& to_edge = e_[v][i];
-      E& rev = e_[to_edge.to_][to_edge.rev_];
-      rev.rev_ = i;
-    }
+    const int base = dep[v] - 1;
+    arcs_.partition_arcs(v, [&dep, base](int w) { return dep[w] - base; });
   }
 }
 
-} //namespace agl
\ No newline at end of file
+template class basic_bi_dinitz<aos_residual_graph>;
+template class basic_bi_dinitz<soa_residual_graph>;
+template class basic_bi_dinitz<weighted_residual_graph<int64_t>>;
+template class basic_bi_dinitz<weighted_residual_graph<double>>;
+
+} //namespace agl
@@ -1,110 +1,89 @@
 #pragma once
 #include <base/base.h>
 #include <graph/graph.h>
+#include <limits>
+#include <memory>
+#include "residual_graph.h"
 
 DECLARE_int32(cut_tree_goal_oriented_dfs_aster_ub);
+DECLARE_string(cut_tree_residual_graph_layout);
+DECLARE_bool(cut_tree_warm_start);
+DECLARE_int32(cut_tree_warm_start_budget);
 
 namespace agl {
 
-class bi_dinitz {
+// 両側から bfs をする dinitz
+// residual_graph_t は残余グラフの持ち方 (residual_graph.h)
+template<class residual_graph_t>
+class basic_bi_dinitz {
 public:
+  typedef typename residual_graph_t::arc_t arc_t;
+  typedef typename residual_graph_t::const_arc_t const_arc_t;
+  typedef typename residual_graph_t::cap_t cap_t;
+
   // two sided bfsが終了した理由
   enum reason_for_finishing_bfs_t {
     kQsIsEmpty,
     kQtIsEmpty,
-  };
-
-  class E {
-  public:
-    E(int to, int rev, int cap) :
-      revision_(0), to_(to), cap_(cap), rev_(rev) {
-      CHECK(init_cap_ == cap);
-    }
-
-    const int cap(int currenct_revision) {
-      if (revision_ != currenct_revision) {
-        revision_ = currenct_revision;
-        cap_ = init_cap_;
-      }
-      // logging::getcap_counter++;
-      return cap_;
-    }
-    void add_cap(int val, int currenct_revision) {
-      if (revision_ != currenct_revision) {
-        revision_ = currenct_revision;
-        cap_ = init_cap_;
-      }
-      // logging::addcap_counter++;
-      cap_ += val;
-    }
-
-    void reset() {
-      revision_ = 0;
-      cap_ = init_cap_;
-    }
-
-  private:
-    static const int init_cap_ = 1;
-    int revision_;
-    int to_;
-    int cap_ : 3;
-    unsigned int rev_ : 29;
-
-    friend class bi_dinitz;
+    // upper_bound に達して打ち切った (残余グラフから cut は求まらない)
+    kReachedUpperBound,
   };
 
 private:
   bool bi_dfs(int s, int t);
-  int dfs(int v, int t, bool use_slevel_, int f);
-  void add_undirected_edge(int f, int t, int c);
+  // bi_dfs で作った level_ に沿って s -> t に流せるだけ流す (blocking flow)
+  cap_t dfs(int s, int t);
   void reset_revision();
-  int goal_oriented_dfs_inner(int v, int flow, int astar_cost);
-
-  //v -> goal_oriented_bfs_root_ にflowを出来る限り送る
-  int goal_oriented_dfs(int v);
+  // bfs_revision_, dfs_revision_ だけを戻す. 残余グラフ (残した flow) はそのまま
+  void reset_bfs_revision();
+  // v -> goal_oriented_bfs_root_ に flow を上限として流せるだけ流す
+  cap_t goal_oriented_dfs_inner(int v, cap_t flow);
+  // 探索中の路の i 番目の辺の根元の頂点. i == dfs_path_.size() なら路の先頭
+  int dfs_vertex(std::size_t i, int start) const { return i == 0 ? start : arcs_.to(dfs_path_[i - 1]); }
+  // 路の辺に流せる量を流し、最初に飽和した辺の手前まで戻る
+  cap_t augment_dfs_path(cap_t limit);
+
+  //v -> goal_oriented_bfs_root_ にflowを出来る限り (upper_bound まで) 送る
+  cap_t goal_oriented_dfs(int v, cap_t upper_bound);
+
+  // 残した flow で v から湧き出している量
+  cap_t warm_excess(int v) const { return v < int(warm_excess_.size()) ? warm_excess_[v] : cap_t(); }
+  void add_warm_excess(int v, cap_t f);
+  // 残した flow を捨てる (残余グラフは次の reset_graph で戻る)
+  void discard_warm_state();
+  // s から bfs で、warm_sink_ か s 以外の湧き出し口への増加路を1本探して limit まで流す
+  // 見つからなければ 0 で、s から辿れる頂点に s_side_bfs_revision_ が入っている
+  // 辿った頂点の次数を *budget から引き、足りなくなったら *gave_up = true として諦める
+  cap_t warm_augment(int s, cap_t limit, int64_t* budget, bool* gave_up);
+
+  // 各頂点の次数から残余グラフの領域を確保する
+  void init(const std::vector<int>& degree);
+  int degree(int v) const { return arcs_.degree(v); }
 
 public:
-  bi_dinitz() : n_(0) {}
-  bi_dinitz(const G& g)
-    : n_(g.num_vertices()), level_(n_), iter_(n_), bfs_revision_(n_), dfs_revision_(n_), e_(n_),
-    s_side_bfs_revision_(2), t_side_bfs_revision_(3), graph_revision_(0), goal_oriented_bfs_root_(-1) {
-    for (int v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
-      add_undirected_edge(v, agl::to(e), 1);
-    }
-  }
-  bi_dinitz(const std::vector<std::pair<V, V>>& edges, int num_vs)
-    : n_(num_vs), level_(n_), iter_(n_), bfs_revision_(n_), dfs_revision_(n_), e_(n_),
-    s_side_bfs_revision_(2), t_side_bfs_revision_(3), graph_revision_(0), goal_oriented_bfs_root_(-1) {
-    for (auto& uv : edges) {
-      add_undirected_edge(uv.first, uv.second, 1);
-    }
-  }
-  bi_dinitz(std::vector<std::pair<V, V>>&& edges, int num_vs)
-    : n_(num_vs), level_(n_), iter_(n_), bfs_revision_(n_), dfs_revision_(n_), e_(n_),
-    s_side_bfs_revision_(2), t_side_bfs_revision_(3), graph_revision_(0), goal_oriented_bfs_root_(-1) {
-    edges.shrink_to_fit();
-
-    //こまめに解放しながら辺を追加していく
-    while (edges.size() >= 1) {
-      std::size_t loop = std::max(edges.size() / 2, size_t(10000));
-      loop = std::min(loop, edges.size());
-      while (loop--) {
-        auto& uv = edges.back();
-        add_undirected_edge(uv.first, uv.second, 1);
-        edges.pop_back();
-      }
-      edges.shrink_to_fit();
-    }
-
-    for (auto& e : e_) e.shrink_to_fit();
-  }
-
-  void add_vertex();
-  void reconnect_edge(E& rm, int sside_vtx, int tside_vtx);
-
-  int max_flow_core(int s, int t);
-  int max_flow(int s, int t);
-
+  basic_bi_dinitz() : n_(0), warm_sink_(-1), warm_backoff_(0), warm_skip_(0) {}
+  basic_bi_dinitz(const G& g);
+  basic_bi_dinitz(const std::vector<std::pair<V, V>>& edges, int num_vs);
+  basic_bi_dinitz(std::vector<std::pair<V, V>>&& edges, int num_vs);
+  // 辺 (u, e) を容量 weight(e) の無向辺として張る
+  basic_bi_dinitz(std::vector<std::pair<V, weighted_edge<cap_t>>>&& edges, int num_vs);
+
+  // 辺を num_reserved_edges 本まで追加できる頂点を追加する
+  void add_vertex(int num_reserved_edges);
+  void reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx);
+  // 頂点 v を new_id[v] に付け替えて頂点数を new_n にする. new_id[v] == -1 の頂点は辺ごと取り除く
+  // 辺のハンドルは無効になる
+  void compact(const std::vector<int>& new_id, int new_n);
+
+  // cut_tree_warm_start なら、直前と同じ t に流す時は前の flow を残したまま続きから流す
+  // 流量が s か t の容量 (次数) に達するか、upper_bound 以上流れた所で打ち切る
+  // reason_for_finishing_bfs() が kQsIsEmpty なら s 側、kQtIsEmpty なら t 側から残余グラフを辿ると cut が求まる
+  // kReachedUpperBound なら cut は求まらない
+  cap_t max_flow_core(int s, int t, cap_t upper_bound);
+  cap_t max_flow(int s, int t);
+  cap_t max_flow(int s, int t, cap_t upper_bound);
+
+  // 最後の bfs で決まるので、容量に達して打ち切った時は使えない
   bool path_dont_exists_to_t(const int v) const;
   bool path_dont_exists_from_s(const int v) const;
 
@@ -116,23 +95,45 @@ public:
   int n() const { return n_; }
   reason_for_finishing_bfs_t reason_for_finishing_bfs() const { return reason_for_finishing_bfs_; }
 
-  std::vector<E>& edges(V v) { return e_[v]; }
-  const std::vector<E>& edges(V v) const { return e_[v]; }
-  V to(const E& e) const { return e.to_; }
-  int cap(E& e) { return e.cap(graph_revision_); }
-  E& rev(const E& e_in) { return e_[e_in.to_][e_in.rev_]; }
+  // 辺は値で扱う (for (auto e : edges(v)) ...)
+  arc_range<arc_t> edges(V v) { return arcs_.arcs(v); }
+  arc_range<const_arc_t> edges(V v) const { return arcs_.arcs(v); }
+  V to(const_arc_t e) const { return arcs_.to(e); }
+  cap_t cap(arc_t e) {
+    arcs_.scan(arcs_.from(e));
+    return arcs_.cap(e);
+  }
+  arc_t rev(const_arc_t e) { return arcs_.rev(e); }
 
 private:
   int n_;
   std::vector<std::pair<int, int>> level_;
   std::vector<int> iter_;
+  // dfs の明示的なスタック. dfs_path_[i] は路の i 番目の辺、dfs_state_[i] はその辺の根元の頂点の状態
+  std::vector<arc_t> dfs_path_;
+  std::vector<int> dfs_state_;
   std::vector<int> bfs_revision_, dfs_revision_;
-  std::vector<std::vector<E>> e_;
+  residual_graph_t arcs_;
   int s_side_bfs_revision_, t_side_bfs_revision_;
-  int graph_revision_;
   reason_for_finishing_bfs_t reason_for_finishing_bfs_;
 
   int goal_oriented_bfs_root_;
   std::vector<int> goal_oriented_bfs_depth_;
+
+  // 同じ t に続けて流す間は flow を捨てずに残す
+  // 残した flow は、これまでの s たちを湧き出し口、warm_sink_ を吸い込み口とする flow になっている
+  // 新しい s からは t だけでなく前の s にも流してよい (その分、前の s の湧き出しを打ち消す)
+  // 前の s からの flow を s からの flow に付け替えるだけなので、flow を分解すれば s から t への flow が取り出せる
+  int warm_sink_;
+  std::vector<cap_t> warm_excess_;
+  std::vector<int> warm_sources_;
+  std::vector<arc_t> warm_parent_;
+  std::vector<int> warm_queue_;
+  // 諦めた後、flow を残さずに流す回数
+  int warm_backoff_, warm_skip_;
 };
-} //namespace agl
\ No newline at end of file
+
+typedef basic_bi_dinitz<aos_residual_graph> bi_dinitz;
+typedef basic_bi_dinitz<soa_residual_graph> soa_bi_dinitz;
+template<class cap_t> using weighted_bi_dinitz = basic_bi_dinitz<weighted_residual_graph<cap_t>>;
+} //namespace agl
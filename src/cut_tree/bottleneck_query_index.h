@@ -0,0 +1,117 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace agl {
+// 森の2頂点間のパス上の辺の重みの最小値を O(1) で答える
+//
+// 重みの大きい辺から順に、辺の両端を含む頂点の列同士を連結していく (Kruskal 再構成木の葉の順番) と、
+// u, v 間のパスの最小値は、列上で u と v の間にある継ぎ目の重みの最小値になる
+// 継ぎ目を kBlockSize 個ずつのブロックに分け、ブロックの最小値を sparse table に載せて区間最小値で答える
+// 別の木の頂点同士は 0 を返す
+template<class weight_t>
+class bottleneck_query_index {
+public:
+  static const int kBlockSize = 16;
+
+  bottleneck_query_index() {}
+
+  // parent_weight[v] = (v の親, 親への辺の重み). 根の親は -1
+  explicit bottleneck_query_index(const std::vector<std::pair<V, weight_t>>& parent_weight) {
+    const int n = int(parent_weight.size());
+    std::vector<V> tree_edges;
+    for (V v = 0; v < n; v++) {
+      if (parent_weight[v].first >= 0) tree_edges.push_back(v);
+    }
+    std::sort(tree_edges.begin(), tree_edges.end(), [&parent_weight](V l, V r) {
+      return parent_weight[l].second > parent_weight[r].second;
+    });
+
+    // 列は連結リストで持ち、union_find の根に先頭と末尾を置く
+    union_find uf(n);
+    std::vector<V> head(n), tail(n), next(n, -1);
+    std::vector<weight_t> gap(n, weight_t());
+    for (V v = 0; v < n; v++) head[v] = tail[v] = v;
+    for (V v : tree_edges) {
+      V a = uf.root(v), b = uf.root(parent_weight[v].first);
+      CHECK(a != b);
+      next[tail[a]] = head[b];
+      gap[tail[a]] = parent_weight[v].second;
+      V first = head[a], last = tail[b];
+      uf.unite(a, b);
+      head[uf.root(a)] = first;
+      tail[uf.root(a)] = last;
+    }
+    // 別の木の列は重み 0 の継ぎ目でつなぐ
+    V first = -1, last = -1;
+    for (V v = 0; v < n; v++) {
+      if (uf.root(v) != v) continue;
+      if (first == -1) first = head[v];
+      else next[last] = head[v];
+      last = tail[v];
+    }
+
+    position_.resize(n);
+    gaps_.reserve(n);
+    int pos = 0;
+    for (V v = first; v != -1; v = next[v]) {
+      position_[v] = pos++;
+      if (next[v] != -1) gaps_.push_back(gap[v]);
+    }
+    CHECK(pos == n);
+
+    std::vector<weight_t> block_min;
+    for (int i = 0; i < int(gaps_.size()); i += kBlockSize) {
+      const int j = std::min(int(gaps_.size()), i + kBlockSize);
+      block_min.push_back(*std::min_element(gaps_.begin() + i, gaps_.begin() + j));
+    }
+    const int num_blocks = int(block_min.size());
+    table_.emplace_back(std::move(block_min));
+    for (int k = 1; (1 << k) <= num_blocks; k++) {
+      const std::vector<weight_t>& prev = table_[k - 1];
+      std::vector<weight_t> cur(prev.size() - (1 << (k - 1)));
+      for (int i = 0; i < int(cur.size()); i++) cur[i] = std::min(prev[i], prev[i + (1 << (k - 1))]);
+      table_.emplace_back(std::move(cur));
+    }
+  }
+
+  weight_t query(V u, V v) const {
+    return query(position_.data(), gaps_.data(), table_, u, v);
+  }
+
+  // 配列を直接渡して答える. table[k] は table_[k] の先頭を指すもの
+  template<class table_t>
+  static weight_t query(const int* position, const weight_t* gaps, const table_t& table, V u, V v) {
+    CHECK(u != v);
+    int l = position[u], r = position[v];
+    if (l > r) std::swap(l, r);
+    // 継ぎ目 [l, r) の最小値
+    const int lb = l / kBlockSize, rb = (r - 1) / kBlockSize;
+    if (lb == rb) return *std::min_element(gaps + l, gaps + r);
+    weight_t ans = std::min(*std::min_element(gaps + l, gaps + (lb + 1) * kBlockSize),
+                            *std::min_element(gaps + rb * kBlockSize, gaps + r));
+    if (lb + 1 < rb) {
+      const int k = 31 - __builtin_clz(rb - lb - 1);
+      ans = std::min(ans, std::min(table[k][lb + 1], table[k][rb - (1 << k)]));
+    }
+    return ans;
+  }
+
+  int num_vertices() const { return int(position_.size()); }
+  const std::vector<int>& position() const { return position_; }
+  const std::vector<weight_t>& gaps() const { return gaps_; }
+  const std::vector<std::vector<weight_t>>& table() const { return table_; }
+
+private:
+  // 列上での頂点の位置
+  std::vector<int> position_;
+  // gaps_[i] = 列上の i 番目と i + 1 番目の頂点の間の継ぎ目の重み
+  std::vector<weight_t> gaps_;
+  // table_[k][i] = ブロック [i, i + 2^k) の継ぎ目の重みの最小値
+  std::vector<std::vector<weight_t>> table_;
+};
+} // namespace agl
@@ -0,0 +1,331 @@
+#include "boykov_kolmogorov.h"
+
+using namespace std;
+
+namespace agl {
+
+template<class residual_graph_t>
+basic_boykov_kolmogorov<residual_graph_t>::basic_boykov_kolmogorov(const G& g) : n_(g.num_vertices()) {
+  std::vector<int> degree(n_);
+  for (int v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
+    degree[v]++;
+    degree[agl::to(e)]++;
+  }
+  init(degree);
+  for (int v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
+    arcs_.add_undirected_edge(v, agl::to(e));
+  }
+}
+
+template<class residual_graph_t>
+basic_boykov_kolmogorov<residual_graph_t>::basic_boykov_kolmogorov(vector<pair<V, V>>&& edges, int num_vs) : n_(num_vs) {
+  std::vector<int> degree(n_);
+  for (auto& uv : edges) degree[uv.first]++, degree[uv.second]++;
+  init(degree);
+
+  //こまめに解放しながら辺を追加していく
+  while (edges.size() >= 1) {
+    std::size_t loop = std::max(edges.size() / 2, size_t(10000));
+    loop = std::min(loop, edges.size());
+    while (loop--) {
+      auto& uv = edges.back();
+      arcs_.add_undirected_edge(uv.first, uv.second);
+      edges.pop_back();
+    }
+    edges.shrink_to_fit();
+  }
+}
+
+template<class residual_graph_t>
+basic_boykov_kolmogorov<residual_graph_t>::basic_boykov_kolmogorov(vector<pair<V, weighted_edge<cap_t>>>&& edges, int num_vs) : n_(num_vs) {
+  std::vector<int> degree(n_);
+  for (auto& e : edges) degree[e.first]++, degree[agl::to(e.second)]++;
+  init(degree);
+
+  //こまめに解放しながら辺を追加していく
+  while (edges.size() >= 1) {
+    std::size_t loop = std::max(edges.size() / 2, size_t(10000));
+    loop = std::min(loop, edges.size());
+    while (loop--) {
+      auto& e = edges.back();
+      arcs_.add_undirected_edge(e.first, agl::to(e.second), agl::weight(e.second));
+      edges.pop_back();
+    }
+    edges.shrink_to_fit();
+  }
+}
+
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::init(const vector<int>& degree) {
+  s_ = t_ = -1;
+  reason_for_finishing_bfs_ = kQsIsEmpty;
+  label_.assign(n_, 0);
+  s_label_ = 2;
+  parent_.resize(n_);
+  dist_.assign(n_, 0);
+  ts_.assign(n_, 0);
+  time_ = 1;
+  for (int k : {kSTree, kTTree}) active_head_[k] = active_degree_[k] = 0;
+  active_label_.assign(n_, 0);
+  iter_.assign(n_, 0);
+  is_orphan_.assign(n_, 0);
+  arcs_.init(degree);
+}
+
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::add_vertex(int num_reserved_edges) {
+  label_.emplace_back();
+  parent_.emplace_back();
+  dist_.emplace_back();
+  ts_.emplace_back();
+  active_label_.emplace_back();
+  iter_.emplace_back();
+  is_orphan_.emplace_back();
+  arcs_.add_vertex(num_reserved_edges);
+  n_++;
+}
+
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx) {
+  arcs_.reconnect_edge(rm, sside_vtx, tside_vtx);
+}
+
+// 頂点毎の状態は max_flow の間しか使わないので、並べ直さずに作り直す
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::compact(const vector<int>& new_id, int new_n) {
+  CHECK(int(new_id.size()) == n_);
+  label_.assign(new_n, 0);
+  parent_.assign(new_n, arc_t());
+  dist_.assign(new_n, 0);
+  ts_.assign(new_n, 0);
+  active_label_.assign(new_n, 0);
+  iter_.assign(new_n, 0);
+  is_orphan_.assign(new_n, 0);
+  arcs_.compact(new_id, new_n);
+  n_ = new_n;
+}
+
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::join(int v, int tree, arc_t parent) {
+  const int p = arcs_.to(parent);
+  label_[v] = s_label_ + tree;
+  parent_[v] = parent;
+  dist_[v] = dist_[p] + 1;
+  ts_[v] = ts_[p];
+  arcs_.scan(v);
+  activate(v);
+}
+
+// 既にキューにあっても、辺は先頭から調べ直す
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::activate(int v) {
+  if (active_label_[v] != label_[v]) {
+    const int k = tree_of(v);
+    active_label_[v] = label_[v];
+    active_[k].push_back(v);
+    active_degree_[k] += degree(v);
+  }
+  iter_[v] = 0;
+}
+
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::make_orphan(int v) {
+  is_orphan_[v] = 1;
+  orphans_.push_back(v);
+}
+
+// 取り出した頂点は、辺を全て調べ終わるまでキューの先頭に残す
+// 木から外れた頂点や、外れた後にもう一方の木に入った頂点は読み飛ばす
+// キューが空になった木は、残余のある辺がその木の中か、飽和した辺しか出ていない (入っていない) ので、cut の片側になる
+template<class residual_graph_t>
+bool basic_boykov_kolmogorov<residual_graph_t>::grow(arc_t* meet) {
+  while (true) {
+    if (active_head_[kSTree] == active_[kSTree].size()) {
+      reason_for_finishing_bfs_ = kQsIsEmpty;
+      return false;
+    }
+    if (active_head_[kTTree] == active_[kTTree].size()) {
+      reason_for_finishing_bfs_ = kQtIsEmpty;
+      return false;
+    }
+    const int k = active_degree_[kSTree] <= active_degree_[kTTree] ? kSTree : kTTree;
+    const int v = active_[k][active_head_[k]];
+    if (active_label_[v] == s_label_ + k) {
+      if (label_[v] == s_label_ + k) {
+        arcs_.scan(v);
+        for (int &i = iter_[v]; i < degree(v); i++) {
+          const arc_t a = arcs_.arc(v, i);
+          if ((k == kSTree ? arcs_.cap(a) : arcs_.rev_cap(a)) == 0) continue;
+          const int w = arcs_.to(a);
+          if (is_free(w)) {
+            join(w, k, arcs_.rev(a));
+          } else if (tree_of(w) != k) {
+            *meet = k == kSTree ? a : arcs_.rev(a);
+            return true;
+          }
+        }
+      }
+      active_label_[v] = 0;
+    }
+    active_degree_[k] -= degree(v);
+    if (++active_head_[k] == active_[k].size()) {
+      active_[k].clear();
+      active_head_[k] = 0;
+    }
+  }
+}
+
+template<class residual_graph_t>
+typename basic_boykov_kolmogorov<residual_graph_t>::cap_t basic_boykov_kolmogorov<residual_graph_t>::augment(arc_t meet) {
+  cap_t f = arcs_.cap(meet);
+  for (int v = arcs_.from(meet); v != s_; v = arcs_.to(parent_[v])) f = min(f, arcs_.rev_cap(parent_[v]));
+  for (int v = arcs_.to(meet); v != t_; v = arcs_.to(parent_[v])) f = min(f, arcs_.cap(parent_[v]));
+  CHECK(f > cap_t());
+
+  arcs_.push(meet, f);
+  for (int v = arcs_.from(meet); v != s_; v = arcs_.to(parent_[v])) {
+    arcs_.push(arcs_.rev(parent_[v]), f);
+    if (arcs_.rev_cap(parent_[v]) == 0) make_orphan(v);
+  }
+  for (int v = arcs_.to(meet); v != t_; v = arcs_.to(parent_[v])) {
+    arcs_.push(parent_[v], f);
+    if (arcs_.cap(parent_[v]) == 0) make_orphan(v);
+  }
+  return f;
+}
+
+// 距離は根で 0. 辿った頂点には今の time_ で距離を書いておき、次に辿る時はそこで止める
+template<class residual_graph_t>
+int basic_boykov_kolmogorov<residual_graph_t>::distance_to_root(int v) {
+  int d = 0;
+  for (int u = v;; u = arcs_.to(parent_[u]), d++) {
+    if (is_orphan_[u]) return -1;
+    if (ts_[u] == time_) {
+      d += dist_[u];
+      break;
+    }
+    if (u == s_ || u == t_) {
+      ts_[u] = time_;
+      dist_[u] = 0;
+      break;
+    }
+  }
+  const int ret = d;
+  for (int u = v; ts_[u] != time_; u = arcs_.to(parent_[u]), d--) {
+    ts_[u] = time_;
+    dist_[u] = d;
+  }
+  return ret;
+}
+
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::adopt() {
+  time_++;
+  for (size_t i = 0; i < orphans_.size(); i++) {
+    const int v = orphans_[i];
+    const bool s_side = tree_of(v) == kSTree;
+
+    // 同じ木の中で、v に残余のある辺でつながり、根まで辿れる頂点のうち根に最も近いものを親にする
+    // 見つからなかった時のために、v を親とする頂点と、v に残余のある辺でつながる頂点も集めておく
+    int best = numeric_limits<int>::max();
+    adopt_neighbors_.clear();
+    for (auto a : arcs_.arcs(v)) {
+      const int w = arcs_.to(a);
+      if (label_[w] != label_[v]) continue;
+      const bool child = w != s_ && w != t_ && !is_orphan_[w] && arcs_.to(parent_[w]) == v;
+      const bool residual = (s_side ? arcs_.rev_cap(a) : arcs_.cap(a)) != 0;
+      if (child || residual) adopt_neighbors_.push_back({w, child, residual});
+      if (!residual) continue;
+      const int d = distance_to_root(w);
+      if (d < 0 || d >= best) continue;
+      best = d;
+      parent_[v] = a;
+    }
+    if (best != numeric_limits<int>::max()) {
+      is_orphan_[v] = 0;
+      ts_[v] = time_;
+      dist_[v] = best + 1;
+      continue;
+    }
+
+    // 親が見つからなければ木から外す. v を親とする頂点は orphan になり、
+    // v に残余のある辺でつながる頂点は、v をもう一度木に入れられるように active にする
+    for (auto& nb : adopt_neighbors_) {
+      if (nb.child && !is_orphan_[nb.v]) make_orphan(nb.v);  // 多重辺で同じ子が何度も出てくる
+      if (nb.residual) activate(nb.v);
+    }
+    is_orphan_[v] = 0;
+    label_[v] = 0;
+  }
+  orphans_.clear();
+}
+
+template<class residual_graph_t>
+typename basic_boykov_kolmogorov<residual_graph_t>::cap_t basic_boykov_kolmogorov<residual_graph_t>::max_flow(int s, int t) {
+  return max_flow(s, t, numeric_limits<cap_t>::max());
+}
+
+template<class residual_graph_t>
+typename basic_boykov_kolmogorov<residual_graph_t>::cap_t basic_boykov_kolmogorov<residual_graph_t>::max_flow(int s, int t, cap_t upper_bound) {
+  assert(s != t);
+  reset_graph();
+
+  // bi_dinitz と同じく、s, t の容量に達したらそれ以上流れないので打ち切る
+  const cap_t capacity_s = arcs_.capacity(s), capacity_t = arcs_.capacity(t);
+  auto finished = [&](cap_t f) {
+    if (!is_lt(f, capacity_s)) {
+      reason_for_finishing_bfs_ = kQsIsEmpty;
+    } else if (!is_lt(f, capacity_t)) {
+      reason_for_finishing_bfs_ = kQtIsEmpty;
+    } else if (f >= upper_bound) {
+      reason_for_finishing_bfs_ = kReachedUpperBound;
+    } else {
+      return false;
+    }
+    return true;
+  };
+
+  s_ = s;
+  t_ = t;
+  for (int k : {kSTree, kTTree}) {
+    const int r = k == kSTree ? s : t;
+    active_[k].clear();
+    active_head_[k] = active_degree_[k] = 0;
+    label_[r] = s_label_ + k;
+    dist_[r] = 0;
+    ts_[r] = time_;
+    arcs_.scan(r);
+    activate(r);
+  }
+
+  cap_t flow = 0;
+  while (!finished(flow)) {
+    arc_t meet = arc_t();
+    if (!grow(&meet)) break;
+    flow += augment(meet);
+    adopt();
+  }
+  return flow;
+}
+
+// 容量を戻し、木を全て消す
+template<class residual_graph_t>
+void basic_boykov_kolmogorov<residual_graph_t>::reset_graph() {
+  arcs_.next_revision();
+  s_label_ += 2;
+  if (s_label_ >= numeric_limits<int>::max() / 2 || time_ >= numeric_limits<int>::max() / 2) {
+    arcs_.reset();
+    fill(label_.begin(), label_.end(), 0);
+    fill(active_label_.begin(), active_label_.end(), 0);
+    fill(ts_.begin(), ts_.end(), 0);
+    s_label_ = 2;
+    time_ = 1;
+  }
+}
+
+template class basic_boykov_kolmogorov<aos_residual_graph>;
+template class basic_boykov_kolmogorov<soa_residual_graph>;
+template class basic_boykov_kolmogorov<weighted_residual_graph<int64_t>>;
+template class basic_boykov_kolmogorov<weighted_residual_graph<double>>;
+
+} //namespace agl
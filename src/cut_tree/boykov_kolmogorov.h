@@ -0,0 +1,124 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+#include <limits>
+#include "residual_graph.h"
+
+namespace agl {
+
+// Boykov-Kolmogorov の maxflow
+// s と t から探索木を育て、2つの木が出会ったら流す. 流した後に木を作り直さず、切れた所だけ付け替える
+// (Y. Boykov, V. Kolmogorov. An Experimental Comparison of Min-Cut/Max-Flow Algorithms for Energy Minimization in Vision. 2004)
+// 短い増加路が多い疎なグラフでは、流す度に両側から bfs し直す bi_dinitz より探索が少なく済む
+//
+// separator から見た interface は basic_bi_dinitz と同じ (cut_tree_with_2ecc.cc の separator を参照)
+// residual_graph_t は残余グラフの持ち方 (residual_graph.h)
+template<class residual_graph_t>
+class basic_boykov_kolmogorov {
+public:
+  typedef typename residual_graph_t::arc_t arc_t;
+  typedef typename residual_graph_t::const_arc_t const_arc_t;
+  typedef typename residual_graph_t::cap_t cap_t;
+
+  // maxflow が終了した理由
+  enum reason_for_finishing_bfs_t {
+    kQsIsEmpty,
+    kQtIsEmpty,
+    // upper_bound に達して打ち切った (残余グラフから cut は求まらない)
+    kReachedUpperBound,
+  };
+
+private:
+  // 木の番号. S 木は s_label_、T 木は s_label_ + 1 を label_ に持つ
+  enum { kSTree, kTTree };
+
+  int tree_of(int v) const { return label_[v] - s_label_; }
+  bool is_free(int v) const { return label_[v] < s_label_; }
+  // v を木 tree に parent (v -> 親 の辺) で加える
+  void join(int v, int tree, arc_t parent);
+  void activate(int v);
+  void make_orphan(int v);
+
+  // 木を育てて、S 木から T 木への残余のある辺を探す
+  // 見つからずにどちらかの木が育ち切ったら false で、reason_for_finishing_bfs_ にその側を入れる
+  bool grow(arc_t* meet);
+  // meet を通る s -> t の路に流す. 飽和した木の辺の子は orphan になる
+  cap_t augment(arc_t meet);
+  // orphan に同じ木の新しい親を探し、見つからなければ木から外す
+  void adopt();
+  // v から親を辿って根に着くまでの辺の数. 途中に orphan があれば -1
+  int distance_to_root(int v);
+
+  void init(const std::vector<int>& degree);
+  int degree(int v) const { return arcs_.degree(v); }
+
+public:
+  basic_boykov_kolmogorov() : n_(0) {}
+  basic_boykov_kolmogorov(const G& g);
+  basic_boykov_kolmogorov(std::vector<std::pair<V, V>>&& edges, int num_vs);
+  // 辺 (u, e) を容量 weight(e) の無向辺として張る
+  basic_boykov_kolmogorov(std::vector<std::pair<V, weighted_edge<cap_t>>>&& edges, int num_vs);
+
+  void add_vertex(int num_reserved_edges);
+  void reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx);
+  void compact(const std::vector<int>& new_id, int new_n);
+
+  // 流量が s か t の容量 (次数) に達するか、upper_bound 以上流れた所で打ち切る
+  // 流し切った時は、先に育ち切った木の側を reason_for_finishing_bfs() で返す
+  cap_t max_flow(int s, int t);
+  cap_t max_flow(int s, int t, cap_t upper_bound);
+
+  void reset_graph();
+
+  // 探索木は毎回 s, t から育てるので、goal oriented search の前処理はしない
+  void goal_oriented_bfs_init(int) {}
+
+  int n() const { return n_; }
+  reason_for_finishing_bfs_t reason_for_finishing_bfs() const { return reason_for_finishing_bfs_; }
+
+  arc_range<arc_t> edges(V v) { return arcs_.arcs(v); }
+  arc_range<const_arc_t> edges(V v) const { return arcs_.arcs(v); }
+  V to(const_arc_t e) const { return arcs_.to(e); }
+  cap_t cap(arc_t e) {
+    arcs_.scan(arcs_.from(e));
+    return arcs_.cap(e);
+  }
+  arc_t rev(const_arc_t e) { return arcs_.rev(e); }
+
+private:
+  int n_;
+  residual_graph_t arcs_;
+  int s_, t_;
+  reason_for_finishing_bfs_t reason_for_finishing_bfs_;
+
+  // label_[v] が s_label_ より小さければ、どちらの木にも属さない
+  // max_flow の度に2つ上げるので、木を消すのは O(1)
+  std::vector<int> label_;
+  int s_label_;
+  // parent_[v] は v から親への辺. S 木なら逆辺、T 木ならこの辺に残余があれば木の辺として生きている
+  std::vector<arc_t> parent_;
+  // 根からの距離 dist_ は、time_ の時点で確かめた (ts_[v] == time_) なら正しい
+  // orphan の親を選ぶ時に、根に近い方を選ぶのに使う
+  std::vector<int> dist_, ts_;
+  int time_;
+
+  // 木毎の active な頂点のキュー. bi_dinitz の bfs と同じく、入っている頂点の次数の和が小さい方の木を育てる
+  // active_label_[v] は v を入れた時の label_[v] で、取り出したら 0 にする. iter_[v] は v から次に調べる辺
+  std::vector<int> active_[2];
+  std::size_t active_head_[2];
+  std::size_t active_degree_[2];
+  std::vector<int> active_label_, iter_;
+  std::vector<int> orphans_;
+  std::vector<char> is_orphan_;
+  // adopt で集める、orphan の同じ木の隣接頂点
+  struct adopt_neighbor_t {
+    int v;
+    bool child, residual;
+  };
+  std::vector<adopt_neighbor_t> adopt_neighbors_;
+};
+
+typedef basic_boykov_kolmogorov<aos_residual_graph> boykov_kolmogorov;
+typedef basic_boykov_kolmogorov<soa_residual_graph> soa_boykov_kolmogorov;
+template<class cap_t> using weighted_boykov_kolmogorov = basic_boykov_kolmogorov<weighted_residual_graph<cap_t>>;
+} //namespace agl
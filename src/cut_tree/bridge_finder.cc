@@ -0,0 +1,164 @@
+#include "bridge_finder.h"
+#include <atomic>
+
+DEFINE_int32(cut_tree_find_bridges_threads, 1, "number of threads finding bridges (1 = iterative dfs, 0 = hardware concurrency)");
+
+using namespace std;
+
+namespace agl {
+namespace cut_tree_internal {
+
+vector<V> find_bridges_dfs(const G& g, const vector<V>& roots) {
+  const int n = g.num_vertices();
+  vector<V> ret(n, -1);
+  vector<int> lowlink(n, -1), order(n, -1);
+
+  // 再帰の代わりに (頂点, 親, 向き, 次に見る辺) を積む
+  struct frame {
+    V v, par;
+    int dir;
+    size_t idx;
+  };
+  vector<frame> stk;
+  int cur_ord = 0;
+  for (V root : roots) {
+    lowlink[root] = order[root] = cur_ord++;
+    stk.push_back(frame{root, -1, 0, 0});
+    while (!stk.empty()) {
+      frame& f = stk.back();
+      const V v = f.v;
+      bool descended = false;
+      for (; f.dir < 2; f.dir++, f.idx = 0) {
+        const auto& es = g.edges(v, D(f.dir));
+        while (f.idx < es.size()) {
+          const V w = to(es[f.idx++]);
+          if (w == f.par) continue;
+          if (order[w] == -1) {
+            lowlink[w] = order[w] = cur_ord++;
+            stk.push_back(frame{w, v, 0, 0}); // f はここで無効になる
+            descended = true;
+            break;
+          }
+          lowlink[v] = min(lowlink[v], lowlink[w]);
+        }
+        if (descended) break;
+      }
+      if (descended) continue;
+
+      // v の子孫を全て見終わった
+      const V par = f.par;
+      stk.pop_back();
+      if (par == -1) continue;
+      lowlink[par] = min(lowlink[par], lowlink[v]);
+      if (order[par] < lowlink[v]) ret[v] = par;
+    }
+  }
+  return ret;
+}
+
+vector<V> find_bridges_parallel(const G& g, const vector<V>& roots, const int num_threads) {
+  const int n = g.num_vertices();
+  const int kChunk = 1024; // 1タスクで処理する頂点数
+
+  // 全ての根から同時に、階層毎に並列で bfs をする
+  // parent は先に compare_exchange できたスレッドが決める
+  vector<atomic<V>> parent(n);
+  for (V v = 0; v < n; v++) parent[v].store(-1, memory_order_relaxed);
+  for (V root : roots) parent[root].store(root, memory_order_relaxed);
+
+  vector<V> order(roots); // bfs 順
+  size_t level_begin = 0;
+  vector<vector<V>> next(num_threads);
+  while (level_begin < order.size()) {
+    const size_t level_end = order.size();
+    const int num_chunks = int((level_end - level_begin + kChunk - 1) / kChunk);
+    parallel_for(num_chunks, num_threads, [&](int chunk, int thread_id) {
+      const size_t l = level_begin + size_t(chunk) * kChunk;
+      const size_t r = min(level_end, l + kChunk);
+      for (size_t i = l; i < r; i++) {
+        const V u = order[i];
+        for (int dir = 0; dir < 2; dir++) for (auto& e : g.edges(u, D(dir))) {
+          const V w = to(e);
+          V expected = -1;
+          if (parent[w].load(memory_order_relaxed) == -1 &&
+              parent[w].compare_exchange_strong(expected, u, memory_order_relaxed)) {
+            next[thread_id].push_back(w);
+          }
+        }
+      }
+    });
+    for (auto& vs : next) {
+      order.insert(order.end(), vs.begin(), vs.end());
+      vs.clear();
+    }
+    level_begin = level_end;
+  }
+  CHECK(int(order.size()) == n);
+
+  vector<V> par(n);
+  for (V v = 0; v < n; v++) {
+    par[v] = parent[v].load(memory_order_relaxed);
+    if (par[v] == v) par[v] = -1;
+  }
+  vector<atomic<V>>().swap(parent);
+
+  // 部分木の大きさと preorder 番号
+  // 子には親から近い順に、連続する番号の区間を割り当てる
+  vector<int> size(n, 1), pre(n), next_pre(n);
+  for (int i = n - 1; i >= 0; i--) {
+    const V v = order[i];
+    if (par[v] != -1) size[par[v]] += size[v];
+  }
+  int root_pre = 0;
+  for (V v : order) {
+    if (par[v] == -1) {
+      pre[v] = root_pre;
+      root_pre += size[v];
+    } else {
+      pre[v] = next_pre[par[v]];
+      next_pre[par[v]] += size[v];
+    }
+    next_pre[v] = pre[v] + 1;
+  }
+  vector<int>().swap(next_pre);
+
+  // 木以外の辺で直接行ける pre の範囲
+  vector<int> low(n), high(n);
+  const int num_chunks = (n + kChunk - 1) / kChunk;
+  parallel_for(num_chunks, num_threads, [&](int chunk, int) {
+    const V l = V(chunk) * kChunk;
+    const V r = min(n, l + kChunk);
+    for (V v = l; v < r; v++) {
+      int lo = pre[v], hi = pre[v];
+      for (int dir = 0; dir < 2; dir++) for (auto& e : g.edges(v, D(dir))) {
+        const V w = to(e);
+        if (par[v] == w || par[w] == v) continue; // 木の辺
+        lo = min(lo, pre[w]);
+        hi = max(hi, pre[w]);
+      }
+      low[v] = lo;
+      high[v] = hi;
+    }
+  });
+
+  // 部分木で集計する
+  vector<V> ret(n, -1);
+  for (int i = n - 1; i >= 0; i--) {
+    const V v = order[i];
+    const V p = par[v];
+    if (p == -1) continue;
+    if (low[v] >= pre[v] && high[v] < pre[v] + size[v]) ret[v] = p;
+    low[p] = min(low[p], low[v]);
+    high[p] = max(high[p], high[v]);
+  }
+  return ret;
+}
+
+vector<V> find_bridges(const G& g, const vector<V>& roots) {
+  const int num_threads = resolve_num_threads(FLAGS_cut_tree_find_bridges_threads);
+  if (num_threads == 1) return find_bridges_dfs(g, roots);
+  return find_bridges_parallel(g, roots, num_threads);
+}
+
+} // namespace cut_tree_internal
+} // namespace agl
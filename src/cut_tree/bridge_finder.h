@@ -0,0 +1,26 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+
+DECLARE_int32(cut_tree_find_bridges_threads);
+
+namespace agl {
+namespace cut_tree_internal {
+// 橋の検出
+// roots には各連結成分から1頂点ずつ渡す
+// 返り値 ret[v] は、全域森で v の親への辺が橋なら親の頂点、そうでなければ -1
+// 全域森の取り方は実装によって異なるが、橋の集合は同じになる (多重辺, 自己ループは無いものとする)
+
+// explicit stack の lowlink dfs
+std::vector<V> find_bridges_dfs(const G& g, const std::vector<V>& roots);
+
+// Tarjan-Vishkin 風の並列版
+// bfs 木の preorder 番号 pre, 部分木の大きさ size と、部分木から木以外の辺で行ける pre の最小値 low, 最大値 high を求めると
+// v の親への辺が橋 <=> low(v) >= pre(v) かつ high(v) < pre(v) + size(v)
+// 辺を舐める部分 (bfs, low/high の初期値) を並列化し、O(n) の集計は1スレッドで行う
+std::vector<V> find_bridges_parallel(const G& g, const std::vector<V>& roots, int num_threads);
+
+// -cut_tree_find_bridges_threads に従って上のどちらかを呼ぶ
+std::vector<V> find_bridges(const G& g, const std::vector<V>& roots);
+} // namespace cut_tree_internal
+} // namespace agl
@@ -0,0 +1,4 @@
+#include "connected_components_filter.h"
+
+DEFINE_int32(cut_tree_build_components_threads, 1, "number of threads building per-component handlers (0 = hardware concurrency)");
+DEFINE_int32(cut_tree_small_component_size, 0, "components with at most this many vertices (up to 64) are solved by bitset max flows without building a handler (0 = disabled)");
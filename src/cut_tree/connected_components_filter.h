@@ -1,16 +1,46 @@
 #pragma once
 #include <base/base.h>
 #include <graph/graph.h>
+#include <algorithm>
 #include <vector>
 #include <queue>
+#include <limits>
+#include "small_cut_tree.h"
+
+DECLARE_int32(cut_tree_build_components_threads);
+DECLARE_int32(cut_tree_small_component_size);
 
 namespace agl {
 namespace cut_tree_internal {
+// hint_parent を受け取れる handler には渡し、そうでなければ捨てる
+template<class handler_t, class edge_list_t>
+auto new_handler(edge_list_t&& edges, int num_vs, std::vector<V>&& hint_parent, int)
+  -> decltype(new handler_t(std::move(edges), num_vs, std::move(hint_parent))) {
+  return new handler_t(std::move(edges), num_vs, std::move(hint_parent));
+}
+template<class handler_t, class edge_list_t>
+handler_t* new_handler(edge_list_t&& edges, int num_vs, std::vector<V>&&, long) {
+  return new handler_t(std::move(edges), num_vs);
+}
+
+// enabled にした handler_t (容量1) では、小さい連結成分を handler を作らずに small_cut_tree_builder で解く
+// connectivity_bound() は handler と同じく答えを頭打ちにする値 (0 なら頭打ちにしない)
 template<class handler_t>
+struct small_cut_tree_traits {
+  static const bool enabled = false;
+  static int connectivity_bound() { return 0; }
+};
+
+// graph_t が重み付きの場合、handler_t には重み付きの辺のリストが渡される
+template<class handler_t, class graph_t = G>
 class connected_components_filter {
 public:
-  connected_components_filter(const G& g)
-    : n_(g.num_vertices()), uf_(n_), local_indices_(n_), handlers_indices_(n_), num_connected_components_(0) {
+  typedef typename graph_t::W W;
+
+  // hint_parent は前に作った Gomory-Hu 木の親 (根は -1, 空なら使わない)
+  // 連結成分毎に、木で一番近い同じ連結成分の祖先を親にして handler に渡す
+  connected_components_filter(const graph_t& g, const std::vector<V>& hint_parent = std::vector<V>())
+    : n_(g.num_vertices()), uf_(n_), local_indices_(n_), handlers_indices_(n_), num_connected_components_(0), num_small_components_(0) {
 
     for (int v = 0; v < n_; v++) for (auto e : g.edges(v)) {
       V u = to(e);
@@ -22,18 +52,46 @@ public:
       else handlers_indices_[v] = num_connected_components_++;
     }
 
-    std::vector<bool> used(n_);
+    std::vector<V> roots;
+    std::vector<int> num_vs;
     for (int v = 0; v < n_; v++) {
       if (uf_.root(v) != v) continue;
-      used[v] = true;
+      roots.push_back(v);
+      num_vs.push_back(local_indices_[v] + 1);
+      local_indices_[v] = 0;
+    }
 
-      const int num_vs = local_indices_[uf_.root(v)] + 1;
-      local_indices_[uf_.root(v)] = 0;
-      std::vector<std::pair<V, V>> edges;
+    const std::vector<V> hint = project_hint(hint_parent);
+
+    // 小さい連結成分の木は、先に場所を決めておいた small_parent_weight_ の区間に書く
+    const int small_size = small_cut_tree_traits<handler_t>::enabled ? std::min(FLAGS_cut_tree_small_component_size, int(small_cut_tree_builder::kMaxVertices)) : 0;
+    is_small_.assign(roots.size(), false);
+    small_offset_.assign(roots.size() + 1, 0);
+    for (int i = 0; i < int(roots.size()); i++) {
+      is_small_[i] = num_vs[i] <= small_size;
+      small_offset_[i + 1] = small_offset_[i] + (is_small_[i] ? num_vs[i] : 0);
+    }
+    small_parent_weight_.resize(small_offset_.back());
+
+    // 連結成分毎に辺を取り出して handler を作る
+    // 異なる連結成分は頂点を共有しないので、used を別スレッドから触っても衝突しない
+    std::vector<char> used(n_);
+    handlers_.resize(roots.size());
+    auto build_handler = [this, &g, &used, &roots, &num_vs, &hint](int i, small_cut_tree_builder* small) {
+      const V root = roots[i];
+      if (is_small_[i]) {
+        if (build_small(g, root, num_vs[i], small, &used[0], &small_parent_weight_[small_offset_[i]])) return;
+        is_small_[i] = false; // 多重辺があったので handler に任せる
+      }
+      used[root] = true;
+
+      typename graph_t::edge_list_type edges;
+      std::vector<V> local_hint(hint.empty() ? 0 : num_vs[i], -1);
       std::queue<int> q;
-      q.push(v);
+      q.push(root);
       while (!q.empty()) {
         V u = q.front(); q.pop();
+        if (!hint.empty() && hint[u] != -1) local_hint[local_indices_[u]] = local_indices_[hint[u]];
         for (int dir = 0; dir < 2; dir++) for (auto& e : g.edges(u, D(dir))) {
           V w = to(e);
           if (!used[w]) {
@@ -41,21 +99,46 @@ public:
             q.push(w);
           }
           if (dir == 0) {
-            edges.emplace_back(local_indices_[u], local_indices_[w]);
+            // 辺の重みはそのままに、行き先を local index に付け替える
+            edges.emplace_back(local_indices_[u], reverse_edge(local_indices_[w], e));
           }
         }
       }
 
       edges.shrink_to_fit();
-      handlers_.emplace_back(new handler_t(std::move(edges), num_vs));
+      handlers_[i].reset(new_handler<handler_t>(std::move(edges), num_vs[i], std::move(local_hint), 0));
+    };
+
+    const int num_threads = resolve_num_threads(FLAGS_cut_tree_build_components_threads);
+    std::vector<small_cut_tree_builder> small(num_threads);
+    if (num_threads == 1) {
+      for (int i = 0; i < int(roots.size()); i++) build_handler(i, &small[0]);
+    } else {
+      // 大きな連結成分は JLOG を残すためにこのスレッドで作り、残りを並列に作る
+      std::vector<int> small_components;
+      for (int i = 0; i < int(roots.size()); i++) {
+        if (num_vs[i] > 10000) build_handler(i, &small[0]);
+        else small_components.push_back(i);
+      }
+      // JLOG はスレッドセーフではないので、並列に作っている間は記録しない
+      JLOG_IGNORE {
+        parallel_for(int(small_components.size()), num_threads, [&build_handler, &small_components, &small](int i, int thread_id) {
+          build_handler(small_components[i], &small[thread_id]);
+        });
+      }
     }
+
+    num_small_components_ = int(std::count(is_small_.begin(), is_small_.end(), true));
+    if (n_ > 10000) JLOG_PUT("connected_components_filter.num_small_components", num_small_components_);
   }
 
-  int query(V u, V v) {
+  W query(V u, V v) {
     if (!uf_.is_same(u, v)) return 0;
     int lu = local_indices_[u], lv = local_indices_[v];
     CHECK(lu != lv);
-    auto& handler = handlers_[handlers_indices_[uf_.root(u)]];
+    const int i = handlers_indices_[uf_.root(u)];
+    if (is_small_[i]) return query_small(&small_parent_weight_[small_offset_[i]], lu, lv);
+    auto& handler = handlers_[i];
     return handler->query(lu, lv);
   }
 
@@ -73,37 +156,163 @@ public:
     return local_id2global_id;
   }
 
-  void print_gomory_hu_tree(std::ostream& os) {
+  // Gomory-Hu 木の辺 (u, v, 重み) を f に渡す. 異なる連結成分の間は重み 0 の辺でつなぐ
+  template<class func_t>
+  void for_each_gomory_hu_tree_edge(const func_t& f) {
     std::vector<int> roots;
     for(int v = 0; v < n_; v++) if (uf_.root(v) == v) roots.push_back(v);
-    for(int i = 0; i < int(roots.size()) - 1; i++) os << roots[0] << " " << roots[i + 1] << " 0\n";
+    for(int i = 0; i < int(roots.size()) - 1; i++) f(roots[0], roots[i + 1], W());
 
     std::vector<std::vector<int>> local_id2global_id = get_local_id2global_id();
 
     for(int i = 0; i < int(handlers().size()); i++) {
       const auto& l2g = local_id2global_id[i];
-      const auto& gusfield_core = handlers()[i];
-      for(int v = 0; v < int(gusfield_core->parent_weight().size()); v++) {
-        const auto& kv = gusfield_core->parent_weight()[v];
-        int u = kv.first;
-        if (u == -1) continue; // 親への辺が存在しない
-        int weight = kv.second;
-        os << l2g[v] << " " << l2g[u] << " " << weight << "\n";
-      }
+      for_each_local_tree_edge(i, [&f, &l2g](V v, V u, W weight) {
+        f(l2g[v], l2g[u], weight);
+      });
     }
   }
 
+  // 連結成分 i の Gomory-Hu 木の辺 (local の頂点, 親, 重み) を f に渡す
+  template<class func_t>
+  void for_each_local_tree_edge(int i, const func_t& f) const {
+    const std::pair<V, W>* parent_weight;
+    int num_vs;
+    if (is_small_[i]) {
+      parent_weight = &small_parent_weight_[small_offset_[i]];
+      num_vs = small_offset_[i + 1] - small_offset_[i];
+    } else {
+      parent_weight = handlers_[i]->parent_weight().data();
+      num_vs = int(handlers_[i]->parent_weight().size());
+    }
+    for (V v = 0; v < num_vs; v++) {
+      if (parent_weight[v].first == -1) continue; // 親への辺が存在しない
+      f(v, parent_weight[v].first, parent_weight[v].second);
+    }
+  }
+
+  void print_gomory_hu_tree(std::ostream& os) {
+    for_each_gomory_hu_tree_edge([&os](V u, V v, W weight) {
+      os << u << " " << v << " " << weight << "\n";
+    });
+  }
+
+  int num_vertices() const { return n_; }
   int num_connected_components() const { return num_connected_components_; }
+  int num_small_components() const { return num_small_components_; }
+  // small_cut_tree_builder で解いた連結成分の handler は nullptr
   const std::vector<std::unique_ptr<handler_t>>& handlers() const { return handlers_; }
   const std::vector<int>& local_indices() const { return local_indices_; }
   const int handlers_index(int v) { return handlers_indices_[uf_.root(v)]; }
 
 private:
+  // root の連結成分の辺を bitset に載せて木を parent_weight に書く. 多重辺があれば何もせず false を返す
+  bool build_small(const graph_t& g, const V root, const int num_vs, small_cut_tree_builder* small, char* used, std::pair<V, W>* parent_weight) {
+    small->reset(num_vs);
+    V queue[small_cut_tree_builder::kMaxVertices];
+    int tail = 0;
+    used[root] = true;
+    queue[tail++] = root;
+    bool simple = true;
+    for (int head = 0; head < tail; head++) {
+      const V u = queue[head];
+      for (auto& e : g.edges(u)) {
+        const V w = to(e);
+        if (!used[w]) {
+          used[w] = true;
+          queue[tail++] = w;
+        }
+        simple = simple && small->add_edge(local_indices_[u], local_indices_[w]);
+      }
+      for (auto& e : g.edges(u, kBwd)) {
+        const V w = to(e);
+        if (!used[w]) {
+          used[w] = true;
+          queue[tail++] = w;
+        }
+      }
+    }
+    if (!simple) {
+      for (int i = 0; i < tail; i++) used[queue[i]] = false;
+      return false;
+    }
+    const int bound = small_cut_tree_traits<handler_t>::connectivity_bound();
+    if (bound > 0) small->build(parent_weight, bound);
+    else small->build(parent_weight);
+    return true;
+  }
+
+  // 連結成分の大きさは高々64なので、u の祖先に印を付けてから v から登る
+  static W query_small(const std::pair<V, W>* parent_weight, V u, V v) {
+    uint64_t ancestors = 0;
+    W to_ancestor[small_cut_tree_builder::kMaxVertices];
+    W cost = std::numeric_limits<W>::max();
+    for (;;) {
+      ancestors |= uint64_t(1) << u;
+      to_ancestor[u] = cost;
+      if (parent_weight[u].first == -1) break;
+      cost = std::min(cost, parent_weight[u].second);
+      u = parent_weight[u].first;
+    }
+    cost = std::numeric_limits<W>::max();
+    while (!(ancestors >> v & 1)) {
+      cost = std::min(cost, parent_weight[v].second);
+      v = parent_weight[v].first;
+    }
+    return std::min(cost, to_ancestor[v]);
+  }
+
+  // hint_parent の森を辿り、各頂点の、同じ連結成分の一番近い祖先を求める
+  std::vector<V> project_hint(const std::vector<V>& hint_parent) {
+    if (hint_parent.empty()) return std::vector<V>();
+    CHECK(int(hint_parent.size()) == n_);
+    std::vector<int> offset(n_ + 1), children(n_);
+    for (V v = 0; v < n_; v++) if (hint_parent[v] != -1) offset[hint_parent[v] + 1]++;
+    for (V v = 0; v < n_; v++) offset[v + 1] += offset[v];
+    {
+      std::vector<int> pos(offset.begin(), offset.end() - 1);
+      for (V v = 0; v < n_; v++) if (hint_parent[v] != -1) children[pos[hint_parent[v]]++] = v;
+    }
+
+    // last[c] は dfs 中の今の頂点の祖先のうち、連結成分 c の一番深い頂点
+    std::vector<V> projected(n_, -1), last(num_connected_components_, -1), saved(n_);
+    std::vector<std::pair<V, int>> stack;
+    for (V r = 0; r < n_; r++) {
+      if (hint_parent[r] != -1) continue;
+      stack.emplace_back(r, offset[r]);
+      while (!stack.empty()) {
+        const V v = stack.back().first;
+        const int c = handlers_indices_[uf_.root(v)];
+        int& i = stack.back().second;
+        if (i == offset[v]) {
+          projected[v] = last[c];
+          saved[v] = last[c];
+          last[c] = v;
+        }
+        if (i < offset[v + 1]) {
+          const V w = children[i++];
+          stack.emplace_back(w, offset[w]);
+        } else {
+          last[c] = saved[v];
+          stack.pop_back();
+        }
+      }
+    }
+    return projected;
+  }
+
   const int n_;
   union_find uf_;
   std::vector<int> local_indices_, handlers_indices_;
   std::vector<std::unique_ptr<handler_t>> handlers_;
   int num_connected_components_;
+
+  // 小さい連結成分の Gomory-Hu 木 (local index の parent_weight) を1つの配列に並べたもの
+  // 連結成分 i の区間は [small_offset_[i], small_offset_[i + 1]). is_small_[i] でなければ使わない
+  std::vector<char> is_small_;
+  std::vector<int> small_offset_;
+  std::vector<std::pair<V, W>> small_parent_weight_;
+  int num_small_components_;
 };
 } // namespace cut_tree_internal
 } //namespace agl
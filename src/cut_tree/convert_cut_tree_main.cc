@@ -0,0 +1,24 @@
+#include <easy_cui.h>
+#include "cut_tree_query_handler.h"
+#include "cut_tree_binary.h"
+
+// テキスト形式の Gomory-Hu 木をバイナリ形式に変換する
+DEFINE_string(cut_tree_path, "", "input gomory_hu tree path (text)");
+DEFINE_string(cut_tree_output_path, "", "output gomory_hu tree path (binary)");
+DEFINE_bool(cut_tree_output_index, true, "write the query index");
+
+int main(int argc, char** argv) {
+  JLOG_INIT(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_cut_tree_output_path == "") FLAGS_cut_tree_output_path = FLAGS_cut_tree_path + ".bin";
+
+  cut_tree_query_handler tq;
+  JLOG_PUT_BENCHMARK("load_time") {
+    tq = cut_tree_query_handler::from_file(FLAGS_cut_tree_path);
+  }
+  JLOG_PUT_BENCHMARK("write_time") {
+    write_cut_tree_binary(tq.parent_weight_, FLAGS_cut_tree_output_path.c_str(), FLAGS_cut_tree_output_index);
+  }
+  return 0;
+}
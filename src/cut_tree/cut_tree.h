@@ -3,12 +3,28 @@
 #include "cut_tree_with_2ecc.h"
 #include "dinitz.h"
 #include "bi_dinitz.h"
+#include "boykov_kolmogorov.h"
+#include "push_relabel.h"
 #include "cut_tree_query_handler.h"
+#include "cut_tree_binary.h"
+#include "sparse_certificate.h"
+#include "incremental_cut_tree.h"
 #include "plain_gomory_hu/gomory_hu_dinitz.h"
 #include "plain_gomory_hu/gomory_hu_bi_dinitz.h"
 
 namespace agl {
+namespace cut_tree_internal {
+template<>
+struct small_cut_tree_traits<cut_tree_with_2ecc> {
+  static const bool enabled = true;
+  static int connectivity_bound() { return FLAGS_cut_tree_connectivity_bound; }
+};
+} // namespace cut_tree_internal
+
 using cut_tree = agl::cut_tree_internal::two_edge_cc_filter<cut_tree_with_2ecc>; // fastest
+// 辺の重みを容量とする. 橋による分割はせず、連結成分毎に作る
+template<class weight_t>
+using weighted_cut_tree = agl::cut_tree_internal::connected_components_filter<weighted_cut_tree_with_2ecc<weight_t>, weighted_graph<weight_t>>;
 
 using gomory_hu_bi_dinitz = agl::cut_tree_internal::connected_components_filter<agl::cut_tree_internal::plain_gomory_hu::gomory_hu_bi_dinitz>; //faster than plain_gusfield_dinitz
 using gomory_hu_dinitz = agl::cut_tree_internal::connected_components_filter<agl::cut_tree_internal::plain_gomory_hu::gomory_hu_dinitz>;
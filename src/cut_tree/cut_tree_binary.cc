@@ -0,0 +1,225 @@
+#include "cut_tree_binary.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <queue>
+
+using namespace std;
+
+namespace agl {
+namespace {
+const char kCutTreeMagic[16] = "AGL_CUT_TREE";
+const uint32_t kCutTreeVersion = 1;
+const uint32_t kCutTreeByteOrder = 0x01020304;
+const uint32_t kCutTreeFlagIndex = 1;
+
+size_t align8(size_t x) { return (x + 7) & ~size_t(7); }
+
+void write_array(ostream& os, const int32_t* a, size_t len) {
+  os.write(reinterpret_cast<const char*>(a), len * sizeof(int32_t));
+  static const char zeros[8] = {};
+  os.write(zeros, align8(len * sizeof(int32_t)) - len * sizeof(int32_t));
+}
+
+void write_array(ostream& os, const vector<int32_t>& a) {
+  write_array(os, a.data(), a.size());
+}
+} // namespace
+
+vector<pair<V, int>> cut_tree_parent_weight(int num_vertices, const vector<tuple<V, V, int>>& edges) {
+  // CSR に詰めて BFS する
+  vector<int> offset(num_vertices + 1);
+  for (auto& e : edges) {
+    offset[get<0>(e) + 1]++;
+    offset[get<1>(e) + 1]++;
+  }
+  for (int v = 0; v < num_vertices; v++) offset[v + 1] += offset[v];
+  vector<pair<V, int>> adj(offset[num_vertices]);
+  {
+    vector<int> pos(offset.begin(), offset.end() - 1);
+    for (auto& e : edges) {
+      V u, v; int w; tie(u, v, w) = e;
+      adj[pos[u]++] = make_pair(v, w);
+      adj[pos[v]++] = make_pair(u, w);
+    }
+  }
+
+  vector<pair<V, int>> parent_weight(num_vertices, make_pair(-2, 0));
+  vector<V> q;
+  q.reserve(num_vertices);
+  for (V s = 0; s < num_vertices; s++) {
+    if (parent_weight[s].first != -2) continue;
+    parent_weight[s] = make_pair(-1, 0);
+    q.clear();
+    q.push_back(s);
+    for (size_t i = 0; i < q.size(); i++) {
+      V u = q[i];
+      for (int j = offset[u]; j < offset[u + 1]; j++) {
+        V to = adj[j].first;
+        if (parent_weight[to].first != -2) continue;
+        parent_weight[to] = make_pair(u, adj[j].second);
+        q.push_back(to);
+      }
+    }
+  }
+  return parent_weight;
+}
+
+void write_cut_tree_binary(const vector<pair<V, int>>& parent_weight, ostream& os, bool with_index) {
+  const int n = int(parent_weight.size());
+  vector<int32_t> parent(n), weight(n), depth(n, -1);
+  for (V v = 0; v < n; v++) {
+    parent[v] = parent_weight[v].first;
+    weight[v] = parent[v] == -1 ? 0 : parent_weight[v].second;
+  }
+  // 親が先に並んでいるとは限らないので、深さの決まっている祖先まで登ってから降りる
+  vector<V> path;
+  for (V v = 0; v < n; v++) {
+    V u = v;
+    while (depth[u] == -1 && parent[u] != -1) {
+      path.push_back(u);
+      u = parent[u];
+    }
+    if (depth[u] == -1) depth[u] = 0;
+    for (int i = int(path.size()) - 1; i >= 0; i--) depth[path[i]] = depth[parent[path[i]]] + 1;
+    path.clear();
+  }
+
+  cut_tree_binary_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kCutTreeMagic, sizeof(header.magic));
+  header.version = kCutTreeVersion;
+  header.byte_order = kCutTreeByteOrder;
+  header.num_vertices = n;
+
+  bottleneck_query_index<int> index;
+  if (with_index) {
+    index = bottleneck_query_index<int>(parent_weight);
+    header.flags |= kCutTreeFlagIndex;
+    header.num_index_levels = uint32_t(index.table().size());
+  }
+
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_array(os, parent);
+  write_array(os, weight);
+  write_array(os, depth);
+  if (with_index) {
+    write_array(os, index.position());
+    write_array(os, index.gaps());
+    for (auto& level : index.table()) write_array(os, level);
+  }
+  os.flush();
+  CHECK_MSG(os, "failed to write the cut tree");
+}
+
+void write_cut_tree_binary(const vector<pair<V, int>>& parent_weight, const char* filename, bool with_index) {
+  ofstream ofs(filename, ios_base::out | ios_base::binary);
+  CHECK_PERROR(ofs);
+  write_cut_tree_binary(parent_weight, ofs, with_index);
+}
+
+bool is_cut_tree_binary(const char* filename) {
+  ifstream ifs(filename, ios_base::in | ios_base::binary);
+  char magic[sizeof(kCutTreeMagic)];
+  if (!ifs.read(magic, sizeof(magic))) return false;
+  return memcmp(magic, kCutTreeMagic, sizeof(magic)) == 0;
+}
+
+vector<V> read_cut_tree_parent(const char* filename, int num_vertices) {
+  vector<V> parent;
+  if (is_cut_tree_binary(filename)) {
+    mapped_cut_tree mt(filename);
+    parent.resize(mt.num_vertices());
+    for (V v = 0; v < mt.num_vertices(); v++) parent[v] = mt.parent(v);
+  } else {
+    ifstream ifs(filename);
+    CHECK_MSG(ifs.is_open(), "cannot open the cut tree file");
+    vector<tuple<V, V, int>> edges;
+    V u, v;
+    string weight; // 重みは使わないので、整数でなくてもよい
+    int n = 0;
+    while (ifs >> u >> v >> weight) {
+      edges.emplace_back(u, v, 0);
+      n = max(n, max(u, v) + 1);
+    }
+    for (auto& pw : cut_tree_parent_weight(n, edges)) parent.push_back(pw.first);
+  }
+
+  // 取り除く頂点を飛ばす. ancestor[v] は v の祖先のうち num_vertices 未満の一番近いもの
+  const int n = int(parent.size());
+  vector<V> ancestor(n, -2), stack;
+  auto nearest = [&](V p) {
+    while (p >= num_vertices && ancestor[p] == -2) {
+      stack.push_back(p);
+      p = parent[p];
+    }
+    if (p >= num_vertices) p = ancestor[p];
+    for (V w : stack) ancestor[w] = p;
+    stack.clear();
+    return p;
+  };
+  vector<V> ret(num_vertices, -1);
+  for (V v = 0; v < min(n, num_vertices); v++) {
+    ret[v] = parent[v] == -1 ? -1 : nearest(parent[v]);
+  }
+  return ret;
+}
+
+mapped_cut_tree::mapped_cut_tree(const char* filename) : mapped_cut_tree() {
+  const int fd = open(filename, O_RDONLY);
+  CHECK_PERROR(fd != -1);
+  struct stat st;
+  CHECK_PERROR(fstat(fd, &st) == 0);
+  length_ = size_t(st.st_size);
+  CHECK_MSG(length_ >= sizeof(cut_tree_binary_header), "Invalid cut tree file.");
+  addr_ = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+  CHECK_PERROR(addr_ != MAP_FAILED);
+  close(fd);
+
+  const char* p = static_cast<const char*>(addr_);
+  const cut_tree_binary_header* header = reinterpret_cast<const cut_tree_binary_header*>(p);
+  CHECK_MSG(memcmp(header->magic, kCutTreeMagic, sizeof(kCutTreeMagic)) == 0, "Invalid file magic.");
+  CHECK_MSG(header->version == kCutTreeVersion, "Invalid file version.");
+  CHECK_MSG(header->byte_order == kCutTreeByteOrder, "Invalid byte order.");
+  n_ = int(header->num_vertices);
+
+  size_t offset = align8(sizeof(cut_tree_binary_header));
+  auto next_array = [&](size_t len) {
+    CHECK_MSG(offset + len * sizeof(int32_t) <= length_, "Truncated cut tree file.");
+    const int32_t* a = reinterpret_cast<const int32_t*>(p + offset);
+    offset += align8(len * sizeof(int32_t));
+    return a;
+  };
+  parent_ = next_array(n_);
+  weight_ = next_array(n_);
+  depth_ = next_array(n_);
+  if (header->flags & kCutTreeFlagIndex) {
+    const size_t num_gaps = n_ > 0 ? n_ - 1 : 0;
+    const size_t num_blocks = (num_gaps + bottleneck_query_index<int>::kBlockSize - 1) / bottleneck_query_index<int>::kBlockSize;
+    position_ = next_array(n_);
+    gaps_ = next_array(num_gaps);
+    for (uint32_t k = 0; k < header->num_index_levels; k++) {
+      table_.push_back(next_array(num_blocks - (size_t(1) << k) + 1));
+    }
+  }
+}
+
+mapped_cut_tree::~mapped_cut_tree() {
+  if (addr_ != nullptr) munmap(addr_, length_);
+}
+
+void mapped_cut_tree::swap(mapped_cut_tree& other) {
+  std::swap(addr_, other.addr_);
+  std::swap(length_, other.length_);
+  std::swap(n_, other.n_);
+  std::swap(parent_, other.parent_);
+  std::swap(weight_, other.weight_);
+  std::swap(depth_, other.depth_);
+  std::swap(position_, other.position_);
+  std::swap(gaps_, other.gaps_);
+  table_.swap(other.table_);
+}
+} // namespace agl
@@ -0,0 +1,101 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+#include "bottleneck_query_index.h"
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace agl {
+// Gomory-Hu 木のバイナリ形式
+// mmap してそのまま読めるように、ヘッダの後に 8 byte 境界に揃えた int32 の配列を並べる
+//   parent[n], weight[n], depth[n]   根の parent は -1, weight は 0
+//   索引付きなら続けて bottleneck_query_index の position[n], gaps[n - 1], table[k] (k = 0, 1, ...)
+// バイト順はマシンのものをそのまま使い、byte_order で確かめる
+struct cut_tree_binary_header {
+  char magic[16];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t flags;
+  uint32_t num_index_levels;
+  int64_t num_vertices;
+};
+
+// 木の辺 (u, v, 重み) を、頂点 0 を根 (連結でなければ各連結成分の最小の頂点を根) とした (親, 重み) に直す
+std::vector<std::pair<V, int>> cut_tree_parent_weight(int num_vertices, const std::vector<std::tuple<V, V, int>>& edges);
+
+void write_cut_tree_binary(const std::vector<std::pair<V, int>>& parent_weight, std::ostream& os, bool with_index = true);
+void write_cut_tree_binary(const std::vector<std::pair<V, int>>& parent_weight, const char* filename, bool with_index = true);
+
+// for_each_gomory_hu_tree_edge を持つ cut_tree (cut_tree, gomory_hu_bi_dinitz など) を書き出す
+template<class cut_tree_t>
+void print_gomory_hu_tree_binary(cut_tree_t& ct, const char* filename, bool with_index = true) {
+  std::vector<std::tuple<V, V, int>> edges;
+  ct.for_each_gomory_hu_tree_edge([&edges](V u, V v, int weight) {
+    edges.emplace_back(u, v, weight);
+  });
+  auto parent_weight = cut_tree_parent_weight(ct.num_vertices(), edges);
+  edges.clear(); edges.shrink_to_fit();
+  write_cut_tree_binary(parent_weight, filename, with_index);
+}
+
+// ファイルの先頭がバイナリ形式の magic か
+bool is_cut_tree_binary(const char* filename);
+
+// テキスト形式 (u v 重み の行) かバイナリ形式の木を読み、num_vertices 頂点の親の配列 (根は -1) にする
+// 頂点数の違うグラフの木でもよい. num_vertices 以上の頂点は取り除き、その子は一番近い残った祖先につなぐ
+std::vector<V> read_cut_tree_parent(const char* filename, int num_vertices);
+
+// バイナリ形式の Gomory-Hu 木を mmap して読む. cut_tree_query_handler と同じように問い合わせられる
+class mapped_cut_tree {
+public:
+  static mapped_cut_tree from_file(const std::string& path) {
+    return mapped_cut_tree(path.c_str());
+  }
+
+  mapped_cut_tree() : addr_(nullptr), length_(0), n_(0), parent_(nullptr), weight_(nullptr), depth_(nullptr), position_(nullptr), gaps_(nullptr) {}
+  explicit mapped_cut_tree(const char* filename);
+  mapped_cut_tree(mapped_cut_tree&& other) : mapped_cut_tree() { swap(other); }
+  mapped_cut_tree& operator=(mapped_cut_tree&& other) { swap(other); return *this; }
+  mapped_cut_tree(const mapped_cut_tree&) = delete;
+  mapped_cut_tree& operator=(const mapped_cut_tree&) = delete;
+  ~mapped_cut_tree();
+
+  // 索引があれば O(1)、なければ親を辿る
+  int query(V u, V v) const {
+    CHECK(u < n_ && v < n_);
+    if (!has_index()) return query_by_walk(u, v);
+    return bottleneck_query_index<int>::query(position_, gaps_, table_, u, v);
+  }
+
+  int query_by_walk(V u, V v) const {
+    CHECK(u != v);
+    CHECK(u < n_ && v < n_);
+    int ans = std::numeric_limits<int>::max();
+    while (u != v) {
+      if (depth_[u] > depth_[v]) std::swap(u, v);
+      if (parent_[v] == -1) return 0; // 別の木
+      ans = std::min(ans, weight_[v]);
+      v = parent_[v];
+    }
+    return ans;
+  }
+
+  int num_vertices() const { return n_; }
+  bool has_index() const { return position_ != nullptr; }
+  V parent(V v) const { return parent_[v]; }
+  int weight(V v) const { return weight_[v]; }
+  int depth(V v) const { return depth_[v]; }
+
+private:
+  void swap(mapped_cut_tree& other);
+
+  void* addr_;
+  std::size_t length_;
+  int n_;
+  const int32_t *parent_, *weight_, *depth_;
+  const int32_t *position_, *gaps_;
+  std::vector<const int32_t*> table_;
+};
+} // namespace agl
@@ -1,6 +1,7 @@
 #pragma once
 #include <base/base.h>
 #include <graph/graph.h>
+#include "bottleneck_query_index.h"
 #include <vector>
 #include <queue>
 #include <utility>
@@ -67,9 +68,16 @@ public:
     input.clear(); input.shrink_to_fit();
 
     build(edges);
+    index_ = bottleneck_query_index<int>(parent_weight_);
   }
 
   int query(V u, V v) const {
+    CHECK(u < num_vertices_ && v < num_vertices_);
+    return index_.query(u, v);
+  }
+
+  // 親を辿って答える. O(木の高さ)
+  int query_by_walk(V u, V v) const {
     CHECK(u != v);
     CHECK(u < num_vertices_ && v < num_vertices_);
     int ans = std::numeric_limits<int>::max();
@@ -137,5 +145,6 @@ public:
   int num_vertices_;
   std::vector<std::pair<V, int>> parent_weight_;
   std::vector<int> depth_;
+  bottleneck_query_index<int> index_;
 };
 } // namespace agl
@@ -1,9 +1,11 @@
 #include "cut_tree.h"
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <sstream>
 #include <vector>
 #include <map>
+#include <set>
 
 using namespace agl;
 using namespace agl::cut_tree_internal;
@@ -142,4 +144,1149 @@ TYPED_TEST(cut_tree_test, corner_case_small_graph) {
   }
 }
 
+// cut_tree は渡したグラフを壊すので、複製を受け取る
+// flag を変えて作る時は、呼び出し側で google::FlagSaver を置いてから変える
+template<class cut_tree_t = cut_tree>
+unique_ptr<cut_tree_t> build_cut_tree(G g) {
+  return unique_ptr<cut_tree_t>(new cut_tree_t(g));
+}
+
+template<class cut_tree_t>
+string print_tree(cut_tree_t& ct) {
+  stringstream ss;
+  ct.print_gomory_hu_tree(ss);
+  return ss.str();
+}
+
+vector<pair<V, V>> random_pairs(int n, int num_pairs) {
+  vector<pair<V, V>> pairs;
+  for (int i = 0; i < num_pairs; i++) {
+    V s = agl::random() % n;
+    V t = agl::random() % (n - 1);
+    if (s <= t) t++;
+    pairs.emplace_back(s, t);
+  }
+  return pairs;
+}
+
+// q (cut_tree や cut_tree_query_handler) の pairs での答えが、g の maxflow と一致する
+// bound > 0 なら maxflow を bound で頭打ちにして比べる
+template<class query_t>
+void check_against_max_flow(const G& g, query_t& q, const vector<pair<V, V>>& pairs, int bound = 0) {
+  bi_dinitz dz(g);
+  for (auto& st : pairs) {
+    const int a = dz.max_flow(st.first, st.second);
+    ASSERT_EQ(bound > 0 ? min(a, bound) : a, q.query(st.first, st.second));
+  }
+}
+
+// 2つの木の全ての頂点対の答えが一致する
+template<class query1_t, class query2_t>
+void check_same_answers(query1_t& a, query2_t& b, int n) {
+  for (V s = 0; s < n; s++) for (V t = s + 1; t < n; t++) {
+    ASSERT_EQ(a.query(s, t), b.query(s, t));
+  }
+}
+
+TEST(cut_tree_test, soa_bi_dinitz_eq_bi_dinitz) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    bi_dinitz dz1(g);
+    soa_bi_dinitz dz2(g);
+    V root = 0;
+    for (V v = 0; v < n; v++) if (g.degree(v) > g.degree(root)) root = v;
+    dz1.goal_oriented_bfs_init(root);
+    dz2.goal_oriented_bfs_init(root);
+    for (int i = 0; i < 1000; i++) {
+      V s = agl::random() % n;
+      V t = agl::random() % (n - 1);
+      if (s <= t) t++;
+      if (i % 2 == 0) t = s == root ? t : root;
+      ASSERT_EQ(dz1.max_flow(s, t), dz2.max_flow(s, t));
+      // 残余グラフも同じ
+      ASSERT_EQ(int(dz1.reason_for_finishing_bfs()), int(dz2.reason_for_finishing_bfs()));
+      for (V v = 0; v < n; v++) {
+        ASSERT_EQ(dz1.path_dont_exists_to_t(v), dz2.path_dont_exists_to_t(v));
+        ASSERT_EQ(dz1.path_dont_exists_from_s(v), dz2.path_dont_exists_from_s(v));
+      }
+    }
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(generate_path(100));
+  check(generate_erdos_renyi(500,10));
+  check(generate_grid(10,10));
+  check(generate_barbell(100));
+  for (int trial = 0; trial < 3; ++trial) {
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+TEST(cut_tree_test, bi_dinitz_long_augmenting_path) {
+  // 2 x n の梯子. 増加路の長さが n 程度になり、再帰の dfs ではスタックが足りなくなる
+  const int n = 300000;
+  vector<pair<V, V>> es;
+  for (int i = 0; i < n; i++) {
+    es.emplace_back(i, n + i);
+    if (i + 1 < n) es.emplace_back(i, i + 1), es.emplace_back(n + i, n + i + 1);
+  }
+  bi_dinitz bd(es, 2 * n);
+  soa_bi_dinitz sd(es, 2 * n);
+  ASSERT_EQ(2, bd.max_flow(0, 2 * n - 1));
+  ASSERT_EQ(2, sd.max_flow(0, 2 * n - 1));
+  ASSERT_EQ(2, bd.max_flow(1, 2 * n - 2));
+}
+
+TEST(cut_tree_test, bi_dinitz_early_termination) {
+  // 5-clique {0..4} と、0, 1 につながる頂点 5
+  vector<pair<V, V>> es = {{0, 5}, {1, 5}};
+  for (V u = 0; u < 5; u++) for (V v = u + 1; v < 5; v++) es.emplace_back(u, v);
+  auto check = [](bi_dinitz& dz, V s, V t, int upper_bound, int expected_flow,
+                  bi_dinitz::reason_for_finishing_bfs_t expected_reason, vector<V> expected_side) {
+    vector<int> used(dz.n());
+    mincut_result cut;
+    bounded_mincut(dz, s, t, upper_bound, 1, &used, &cut);
+    ASSERT_EQ(expected_flow, cut.cost);
+    ASSERT_EQ(expected_reason, dz.reason_for_finishing_bfs());
+    sort(cut.vs.begin(), cut.vs.end());
+    ASSERT_EQ(expected_side, cut.vs);
+  };
+  bi_dinitz dz(es, 6);
+  const int inf = numeric_limits<int>::max();
+  check(dz, 5, 2, inf, 2, bi_dinitz::kQsIsEmpty, {5});
+  check(dz, 2, 5, inf, 2, bi_dinitz::kQtIsEmpty, {5});
+  check(dz, 2, 3, inf, 4, bi_dinitz::kQsIsEmpty, {2});
+  // 上限と次数が等しければ cut が求まる
+  check(dz, 2, 5, 2, 2, bi_dinitz::kQtIsEmpty, {5});
+
+  dz.goal_oriented_bfs_init(0);
+  check(dz, 5, 0, inf, 2, bi_dinitz::kQsIsEmpty, {5});
+  check(dz, 3, 0, inf, 4, bi_dinitz::kQsIsEmpty, {3});
+
+  // 6-clique 2つを 3 本の辺でつなぐ. 次数 5 に達する前に上限で打ち切られる
+  es.clear();
+  for (V u = 0; u < 6; u++) for (V v = u + 1; v < 6; v++) es.emplace_back(u, v), es.emplace_back(u + 6, v + 6);
+  for (V v = 0; v < 3; v++) es.emplace_back(v, v + 6);
+  bi_dinitz dz2(es, 12);
+  check(dz2, 3, 9, 2, 2, bi_dinitz::kReachedUpperBound, {3});
+  check(dz2, 3, 9, 3, 3, bi_dinitz::kReachedUpperBound, {3});
+  ASSERT_EQ(3, dz2.max_flow(3, 9, 4));
+  ASSERT_NE(bi_dinitz::kReachedUpperBound, dz2.reason_for_finishing_bfs());
+}
+
+TEST(cut_tree_test, warm_start) {
+  google::FlagSaver flag_saver;
+  // 同じ t に続けて流した時の流量と cut が、毎回はじめから流した時と同じ
+  auto check_flow = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    bi_dinitz warm(g), cold(g);
+    vector<int> used(n);
+    int F = 0;
+    for (V t : {V(0), V(n / 2)}) {
+      for (V s = 0; s < n; s++) {
+        if (s == t) continue;
+        FLAGS_cut_tree_warm_start = false;
+        const int expected = cold.max_flow(s, t);
+        FLAGS_cut_tree_warm_start = true;
+        mincut_result cut;
+        bounded_mincut(warm, s, t, numeric_limits<int>::max(), ++F, &used, &cut);
+        ASSERT_EQ(expected, cut.cost);
+        // cut の辺の本数が流量に等しい
+        int num_cut_edges = 0;
+        for (V v : cut.vs) for (auto& e : g.edges(v)) num_cut_edges += used[to(e)] != F;
+        for (V v : cut.vs) for (auto& e : g.edges(v, kBwd)) num_cut_edges += used[to(e)] != F;
+        ASSERT_EQ(expected, num_cut_edges);
+        ASSERT_EQ(used[s] == F, used[t] != F);
+      }
+    }
+  };
+  check_flow(generate_grid(10, 10));
+  check_flow(built_in_graph("karate_club").edge_list());
+  check_flow(generate_erdos_renyi(300, 4));
+
+  auto build = [](const G& g, bool warm_start, int budget) {
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_warm_start = warm_start;
+    FLAGS_cut_tree_warm_start_budget = budget;
+    return build_cut_tree(g);
+  };
+  auto check = [&build](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    auto expected = build(g, false, 0);
+    for (int budget : {1, 64, 1 << 20}) {
+      auto ct = build(g, true, budget);
+      check_same_answers(*expected, *ct, n);
+    }
+  };
+  check(generate_grid(30,30));
+  check(built_in_graph("ca_grqc").edge_list());
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(500,3));
+    V M = 2;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+TEST(cut_tree_test, weighted_bi_dinitz_eq_bi_dinitz) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    // 重み w の辺を w 本の多重辺にしたものと比べる
+    auto wes = add_random_weight<weighted_graph<int64_t>>(g.edge_list());
+    vector<pair<V, V>> multi_es;
+    for (auto& e : wes) for (int i = 0; i < e.second.weight; i++) multi_es.emplace_back(e.first, e.second.to);
+    weighted_bi_dinitz<int64_t> dz1(std::move(wes), n);
+    bi_dinitz dz2(std::move(multi_es), n);
+    for (int i = 0; i < 1000; i++) {
+      V s = agl::random() % n;
+      V t = agl::random() % (n - 1);
+      if (s <= t) t++;
+      ASSERT_EQ(dz1.max_flow(s, t), dz2.max_flow(s, t));
+    }
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(generate_path(100));
+  check(generate_erdos_renyi(500,10));
+  check(generate_grid(10,10));
+  for (int trial = 0; trial < 3; ++trial) {
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+// flow engine の flow と、それが返した側から辿った cut の大きさを bi_dinitz と比べる
+// 半分は goal oriented search のように、同じ t に続けて流す
+template<class flow_t, class reference_t>
+void flow_engine_verify(flow_t& bk, reference_t& dz, int num_pairs) {
+  typedef typename flow_t::cap_t cap_t;
+  const int n = bk.n();
+  vector<int> used(n);
+  for (int i = 0; i < num_pairs; i++) {
+    V s = agl::random() % n;
+    V t = agl::random() % (n - 1);
+    if (s <= t) t++;
+    if (i < num_pairs / 2) t = s == 0 ? t : 0;
+    basic_mincut_result<cap_t> cut(s, t, bk.max_flow(s, t));
+    ASSERT_TRUE(is_eq(dz.max_flow(s, t), cut.cost));
+    collect_cut_side(bk, i + 1, &used, &cut);
+    cap_t cut_cap = cap_t();
+    for (V v : cut.vs) for (auto e : bk.edges(v)) {
+      if (used[bk.to(e)] != i + 1) cut_cap += bk.cap(e) + bk.cap(bk.rev(e));
+    }
+    ASSERT_TRUE(is_eq(cut.cost * 2, cut_cap));
+  }
+}
+
+TEST(cut_tree_test, boykov_kolmogorov_eq_bi_dinitz) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    bi_dinitz dz(g);
+    boykov_kolmogorov bk(g);
+    soa_boykov_kolmogorov sbk(g);
+    flow_engine_verify(bk, dz, 300);
+    flow_engine_verify(sbk, dz, 300);
+    auto wes = add_random_weight<weighted_graph<int64_t>>(g.edge_list());
+    weighted_boykov_kolmogorov<int64_t> wbk(vector<pair<V, weighted_edge<int64_t>>>(wes), n);
+    weighted_bi_dinitz<int64_t> wdz(std::move(wes), n);
+    flow_engine_verify(wbk, wdz, 300);
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(built_in_graph("ca_grqc").edge_list());
+  check(generate_path(100));
+  check(generate_grid(30,30));
+  check(generate_barbell(100));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(500,10));
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+
+  // 上限で打ち切る
+  vector<pair<V, V>> es;
+  for (V u = 0; u < 6; u++) for (V v = u + 1; v < 6; v++) es.emplace_back(u, v), es.emplace_back(u + 6, v + 6);
+  for (V v = 0; v < 3; v++) es.emplace_back(v, v + 6);
+  boykov_kolmogorov bk(std::move(es), 12);
+  ASSERT_EQ(2, bk.max_flow(3, 9, 2));
+  ASSERT_EQ(boykov_kolmogorov::kReachedUpperBound, bk.reason_for_finishing_bfs());
+  ASSERT_EQ(3, bk.max_flow(3, 9, 4));
+  ASSERT_NE(boykov_kolmogorov::kReachedUpperBound, bk.reason_for_finishing_bfs());
+}
+
+TEST(cut_tree_test, push_relabel_eq_bi_dinitz) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    bi_dinitz dz(g);
+    push_relabel pr(g);
+    soa_push_relabel spr(g);
+    flow_engine_verify(pr, dz, 300);
+    flow_engine_verify(spr, dz, 300);
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(built_in_graph("ca_grqc").edge_list());
+  check(generate_path(100));
+  check(generate_grid(30,30));
+  check(generate_barbell(100));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(500,10));
+    check(generate_erdos_renyi(200,40));
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+
+  // 上限で打ち切る
+  vector<pair<V, V>> es;
+  for (V u = 0; u < 6; u++) for (V v = u + 1; v < 6; v++) es.emplace_back(u, v), es.emplace_back(u + 6, v + 6);
+  for (V v = 0; v < 3; v++) es.emplace_back(v, v + 6);
+  push_relabel pr(std::move(es), 12);
+  ASSERT_LE(2, pr.max_flow(3, 9, 2));
+  ASSERT_EQ(push_relabel::kReachedUpperBound, pr.reason_for_finishing_bfs());
+  ASSERT_EQ(3, pr.max_flow(3, 9, 4));
+  ASSERT_NE(push_relabel::kReachedUpperBound, pr.reason_for_finishing_bfs());
+}
+
+TEST(cut_tree_test, soa_residual_graph_layout) {
+  auto print_tree_with = [](const G& g, const string& layout) {
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_residual_graph_layout = layout;
+    return print_tree(*build_cut_tree(g));
+  };
+  auto check = [&print_tree_with](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    // 辺の持ち方を変えても、同じ順番で同じ cut が見つかる
+    ASSERT_EQ(print_tree_with(g, "aos"), print_tree_with(g, "soa"));
+  };
+  check(built_in_graph("ca_grqc").edge_list());
+  check(generate_grid(30,30));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(500,10));
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+// flow engine と残余グラフの持ち方を指定して cut tree を作る. plain なら gomory_hu_bi_dinitz で作る
+// cut_tree は渡したグラフを壊すので、複製を受け取る
+cut_tree_query_handler build_cut_tree_with_engine(G g, const string& engine, const string& layout, bool plain) {
+  google::FlagSaver flag_saver;
+  FLAGS_cut_tree_flow_engine = engine;
+  FLAGS_cut_tree_residual_graph_layout = layout;
+  stringstream ss(plain ? print_tree(*build_cut_tree<gomory_hu_bi_dinitz>(g)) : print_tree(*build_cut_tree(g)));
+  return cut_tree_query_handler::from_file(ss);
+}
+
+TEST(cut_tree_test, boykov_kolmogorov_cut_tree) {
+  auto build = build_cut_tree_with_engine;
+  auto check = [&build](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    auto expected = build(g, "bi_dinitz", "aos", false);
+    for (const string layout : {"aos", "soa"}) {
+      for (bool plain : {false, true}) {
+        auto ct = build(g, "boykov_kolmogorov", layout, plain);
+        check_same_answers(expected, ct, n);
+      }
+    }
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(built_in_graph("ca_grqc").edge_list());
+  check(generate_grid(30,30));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(500,10));
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+TEST(cut_tree_test, push_relabel_cut_tree) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    auto expected = build_cut_tree_with_engine(g, "bi_dinitz", "aos", false);
+    for (const string layout : {"aos", "soa"}) {
+      for (bool plain : {false, true}) {
+        auto ct = build_cut_tree_with_engine(g, "push_relabel", layout, plain);
+        check_same_answers(expected, ct, n);
+      }
+    }
+
+    // auto では成分の平均次数で engine が変わる. どちらを選んでも同じ木になる
+    for (double degree : {0.0, 8.0}) {
+      google::FlagSaver flag_saver;
+      FLAGS_cut_tree_push_relabel_min_average_degree = degree;
+      auto ct = build_cut_tree_with_engine(g, "auto", "aos", false);
+      check_same_answers(expected, ct, n);
+    }
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(built_in_graph("ca_grqc").edge_list());
+  check(generate_grid(30,30));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(500,10));
+    check(generate_erdos_renyi(200,40));
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+TEST(cut_tree_test, compaction) {
+  auto build = [](const G& g, const string& layout, double threshold) {
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_residual_graph_layout = layout;
+    FLAGS_cut_tree_compaction_threshold = threshold;
+    return build_cut_tree(g);
+  };
+  auto check = [&build](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    auto expected = build(g, "aos", 0);
+    for (const string layout : {"aos", "soa"}) {
+      // 死んだ頂点が1つでもあれば毎回詰め直す
+      auto ct = build(g, layout, 1e-9);
+      check_same_answers(*expected, *ct, n);
+    }
+  };
+  check(built_in_graph("ca_grqc").edge_list());
+  check(generate_grid(30,30));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(500,10));
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+template<class cut_tree_t>
+string print_tree_with_threads(G g, int num_threads) {
+  google::FlagSaver flag_saver;
+  FLAGS_cut_tree_separate_all_threads = num_threads;
+  return print_tree(*build_cut_tree<cut_tree_t>(g));
+}
+
+TEST(cut_tree_test, parallel_separate_all) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    // 結果はスレッド数に依らない
+    const string tree1 = print_tree_with_threads<cut_tree>(g, 1);
+    const string tree2 = print_tree_with_threads<gomory_hu_bi_dinitz>(g, 1);
+    for (int num_threads : {2, 3, 4}) {
+      ASSERT_EQ(tree1, print_tree_with_threads<cut_tree>(g, num_threads));
+      ASSERT_EQ(tree2, print_tree_with_threads<gomory_hu_bi_dinitz>(g, num_threads));
+    }
+    stringstream ss1(tree1), ss2(tree2);
+    auto q1 = cut_tree_query_handler::from_file(ss1);
+    auto q2 = cut_tree_query_handler::from_file(ss2);
+    const auto pairs = random_pairs(n, 1000);
+    check_against_max_flow(g, q1, pairs);
+    check_against_max_flow(g, q2, pairs);
+
+    // 直列版は縮約するので辺は違うことがあるが、同じ Gomory-Hu 木として振る舞う
+    const string serial = print_tree_with_threads<cut_tree>(g, -1);
+    const string parallel = tree1;
+    auto weights = [](const string& tree) {
+      stringstream ss(tree);
+      vector<int> ret;
+      for (V u, v; ss >> u >> v;) {
+        int w;
+        ss >> w;
+        ret.push_back(w);
+      }
+      sort(ret.begin(), ret.end());
+      return ret;
+    };
+    ASSERT_EQ(weights(serial), weights(parallel));
+    stringstream ss_serial(serial);
+    auto q_serial = cut_tree_query_handler::from_file(ss_serial);
+    check_same_answers(q_serial, q1, n);
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(generate_path(100));
+  check(generate_erdos_renyi(500,10));
+  check(generate_grid(10,10));
+  check(generate_barbell(100));
+  for (int trial = 0; trial < 3; ++trial) {
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M));
+  }
+}
+
+TEST(cut_tree_test, parallel_tree_packing) {
+  auto check = [](vector<pair<V,V>>&& es, int bound) {
+    G g = to_directed_graph(G(es));
+    auto print_tree_with = [&g, bound](int num_trees, int num_threads) {
+      google::FlagSaver flag_saver;
+      FLAGS_cut_tree_try_greedy_tree_packing = num_trees;
+      FLAGS_cut_tree_tree_packing_threads = num_threads;
+      FLAGS_cut_tree_connectivity_bound = bound;
+      return print_tree(*build_cut_tree(g));
+    };
+    const string tree = print_tree_with(8, 1);
+    // 結果はスレッド数に依らない
+    ASSERT_EQ(tree, print_tree_with(8, 3));
+    ASSERT_EQ(tree, print_tree_with(8, 4));
+
+    stringstream ss(tree);
+    auto q = cut_tree_query_handler::from_file(ss);
+    check_against_max_flow(g, q, random_pairs(g.num_vertices(), 1000), bound);
+  };
+  check(built_in_graph("karate_club").edge_list(), 0);
+  check(generate_erdos_renyi(500, 10), 0);
+  check(generate_erdos_renyi(500, 10), 4);
+  check(generate_grid(10, 10), 0);
+  for (int trial = 0; trial < 3; ++trial) {
+    V M = 3;
+    V N = M + agl::random(1000);
+    check(generate_ba(N, M), 0);
+  }
+}
+
+// 密な部分グラフを疎につないで、hub が何個かに分かれるようにする
+vector<pair<V, V>> generate_communities(int num_communities, int community_size) {
+  vector<pair<V, V>> es;
+  for (int c = 0; c < num_communities; c++) {
+    for (auto& uv : generate_ba(community_size, 4)) {
+      es.emplace_back(uv.first + c * community_size, uv.second + c * community_size);
+    }
+  }
+  const int n = num_communities * community_size;
+  for (int i = 0; i < num_communities * 10; i++) es.emplace_back(agl::random(n), agl::random(n));
+  return es;
+}
+
+TEST(cut_tree_test, goal_oriented_search_hubs) {
+  auto check = [](vector<pair<V,V>>&& es, int num_hubs) {
+    G g = to_directed_graph(G(es));
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_goal_oriented_hubs = num_hubs;
+    auto ct = build_cut_tree(g);
+    check_against_max_flow(g, *ct, random_pairs(g.num_vertices(), 2000));
+  };
+  for (int num_hubs : {2, 4, 8}) {
+    check(generate_communities(4, 200), num_hubs);
+    check(generate_erdos_renyi(500, 10), num_hubs);
+    check(generate_grid(20, 20), num_hubs);
+    check(built_in_graph("karate_club").edge_list(), num_hubs);
+  }
+}
+
+TEST(cut_tree_test, autotune) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_autotune = true;
+    auto ct = build_cut_tree(g);
+    check_against_max_flow(g, *ct, random_pairs(g.num_vertices(), 2000));
+  };
+  check(generate_communities(4, 800));
+  check(generate_erdos_renyi(3000, 8));
+  check(generate_grid(50, 50));
+  check(generate_ba(3000, 3));
+  check(generate_path(100));
+}
+
+// uncross_cut に渡す group. group_of[v] が v の group
+struct fixed_groups {
+  vector<int> group_of;
+  int node_num() const { return int(group_of.size()); }
+  bool is_same_group(int a, int b) const { return group_of[a] == group_of[b]; }
+  int group_id(int v) const { return group_of[v]; }
+  int group_size(int g) const { return int(count(group_of.begin(), group_of.end(), g)); }
+  vector<int> get_group(int g) const {
+    vector<int> ret;
+    for (int v = 0; v < node_num(); v++) if (group_of[v] == g) ret.push_back(v);
+    return ret;
+  }
+};
+
+TEST(cut_tree_test, uncross_cut) {
+  auto sorted = [](vector<V> vs) {
+    sort(vs.begin() + 1, vs.end());
+    return vs;
+  };
+  // 路 0-1-2-3-4-5 の 0-5 mincut {0,1,2} は group {2,3} と交わる. 3 を足しても大きさは変わらない
+  {
+    bi_dinitz dz(generate_path(6), 6);
+    fixed_groups dcs{{0, 0, 1, 1, 0, 0}};
+    mincut_result cut(0, 5, 1);
+    cut.vs = {0, 1, 2};
+    ASSERT_TRUE(uncross_cut(dz, dcs, &cut));
+    ASSERT_EQ(vector<V>({0, 1, 2, 3}), sorted(cut.vs));
+    // 交わっていなければ変えない
+    ASSERT_FALSE(uncross_cut(dz, dcs, &cut));
+  }
+  // 2,3 が t 側と強くつながっていると、足すと大きくなるので除く
+  {
+    vector<pair<V, V>> es = {{0, 1}, {1, 2}, {2, 3}, {2, 4}, {3, 4}, {3, 5}, {4, 5}};
+    bi_dinitz dz(es, 6);
+    fixed_groups dcs{{0, 0, 1, 1, 0, 0}};
+    mincut_result cut(0, 5, 2);
+    cut.vs = {0, 1, 2};
+    ASSERT_TRUE(uncross_cut(dz, dcs, &cut));
+    ASSERT_EQ(vector<V>({0, 1}), sorted(cut.vs));
+  }
+  // t 側から求めた cut でも vs[0] は t のまま
+  {
+    bi_dinitz dz(generate_path(6), 6);
+    fixed_groups dcs{{0, 0, 1, 1, 0, 0}};
+    mincut_result cut(0, 5, 1);
+    cut.vs = {5, 4, 3};
+    ASSERT_TRUE(uncross_cut(dz, dcs, &cut));
+    ASSERT_EQ(vector<V>({5, 2, 3, 4}), sorted(cut.vs));
+  }
+  // どちらでも大きくなる group は残す
+  {
+    vector<pair<V, V>> es = {{0, 1}, {0, 2}, {1, 2}, {2, 3}, {3, 4}, {3, 5}, {4, 5}};
+    bi_dinitz dz(es, 6);
+    fixed_groups dcs{{0, 0, 1, 1, 0, 0}};
+    mincut_result cut(0, 5, 1);
+    cut.vs = {0, 1, 2};
+    ASSERT_FALSE(uncross_cut(dz, dcs, &cut));
+    ASSERT_EQ(vector<V>({0, 1, 2}), cut.vs);
+  }
+}
+
+TEST(cut_tree_test, connectivity_bound) {
+  google::FlagSaver flag_saver;
+  auto build = [](const G& g, int bound, int num_threads) {
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_connectivity_bound = bound;
+    FLAGS_cut_tree_separate_all_threads = num_threads;
+    return build_cut_tree(g);
+  };
+  auto check = [&build](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    auto exact = build(g, 0, -1);
+    for (int bound : {2, 3, 5}) {
+      // bound 未満は正確に、bound 以上は bound と答える
+      auto ct = build(g, bound, -1);
+      auto parallel = build(g, bound, 4);
+      for (V s = 0; s < n; s++) for (V t = s + 1; t < n; t++) {
+        ASSERT_EQ(min(exact->query(s, t), bound), ct->query(s, t));
+      }
+      check_same_answers(*ct, *parallel, n);
+    }
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(built_in_graph("ca_grqc").edge_list());
+  check(generate_grid(30,30));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(300,10));
+    V M = 3;
+    V N = M + agl::random(500);
+    check(generate_ba(N, M));
+  }
+
+  G g = to_directed_graph(G(generate_erdos_renyi(300,10)));
+  const int n = g.num_vertices();
+  weighted_graph<int64_t> wg(add_unit_weight<weighted_graph<int64_t>>(g.edge_list()), n);
+  weighted_cut_tree<int64_t> exact(wg);
+  FLAGS_cut_tree_connectivity_bound = 4;
+  weighted_cut_tree<int64_t> bounded(wg);
+  for (V s = 0; s < n; s++) for (V t = s + 1; t < n; t++) {
+    ASSERT_EQ(min<int64_t>(exact.query(s, t), 4), bounded.query(s, t));
+  }
+}
+
+TEST(cut_tree_test, sparse_certificate) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    const auto edges = g.edge_list();
+    //cut_tree constructor break down 'g'
+    cut_tree exact(g);
+    for (int k : {2, 3, 5}) {
+      auto cert = edges;
+      sparse_certificate(n, k, &cert);
+      ASSERT_LE(cert.size(), size_t(k) * (n - 1));
+      G h(cert, n);
+      cut_tree ct(h);
+      for (V s = 0; s < n; s++) for (V t = s + 1; t < n; t++) {
+        ASSERT_EQ(min(exact.query(s, t), k), min(ct.query(s, t), k));
+      }
+    }
+
+    // 重み付き
+    typedef weighted_graph<int64_t>::edge_list_type weighted_edge_list;
+    weighted_edge_list wes;
+    for (auto& e : edges) wes.emplace_back(e.first, weighted_edge<int64_t>{to(e.second), int64_t(1 + agl::random(3))});
+    weighted_cut_tree<int64_t> wexact(weighted_graph<int64_t>(wes, n));
+    for (int64_t k : {3, 7}) {
+      auto cert = wes;
+      sparse_certificate(n, k, &cert);
+      int64_t total = 0;
+      for (auto& e : cert) total += weight(e.second);
+      ASSERT_LE(total, k * (n - 1));
+      weighted_cut_tree<int64_t> wct(weighted_graph<int64_t>(cert, n));
+      for (V s = 0; s < n; s++) for (V t = s + 1; t < n; t++) {
+        ASSERT_EQ(min(wexact.query(s, t), k), min(wct.query(s, t), k));
+      }
+    }
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(generate_grid(10,10));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(200,20));
+    V M = 5;
+    V N = M + agl::random(300);
+    check(generate_ba(N, M));
+  }
+}
+
+TEST(cut_tree_test, find_bridges) {
+  auto bridges = [](const G& g, const vector<V>& bridge_parent) {
+    set<pair<V, V>> ret;
+    for (V v = 0; v < g.num_vertices(); v++) {
+      if (bridge_parent[v] != -1) ret.emplace(min(v, bridge_parent[v]), max(v, bridge_parent[v]));
+    }
+    return ret;
+  };
+  auto check = [&bridges](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    union_find uf(n);
+    for (auto& e : g.edge_list()) uf.unite(e.first, to(e.second));
+    vector<V> roots;
+    for (V v = 0; v < n; v++) if (uf.root(v) == v) roots.push_back(v);
+
+    auto expected = bridges(g, find_bridges_dfs(g, roots));
+    ASSERT_EQ(expected, bridges(g, find_bridges_parallel(g, roots, 1)));
+    ASSERT_EQ(expected, bridges(g, find_bridges_parallel(g, roots, 4)));
+
+    // 辺を1本取り除いて連結成分が増えるかどうかと比べる
+    if (n > 300) return;
+    auto edges = g.edge_list();
+    for (size_t i = 0; i < edges.size(); i++) {
+      union_find uf2(n);
+      for (size_t j = 0; j < edges.size(); j++) if (i != j) uf2.unite(edges[j].first, to(edges[j].second));
+      const V u = edges[i].first, v = to(edges[i].second);
+      ASSERT_EQ(!uf2.is_same(u, v), expected.count(make_pair(min(u, v), max(u, v))) == 1);
+    }
+  };
+
+  check(built_in_graph("karate_club").edge_list());
+  check(generate_path(100));
+  check(generate_cycle(100));
+  check(generate_barbell(30));
+  for (int trial = 0; trial < 3; ++trial) {
+    check(generate_erdos_renyi(200, 1.5));
+    check(generate_erdos_renyi(5000, 2));
+    V M = 2 + trial;
+    check(generate_ba(300, M));
+  }
+
+  // 再帰しないので、長いパスでもスタックが溢れない
+  G path(generate_path(1000000));
+  ASSERT_EQ(bridges(path, find_bridges_dfs(path, {0})).size(), 999999u);
+}
+
+TYPED_TEST(cut_tree_test, parallel_build_components) {
+  using cut_tree_t = TypeParam;
+  // 小さなグラフを沢山並べて、連結成分を増やす
+  vector<pair<V, V>> es;
+  V offset = 0;
+  for (int trial = 0; trial < 30; ++trial) {
+    auto sub = trial % 2 == 0 ? generate_erdos_renyi(30 + agl::random(50), 3) : generate_ba(20 + agl::random(50), 2);
+    V num_vs = 0;
+    for (auto& uv : sub) {
+      es.emplace_back(uv.first + offset, uv.second + offset);
+      num_vs = max(num_vs, max(uv.first, uv.second) + 1);
+    }
+    offset += num_vs;
+  }
+  G g = to_directed_graph(G(es));
+
+  auto print_tree_with = [&g](int num_threads) {
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_build_components_threads = num_threads;
+    return print_tree(*build_cut_tree<cut_tree_t>(g));
+  };
+  const string expected = print_tree_with(1);
+  ASSERT_EQ(expected, print_tree_with(2));
+  ASSERT_EQ(expected, print_tree_with(4));
+}
+
+// 閉路に弦を足した小さいグラフ. 頂点は [offset, offset + num_vs)
+vector<pair<V, V>> generate_small_component(V offset, int num_vs, int num_chords) {
+  vector<pair<V, V>> es;
+  for (int i = 0; num_vs >= 3 && i < num_vs; i++) es.emplace_back(offset + min(i, (i + 1) % num_vs), offset + max(i, (i + 1) % num_vs));
+  if (num_vs == 2) es.emplace_back(offset, offset + 1);
+  for (int i = 0; num_vs >= 2 && i < num_chords; i++) {
+    V u = agl::random(num_vs), w = agl::random(num_vs - 1);
+    if (u <= w) w++;
+    es.emplace_back(offset + min(u, w), offset + max(u, w));
+  }
+  sort(es.begin(), es.end());
+  es.erase(unique(es.begin(), es.end()), es.end());
+  return es;
+}
+
+TEST(cut_tree_test, small_cut_tree_builder) {
+  small_cut_tree_builder builder;
+  for (int trial = 0; trial < 200; ++trial) {
+    const int n = 1 + agl::random(small_cut_tree_builder::kMaxVertices);
+    auto es = generate_small_component(0, n, agl::random(3 * n));
+    builder.reset(n);
+    for (auto& uv : es) ASSERT_TRUE(builder.add_edge(uv.first, uv.second));
+    vector<pair<V, int>> parent_weight(n);
+    builder.build(parent_weight.data());
+
+    // 木の各辺を除いた時の部分木が、その重みの cut になっている
+    ASSERT_EQ(-1, parent_weight[0].first);
+    for (V v = 1; v < n; v++) {
+      vector<char> below(n);
+      for (V x = 0; x < n; x++) {
+        for (V y = x; y != -1; y = parent_weight[y].first) {
+          if (y == v) below[x] = true;
+        }
+      }
+      int cut = 0;
+      for (auto& uv : es) cut += below[uv.first] != below[uv.second];
+      ASSERT_EQ(parent_weight[v].second, cut);
+    }
+  }
+  builder.reset(3);
+  ASSERT_TRUE(builder.add_edge(0, 1));
+  ASSERT_FALSE(builder.add_edge(1, 0));
+}
+
+TEST(cut_tree_test, small_components) {
+  // 大きさ 1 から 70 の連結成分を並べる. 一部は多重辺を持たせて通常の handler に回す
+  vector<pair<V, V>> es;
+  V n = 0;
+  for (int trial = 0; trial < 300; ++trial) {
+    const int num_vs = 1 + agl::random(70);
+    for (auto& uv : generate_small_component(n, num_vs, agl::random(2 * num_vs))) es.push_back(uv);
+    if (num_vs >= 2 && trial % 10 == 0) es.emplace_back(n + 1, n);
+    n += num_vs;
+  }
+  G g(es, n);
+
+  // 殆どの頂点対は別の連結成分になるので、半分は近くの頂点と組にする
+  auto pairs = random_pairs(n, 3000);
+  for (int i = 0; i < 3000; i += 2) {
+    const V t = pairs[i].first + 1 + V(agl::random(8));
+    if (t < n) pairs[i].second = t;
+  }
+  for (int small_size : {64, 0}) {
+    google::FlagSaver flag_saver;
+    FLAGS_cut_tree_small_component_size = small_size;
+    auto ct = build_cut_tree(g);
+    stringstream ss(print_tree(*ct));
+    auto q = cut_tree_query_handler::from_file(ss);
+    check_against_max_flow(g, *ct, pairs);
+    check_against_max_flow(g, q, pairs);
+  }
+}
+
+template<class weight_t>
+void weighted_cut_tree_verify(vector<pair<V,V>>&& es) {
+  G g = to_directed_graph(G(es));
+  const int n = g.num_vertices();
+  auto wes = add_random_weight<weighted_graph<weight_t>>(g.edge_list());
+  weighted_graph<weight_t> wg(wes, n);
+  weighted_cut_tree<weight_t> ct(wg);
+  weighted_bi_dinitz<weight_t> dz(std::move(wes), n);
+  for (int i = 0; i < 3000; i++) {
+    V s = agl::random() % n;
+    V t = agl::random() % (n - 1);
+    if (s <= t) t++;
+    ASSERT_TRUE(is_eq(ct.query(s, t), dz.max_flow(s, t)));
+  }
+}
+
+TEST(cut_tree_test, weighted_cut_tree) {
+  for (auto check : {weighted_cut_tree_verify<int64_t>, weighted_cut_tree_verify<double>}) {
+    check(built_in_graph("karate_club").edge_list());
+    check(built_in_graph("ca_grqc").edge_list());
+    check(generate_path(100));
+    check(generate_cycle(100));
+    check(generate_barbell(30));
+    check(generate_grid(10,10));
+    for (int trial = 0; trial < 3; ++trial) {
+      check(generate_erdos_renyi(500,10));
+      V M = 3;
+      V N = M + agl::random(1000);
+      check(generate_ba(N, M));
+    }
+  }
+}
+
+TEST(cut_tree_test, weighted_cut_tree_parallel_edges) {
+  // 同じ頂点対の辺を逆向きも含めて重ねても、まとめた木は元の多重辺のグラフの maxflow と一致する
+  G g = to_directed_graph(G(generate_erdos_renyi(300, 4)));
+  const int n = g.num_vertices();
+  auto wes = add_random_weight<weighted_graph<int64_t>>(g.edge_list());
+  const int m = int(wes.size());
+  for (int i = 0; i < m; i++) {
+    const auto e = wes[agl::random(m)];
+    const int64_t w = 1 + agl::random(5);
+    if (i % 2 == 0) wes.emplace_back(e.first, weighted_edge<int64_t>{to(e.second), w});
+    else wes.emplace_back(to(e.second), weighted_edge<int64_t>{e.first, w});
+  }
+  auto merged = merge_parallel_edges<int64_t>(wes);
+  ASSERT_EQ(size_t(m), merged.size());
+  weighted_cut_tree<int64_t> ct(weighted_graph<int64_t>(merged, n));
+  weighted_bi_dinitz<int64_t> dz(std::move(wes), n);
+  for (int i = 0; i < 3000; i++) {
+    V s = agl::random() % n;
+    V t = agl::random() % (n - 1);
+    if (s <= t) t++;
+    ASSERT_EQ(dz.max_flow(s, t), ct.query(s, t));
+  }
+}
+
+TEST(cut_tree_test, weighted_cut_tree_with_unit_weight) {
+  auto check = [](vector<pair<V,V>>&& es) {
+    G g = to_directed_graph(G(es));
+    const int n = g.num_vertices();
+    weighted_graph<int64_t> wg(add_unit_weight<weighted_graph<int64_t>>(g.edge_list()), n);
+    weighted_cut_tree<int64_t> wct(wg);
+    cut_tree ct(g);
+    for (V s = 0; s < n; s++) for (V t = s + 1; t < n; t++) {
+      ASSERT_EQ(ct.query(s, t), wct.query(s, t));
+    }
+  };
+  check(built_in_graph("karate_club").edge_list());
+  check(built_in_graph("dolphin").edge_list());
+  check(generate_barbell(30));
+  check(generate_erdos_renyi(300,4));
+}
+
+TEST(cut_tree_test, bottleneck_query_index) {
+  for (int trial = 0; trial < 20; ++trial) {
+    const int n = 2 + agl::random(300);
+    // 半分はパス状の木にする
+    const bool path = trial % 2 == 0;
+    vector<tuple<V, V, int>> input;
+    for (int v = 1; v < n; v++) {
+      V p = path ? v - 1 : agl::random(v);
+      input.emplace_back(v, p, agl::random(5));
+    }
+    cut_tree_query_handler tq(input);
+    for (int i = 0; i < n; i++) {
+      for (int j = i + 1; j < n; j++) {
+        ASSERT_EQ(tq.query_by_walk(i, j), tq.query(i, j));
+      }
+    }
+  }
+
+  // 森なら別の木の頂点同士は 0
+  vector<pair<V, double>> parent_weight = {{-1, 0}, {0, 1.5}, {1, 0.5}, {-1, 0}, {3, 2.5}};
+  bottleneck_query_index<double> index(parent_weight);
+  ASSERT_EQ(1.5, index.query(0, 1));
+  ASSERT_EQ(0.5, index.query(0, 2));
+  ASSERT_EQ(2.5, index.query(4, 3));
+  ASSERT_EQ(0, index.query(1, 4));
+}
+
+TEST(cut_tree_test, cut_tree_binary) {
+  char path[] = "/tmp/cut_tree_test_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  close(fd);
+
+  for (int trial = 0; trial < 4; ++trial) {
+    V M = 2 + trial % 3;
+    V N = M + agl::random(500);
+    G g = to_directed_graph(G(generate_ba(N, M)));
+    // 孤立点を足して森にする
+    g = G(g.edge_list(), N + 3);
+    cut_tree ct(g);
+    const bool with_index = trial % 2 == 0;
+    print_gomory_hu_tree_binary(ct, path, with_index);
+    ASSERT_TRUE(is_cut_tree_binary(path));
+
+    mapped_cut_tree mt = mapped_cut_tree::from_file(path);
+    ASSERT_EQ(N + 3, mt.num_vertices());
+    ASSERT_EQ(with_index, mt.has_index());
+    for (V v = 0; v < mt.num_vertices(); v++) {
+      if (mt.parent(v) == -1) ASSERT_EQ(0, mt.depth(v));
+      else ASSERT_EQ(mt.depth(mt.parent(v)) + 1, mt.depth(v));
+    }
+    for (int i = 0; i < N + 3; i++) {
+      for (int j = i + 1; j < N + 3; j++) {
+        ASSERT_EQ(ct.query(i, j), mt.query(i, j));
+        ASSERT_EQ(ct.query(i, j), mt.query_by_walk(i, j));
+      }
+    }
+  }
+  unlink(path);
+}
+
+vector<V> cut_tree_parent(cut_tree& ct) {
+  vector<tuple<V, V, int>> tree_edges;
+  ct.for_each_gomory_hu_tree_edge([&tree_edges](V u, V v, int weight) {
+    tree_edges.emplace_back(u, v, weight);
+  });
+  vector<V> parent;
+  for (auto& pw : cut_tree_parent_weight(ct.num_vertices(), tree_edges)) parent.push_back(pw.first);
+  return parent;
+}
+
+// 前の木を hint に与えても、hint なしと同じ答えになる
+TEST(cut_tree_test, hint_tree) {
+  auto check = [](const vector<pair<V, V>>& es, int n, const vector<V>& hint) {
+    G g(es, n);
+    G h = g;
+    cut_tree ct(h, hint);
+    check_against_max_flow(g, ct, random_pairs(n, 3000));
+  };
+  for (int trial = 0; trial < 6; ++trial) {
+    const int n = 300;
+    auto es = to_directed_graph(G(trial % 2 == 0 ? generate_erdos_renyi(n, 6) : generate_ba(n, 3), n)).edge_list();
+    G g(es, n);
+    cut_tree ct(g);
+    const vector<V> hint = cut_tree_parent(ct);
+
+    // 同じグラフ
+    check(es, n, hint);
+    // 辺を少し消して足したグラフ
+    auto es2 = es;
+    for (int i = 0; i < 10; i++) {
+      const int k = agl::random(es2.size());
+      es2[k] = es2.back();
+      es2.pop_back();
+    }
+    for (int i = 0; i < 10; i++) es2.emplace_back(agl::random(n / 2), n / 2 + agl::random(n / 2));
+    es2 = to_directed_graph(G(es2, n)).edge_list();
+    check(es2, n, hint);
+    // でたらめな木
+    vector<V> random_hint(n, -1);
+    for (V v = 1; v < n; v++) random_hint[v] = agl::random(v);
+    check(es2, n, random_hint);
+    // 一部の頂点だけの木
+    vector<V> partial_hint(hint.begin(), hint.begin() + n / 2);
+    partial_hint.resize(n, -1);
+    check(es2, n, partial_hint);
+  }
+}
+
+TEST(cut_tree_test, read_cut_tree_parent) {
+  char path[] = "/tmp/cut_tree_test_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  close(fd);
+
+  const int n = 200;
+  G g = to_directed_graph(G(generate_ba(n, 3)));
+  cut_tree ct(g);
+  const vector<V> parent = cut_tree_parent(ct);
+  for (int format = 0; format < 2; ++format) {
+    if (format == 0) {
+      ofstream os(path);
+      ct.print_gomory_hu_tree(os);
+    } else {
+      print_gomory_hu_tree_binary(ct, path, false);
+    }
+    const vector<V> read = read_cut_tree_parent(path, n);
+    ASSERT_EQ(n, int(read.size()));
+    // 木の形は同じ (根が違うことはある) なので、辺の集合で比べる
+    set<pair<V, V>> expected, actual;
+    for (V v = 0; v < n; v++) {
+      if (parent[v] != -1) expected.emplace(min(v, parent[v]), max(v, parent[v]));
+      if (read[v] != -1) actual.emplace(min(v, read[v]), max(v, read[v]));
+    }
+    ASSERT_EQ(expected, actual);
+
+    // 頂点が減ったら、消えた頂点を飛ばして祖先につなぐ
+    const vector<V> small = read_cut_tree_parent(path, n / 2);
+    ASSERT_EQ(n / 2, int(small.size()));
+    for (V v = 0; v < n / 2; v++) {
+      V p = read[v];
+      while (p >= n / 2) p = read[p];
+      ASSERT_EQ(p, small[v]);
+    }
+    // 頂点が増えたら、増えた頂点は根
+    const vector<V> large = read_cut_tree_parent(path, n + 5);
+    ASSERT_EQ(n + 5, int(large.size()));
+    for (V v = 0; v < n; v++) ASSERT_EQ(read[v], large[v]);
+    for (V v = n; v < n + 5; v++) ASSERT_EQ(-1, large[v]);
+  }
+  unlink(path);
+}
+
+// 辺を足したり消したりしながら、作り直した木と比べる
+void incremental_cut_tree_verify(vector<pair<V, V>> es, int n, int num_updates) {
+  es = to_directed_graph(G(es, n)).edge_list();
+  incremental_cut_tree ict(G(es, n));
+  for (int i = 0; i < num_updates; i++) {
+    if (es.empty() || agl::random(2) == 0) {
+      V u = agl::random(n), v = agl::random(n - 1);
+      if (v >= u) v++;
+      // 既にある辺と同じ辺も足す (多重辺)
+      if (!es.empty() && agl::random(4) == 0) tie(u, v) = es[agl::random(es.size())];
+      es.emplace_back(u, v);
+      ict.insert_edge(u, v);
+    } else {
+      const int k = agl::random(es.size());
+      ict.delete_edge(es[k].first, es[k].second);
+      es[k] = es.back();
+      es.pop_back();
+    }
+
+    G g(es, n);
+    bi_dinitz dz(g);
+    for (int u = 0; u < n; u++) {
+      for (int v = u + 1; v < n; v++) {
+        ASSERT_EQ(dz.max_flow(u, v), ict.query(u, v)) << "update " << i;
+      }
+    }
+  }
+}
+
+TEST(cut_tree_test, incremental_cut_tree) {
+  for (int trial = 0; trial < 10; ++trial) {
+    incremental_cut_tree_verify(generate_erdos_renyi(30 + agl::random(30), 4), 60, 30);
+    incremental_cut_tree_verify(generate_ba(20 + agl::random(30), 3), 50, 30);
+  }
+  incremental_cut_tree_verify(generate_grid(5, 6), 30, 50);
+  incremental_cut_tree_verify(generate_barbell(6), 12, 50);
+  incremental_cut_tree_verify({}, 10, 50);
+
+  // 作ってある木から始める. 上限を 0 にすると毎回作り直す
+  auto es = to_directed_graph(G(generate_erdos_renyi(100, 6))).edge_list();
+  G g(es, 100);
+  cut_tree ct(g);
+  vector<tuple<V, V, int>> tree_edges;
+  ct.for_each_gomory_hu_tree_edge([&tree_edges](V u, V v, int weight) {
+    tree_edges.emplace_back(u, v, weight);
+  });
+  incremental_cut_tree ict(es, 100, cut_tree_parent_weight(100, tree_edges));
+  ict.insert_edge(0, 1);
+  ASSERT_LE(0, ict.last_num_max_flows());
+  ASSERT_EQ(0, ict.num_rebuilds());
+
+  google::FlagSaver flag_saver;
+  FLAGS_cut_tree_incremental_max_flows = 0;
+  ict.insert_edge(2, 3);
+  ASSERT_EQ(-1, ict.last_num_max_flows());
+  ASSERT_EQ(1, ict.num_rebuilds());
+  // 多重辺があれば重み付きで作り直す
+  ict.insert_edge(2, 3);
+  ict.insert_edge(2, 3);
+  ASSERT_EQ(3, ict.num_rebuilds());
+  es.emplace_back(0, 1);
+  es.emplace_back(2, 3);
+  es.emplace_back(2, 3);
+  es.emplace_back(2, 3);
+  bi_dinitz dz(G(es, 100));
+  for (int u = 0; u < 100; u++) {
+    for (int v = u + 1; v < 100; v++) ASSERT_EQ(dz.max_flow(u, v), ict.query(u, v));
+  }
+}
+
 }
@@ -1,16 +1,29 @@
 #include "cut_tree_with_2ecc.h"
 #include "bi_dinitz.h"
+#include "boykov_kolmogorov.h"
+#include "push_relabel.h"
 #include "greedy_treepacking.h"
+#include "parallel_separate_all.h"
+#include "bottleneck_query_index.h"
+#include "sparse_certificate.h"
+#include <cmath>
 #include <queue>
 #include <unordered_set>
 
 DEFINE_int32(cut_tree_try_greedy_tree_packing, 1, "number of tree packing");
+DEFINE_int32(cut_tree_tree_packing_threads, 1, "number of threads packing trees from different roots (0 = hardware concurrency)");
 DEFINE_int32(cut_tree_try_large_degreepairs, 10, "number of separate large degree pairs");
 DEFINE_int32(cut_tree_separate_near_pairs_d, 1, "separate near pairs radius");
 DEFINE_int32(cut_tree_contraction_lower_bound, 2, "contraction upper bound");
 DEFINE_bool(cut_tree_enable_greedy_tree_packing, true, "");
 DEFINE_bool(cut_tree_enable_adjacent_cut, true, "");
 DEFINE_bool(cut_tree_enable_goal_oriented_search, true, "");
+DEFINE_int32(cut_tree_goal_oriented_hubs, 1, "max number of hubs in goal oriented search; the single bfs depth array is rebuilt for each hub in O(n + m)");
+DEFINE_int32(cut_tree_goal_oriented_hub_distance, 3, "a new hub must be at least this far from the hubs already chosen");
+DEFINE_bool(cut_tree_autotune, false, "plan the phases per 2-edge-connected component of 1000+ vertices: greedy tree packing from the average degree, goal oriented search from the bfs depths from the max-degree vertex, and its hubs from the max flows of the hub candidates to that vertex (logged under autotune)");
+DEFINE_int32(cut_tree_connectivity_bound, 0, "compute connectivity only below this value; larger values are reported as this value (0: exact)");
+DEFINE_double(cut_tree_compaction_threshold, 0.5, "compact the residual graph when the fraction of dead vertices exceeds this (<= 0 disables)");
+DEFINE_string(cut_tree_flow_engine, "bi_dinitz", "max flow engine of the separator: bi_dinitz, boykov_kolmogorov, push_relabel (unit capacities only), auto (push_relabel for dense 2-edge-connected components)");
 
 using namespace std;
 using namespace agl::cut_tree_internal;
@@ -135,7 +148,8 @@ private:
   vector<int> group_size_;
 };
 
-class gomory_hu_tree_builder {
+template<class weight_t>
+class basic_gomory_hu_tree_builder {
   void dfs(V v, V par = -1) {
     int dep = (par == -1) ? 0 : depth_[par] + 1;
     depth_[v] = dep;
@@ -147,7 +161,9 @@ class gomory_hu_tree_builder {
   }
 
 public:
-  gomory_hu_tree_builder(int n) : n_(n), edges_(n), depth_(n), parent_cost_(n) {
+  // upper_bound より大きい辺の重みは upper_bound にする
+  basic_gomory_hu_tree_builder(int n, weight_t upper_bound = numeric_limits<weight_t>::max())
+    : n_(n), edges_(n), depth_(n), parent_cost_(n), upper_bound_(upper_bound) {
     add_edge_count_ = 0;
   }
 
@@ -160,7 +176,7 @@ public:
     edges_.resize(edges_.size() + 2);
     CHECK(get<0>(edges_[s].back()) == t);
     CHECK(get<0>(edges_[t].back()) == s);
-    int f = get<1>(edges_[s].back());
+    weight_t f = get<1>(edges_[s].back());
 
     get<0>(edges_[s].back()) = sside_new_vtx;
     get<2>(edges_[s].back()) = 0;
@@ -174,7 +190,7 @@ public:
     edges_[tside_new_vtx].emplace_back(sside_new_vtx, f, 1);
   }
 
-  void add_edge(V u, V v, int cost, const vector<V>& vs, const disjoint_cut_set* dcs) {
+  void add_edge(V u, V v, weight_t cost, const vector<V>& vs, const disjoint_cut_set* dcs) {
     CHECK(u != v);
     add_edge_count_++;
     for (V w : vs) {
@@ -228,13 +244,21 @@ public:
     CHECK(add_edge_count_ == n_ - 1);
     parent_cost_[0] = make_pair(-1, 0);
     dfs(0);
+    for (auto& pc : parent_cost_) pc.second = min(pc.second, upper_bound_);
     edges_.clear(); edges_.shrink_to_fit();
+    index_ = bottleneck_query_index<weight_t>(parent_cost_);
   }
 
-  int query(V u, V v) const {
+  weight_t query(V u, V v) const {
+    CHECK(u < n_ && v < n_);
+    return index_.query(u, v);
+  }
+
+  // 親を辿って答える. O(木の高さ)
+  weight_t query_by_walk(V u, V v) const {
     CHECK(u != v);
     CHECK(u < n_ && v < n_);
-    int ans = numeric_limits<int>::max();
+    weight_t ans = numeric_limits<weight_t>::max();
     while (u != v) {
       if (depth_[u] > depth_[v]) {
         ans = min(ans, parent_cost_[u].second);
@@ -247,7 +271,7 @@ public:
     return ans;
   }
 
-  const vector<pair<V, int>>& parent_weight() const {
+  const vector<pair<V, weight_t>>& parent_weight() const {
     return parent_cost_;
   }
 
@@ -310,20 +334,34 @@ public:
 private:
   int add_edge_count_;
   int n_;
-  vector<vector<tuple<V, int, int>>> edges_;
+  vector<vector<tuple<V, weight_t, int>>> edges_;
   vector<int> depth_;
-  vector<pair<V, int>> parent_cost_;
+  vector<pair<V, weight_t>> parent_cost_;
   vector<pair<V, V>> degree2_edges_;
+  bottleneck_query_index<weight_t> index_;
+  const weight_t upper_bound_;
 };
 
+// flow_t は maxflow を求める engine (bi_dinitz, boykov_kolmogorov, push_relabel). separator が使うのは
+//   cap_t, arc_t, reason_for_finishing_bfs_t (kQsIsEmpty, kQtIsEmpty, kReachedUpperBound)
+//   n(), edges(v), to(e), cap(e), rev(e)          残余グラフを辿る
+//   max_flow(s, t, upper_bound), reason_for_finishing_bfs()
+//     s 側 (kQsIsEmpty) か t 側 (kQtIsEmpty) から残余グラフを辿ると cut が求まる
+//   add_vertex(k), reconnect_edge(e, sside, tside), compact(new_id, new_n)   縮約と詰め直し
+//   goal_oriented_bfs_init(root)                  root に続けて流す前の準備 (何もしなくてもよい)
+// parallel_separate_all で複製するので、コピーできること
+template<class flow_t>
 class separator {
+  typedef typename flow_t::cap_t cap_t;
+  typedef basic_mincut_result<cap_t> mincut_result;
+  typedef basic_gomory_hu_tree_builder<cap_t> gomory_hu_tree_builder;
 
   const int used_flag_value() const {
     return max_flow_times_;
   }
 
   // 一定期間置きに進捗を出力する
-  void print_progress_at_regular_intervals(V s, V t, int cost) {
+  void print_progress_at_regular_intervals(V s, V t, cap_t cost) {
     if (max_flow_times_ % 10000 == 0) {
       stringstream ss;
       ss << "max_flow_times_ = " << max_flow_times_ << ", (" << s << "," << t << ") cost = " << cost;
@@ -335,16 +373,8 @@ class separator {
     }
   }
 
-  int max_flow(const V s, const V t) {
-    int cost = dz_.max_flow(s, t);
-    debug_last_max_flow_cost_ = cost;
-
-    // fprintf(stderr, "(%d,%d) : %d\n", s, t, cost);
-    //debug infomation
-
-    max_flow_times_++;
-    print_progress_at_regular_intervals(s, t, cost);
-
+  // 求めた mincut で disjoint_cut_set を分割し、gomory_hu treeの枝を登録する
+  void apply_cut(const mincut_result& cut) {
     cross_other_mincut_count_ = 0;
     auto check_crossed_mincut = [this](const V add) {
       if (add >= int(this->mincut_group_revision_.size())) return;
@@ -364,59 +394,51 @@ class separator {
     };
 
     //s側の頂点とt側の頂点に分類する
-    queue<int> q;
-    vector<V> vs;
-    const int F = used_flag_value();
-    int one_side = 0;
-    if (dz_.reason_for_finishing_bfs() == bi_dinitz::kQsIsEmpty) {
-      //s側に属する頂点の親を新しいgroupに移動する
-      q.push(s);
-      vs.emplace_back(s);
-      grouping_used_[s] = F;
-      dcs_->create_new_group(s);
-      while (!q.empty()) {
-        V v = q.front(); q.pop();
-        one_side++;
-        for (auto& e : dz_.edges(v)) {
-          const int cap = dz_.cap(e);
-          if (cap == 0 || grouping_used_[dz_.to(e)] == F) continue;
-          grouping_used_[dz_.to(e)] = F;
-          q.push(dz_.to(e));
-          vs.emplace_back(dz_.to(e));
-          if (dcs_->is_same_group(t, dz_.to(e))) {
-            dcs_->move_other_group(dz_.to(e), s); //tと同じgroupにいた頂点を、s側のgroupに移動
-          } else {
-            check_crossed_mincut(dz_.to(e));
-          }
-        }
-      }
-      gh_builder_->add_edge(s, t, cost, vs, dcs_);
-    } else {
-      //t側に属する頂点の親を,tに変更する
-      q.push(t);
-      vs.emplace_back(t);
-      grouping_used_[t] = F;
-      dcs_->create_new_group(t);
-      while (!q.empty()) {
-        V v = q.front(); q.pop();
-        one_side++;
-        for (auto& e : dz_.edges(v)) {
-          const int cap = dz_.cap(dz_.rev(e));
-          if (cap == 0 || grouping_used_[dz_.to(e)] == F) continue;
-          grouping_used_[dz_.to(e)] = F;
-          q.push(dz_.to(e));
-          vs.emplace_back(dz_.to(e));
-          if (dcs_->is_same_group(s, dz_.to(e))) {
-            dcs_->move_other_group(dz_.to(e), t); //sと同じgroupにいた頂点を、t側のgroupに移動
-          } else {
-            check_crossed_mincut(dz_.to(e));
-          }
-        }
+    //vs[0]側の頂点の親を新しいgroupに移動し、もう一方と同じgroupにいた頂点をvs[0]側のgroupに移動する
+    const V root = cut.vs[0];
+    const V other = root == cut.s ? cut.t : cut.s;
+    dcs_->create_new_group(root);
+    for (size_t i = 1; i < cut.vs.size(); i++) {
+      const V x = cut.vs[i];
+      if (dcs_->is_same_group(other, x)) {
+        dcs_->move_other_group(x, root);
+      } else {
+        check_crossed_mincut(x);
       }
-      gh_builder_->add_edge(t, s, cost, vs, dcs_);
     }
+    gh_builder_->add_edge(root, other, cut.cost, to_gh_vertices(cut.vs), dcs_);
+  }
+
+  // 残余グラフの頂点番号を gomory_hu_tree_builder の頂点番号に直す
+  // 元の頂点は同じ番号で、縮約で追加した頂点は compact で番号が詰められている
+  const vector<V>& to_gh_vertices(const vector<V>& vs) {
+    gh_vs_.resize(vs.size());
+    for (size_t i = 0; i < vs.size(); i++) {
+      gh_vs_[i] = vs[i] < num_original_vertices_ ? vs[i] : side_gh_id_[vs[i] - num_original_vertices_];
+    }
+    return gh_vs_;
+  }
+
+  // 戻り値は cut の vs[0] 側の頂点数. upper_bound_ で打ち切ったら 1
+  // uncross なら、他の group と交わる cut を uncross_cut で直してから反映する
+  // 反映した cut の vs[0] 側は last_cut_vs_ に残す (contraction で使う)
+  int max_flow(const V s, const V t, bool uncross = false) {
+    max_flow_times_++;
+    mincut_result cut;
+    bounded_mincut(dz_, s, t, upper_bound_, used_flag_value(), &grouping_used_, &cut);
+    debug_last_max_flow_cost_ = cut.cost;
+    if (uncross && dz_.reason_for_finishing_bfs() != flow_t::kReachedUpperBound && uncross_cut(dz_, *dcs_, &cut)) {
+      uncross_count_++;
+    }
+
+    // fprintf(stderr, "(%d,%d) : %d\n", s, t, cut.cost);
+    //debug infomation
 
-    return one_side;
+    print_progress_at_regular_intervals(s, t, cut.cost);
+
+    apply_cut(cut);
+    last_cut_vs_.swap(cut.vs);
+    return int(last_cut_vs_.size());
   }
 
   void contraction(const V s, const V t) {
@@ -425,67 +447,50 @@ class separator {
     //縮約後の頂点2つを追加する
     const int sside_new_vtx = dz_.n();
     const int tside_new_vtx = sside_new_vtx + 1;
-    for (int _ = 0; _ < 2; _++) {
-      dz_.add_vertex();
+
+    // cutの辺を集める. 縮約後の頂点に予約する辺の本数が分かってから、まとめてつなぎ直す
+    // (重み付きの場合は cut の辺の本数 != maxflow)
+    // cut の側は直前の max_flow で反映した last_cut_vs_ (uncross_cut で残余グラフから辿れる範囲と変わっていることがある)
+    cut_arcs_.clear();
+    const int F = used_flag_value();
+    const bool from_s = last_cut_vs_[0] == s;
+    for (V v : last_cut_vs_) contraction_used_[v] = F;
+    for (V v : last_cut_vs_) {
+      for (auto e : dz_.edges(v)) {
+        if (contraction_used_[dz_.to(e)] != F) cut_arcs_.push_back(e);
+      }
+    }
+
+    // gomory_hu_tree_builder では縮約の度に2頂点ずつ番号を振る
+    const V sside_gh_vtx = num_original_vertices_ + 2 * (contraction_count_ - 1);
+    for (int i = 0; i < 2; i++) {
+      dz_.add_vertex(int(cut_arcs_.size())); // 縮約後の頂点には、cutの辺がつなぎ直される
       grouping_used_.emplace_back();
       contraction_used_.emplace_back();
+      side_gh_id_.push_back(sside_gh_vtx + i);
     }
 
-    gh_builder_->contraction(s, t, sside_new_vtx, tside_new_vtx);
+    gh_builder_->contraction(s, t, sside_gh_vtx, sside_gh_vtx + 1);
 
-    queue<int> q;
-    const int F = used_flag_value();
-    int num_reconnected = 0; //枝を繋ぎ直した回数
-    if (dz_.reason_for_finishing_bfs() == bi_dinitz::kQsIsEmpty) {
-      q.push(s);
-      contraction_used_[s] = F;
-      while (!q.empty()) {
-        V v = q.front(); q.pop();
-        for (auto& e : dz_.edges(v)) {
-          const int cap = dz_.cap(e);
-          if (contraction_used_[dz_.to(e)] == F) continue;
-          if (cap == 0) {
-            if (grouping_used_[dz_.to(e)] != F) {
-              //辺を上手に張り替える
-              dz_.reconnect_edge(e, sside_new_vtx, tside_new_vtx);
-              num_reconnected++;
-            }
-          } else {
-            contraction_used_[dz_.to(e)] = F;
-            q.push(dz_.to(e));
-          }
-        }
-      }
-    } else {
-      q.push(t);
-      contraction_used_[t] = F;
-      while (!q.empty()) {
-        V v = q.front(); q.pop();
-        for (auto& e : dz_.edges(v)) {
-          const int cap = dz_.cap(dz_.rev(e));
-          if (contraction_used_[dz_.to(e)] == F) continue;
-          if (cap == 0) {
-            if (grouping_used_[dz_.to(e)] != F) {
-              //辺を上手に張り替える
-              dz_.reconnect_edge(e, tside_new_vtx, sside_new_vtx);
-              num_reconnected++;
-            }
-          } else {
-            contraction_used_[dz_.to(e)] = F;
-            q.push(dz_.to(e));
-          }
-        }
-      }
+    cap_t reconnected_cap = 0; // つなぎ直した辺の容量の和 * 2
+    for (auto e : cut_arcs_) {
+      reconnected_cap += dz_.cap(e) + dz_.cap(dz_.rev(e));
+      //辺を上手に張り替える
+      if (from_s) dz_.reconnect_edge(e, sside_new_vtx, tside_new_vtx);
+      else dz_.reconnect_edge(e, tside_new_vtx, sside_new_vtx);
     }
-    CHECK(num_reconnected == debug_last_max_flow_cost_); // 枝を繋ぎ直した回数 == maxflow
+    CHECK(is_eq(reconnected_cap, 2 * debug_last_max_flow_cost_)); // つなぎ直した辺の容量の和 == maxflow
   }
 
 public:
 
-  separator(bi_dinitz& dz, disjoint_cut_set* dcs, unique_ptr<gomory_hu_tree_builder>& gh_builder)
+  separator(flow_t& dz, disjoint_cut_set* dcs, unique_ptr<gomory_hu_tree_builder>& gh_builder)
     : dz_(dz), dcs_(dcs), gh_builder_(gh_builder),
-    max_flow_times_(0), contraction_count_(0), grouping_used_(dz.n()), contraction_used_(dz.n()),
-    mincut_group_counter_(dcs->node_num()), mincut_group_revision_(dcs->node_num()) {
+    max_flow_times_(0), contraction_count_(0), uncross_count_(0), grouping_used_(dz.n()), contraction_used_(dz.n()),
+    mincut_group_counter_(dcs->node_num()), mincut_group_revision_(dcs->node_num()),
+    num_original_vertices_(dz.n()), num_removed_original_vertices_(0), compaction_count_(0), next_compaction_check_(0), cut_cost_revision_(0),
+    upper_bound_(FLAGS_cut_tree_connectivity_bound > 0 ? cap_t(FLAGS_cut_tree_connectivity_bound) : numeric_limits<cap_t>::max()) {
+    for (V v = 0; v < num_original_vertices_; v++) live_vertices_.push_back(v);
   }
 
   void goal_oriented_bfs_init(const V goal) {
@@ -495,14 +500,15 @@ public:
   void mincut(V s, V t, bool enable_contraction = true) {
     if (dz_.edges(s).size() > dz_.edges(t).size()) swap(s, t);
 
-    const int one_side = max_flow(s, t);
+    const int one_side = max_flow(s, t, enable_contraction);
     if (enable_contraction) {
       const int other_side_estimated = dz_.n() - one_side;
       if (cross_other_mincut_count_ != 0) {
         fprintf(stderr, "(%d,%d) couldn't separate (crossed).\n", s, t);
       }
 
-      const bool contract = cross_other_mincut_count_ == 0 &&
+      // upper_bound_ で打ち切った時は cut が求まっていない
+      const bool contract = cross_other_mincut_count_ == 0 && dz_.reason_for_finishing_bfs() != flow_t::kReachedUpperBound &&
         min(one_side, other_side_estimated) >= FLAGS_cut_tree_contraction_lower_bound;
       if (contract) {
         contraction(s, t);
@@ -514,12 +520,118 @@ public:
     debug_count_cut_size_for_a_period_[one_side]++;
   }
 
+  // 別の残余グラフ上で求めた mincut を反映する (縮約は行わない)
+  void commit_cut(const mincut_result& cut) {
+    debug_last_max_flow_cost_ = cut.cost;
+    max_flow_times_++;
+    print_progress_at_regular_intervals(cut.s, cut.t, cut.cost);
+    apply_cut(cut);
+
+    const int one_side = int(cut.vs.size());
+    debug_count_cut_size_all_time_[one_side]++;
+    debug_count_cut_size_for_a_period_[one_side]++;
+  }
+
+  // side と残りの間の辺の容量の和
+  cap_t cut_cost(const vector<V>& side) {
+    const int F = ++cut_cost_revision_;
+    cut_cost_used_.resize(dz_.n());
+    for (V v : side) cut_cost_used_[v] = F;
+    cap_t cost = 0;
+    for (V v : side) {
+      for (auto e : dz_.edges(v)) {
+        // 無向辺なので、流した後でも両向きの残余の和は容量の2倍
+        if (cut_cost_used_[dz_.to(e)] != F) cost += dz_.cap(e) + dz_.cap(dz_.rev(e));
+      }
+    }
+    return cost / 2;
+  }
+
+  // side (s を含み t を含まない, 大きさ cost) が s-t の mincut かを、cost を上限に maxflow を流して確かめる
+  // cost だけ流れたら side をそのまま反映して true. 流れなければ、求まった mincut を反映して false
+  // 縮約は行わない
+  bool try_cut(V s, V t, const vector<V>& side, cap_t cost) {
+    CHECK(side[0] == s);
+    max_flow_times_++;
+    mincut_result cut;
+    bounded_mincut(dz_, s, t, min(cost, upper_bound_), used_flag_value(), &grouping_used_, &cut);
+    const bool verified = !(cut.cost < cost);
+    if (verified) cut.vs = side;
+    debug_last_max_flow_cost_ = cut.cost;
+    print_progress_at_regular_intervals(s, t, cut.cost);
+    apply_cut(cut);
+
+    const int one_side = int(cut.vs.size());
+    debug_count_cut_size_all_time_[one_side]++;
+    debug_count_cut_size_for_a_period_[one_side]++;
+    return verified;
+  }
+
+  // 縮約を繰り返すと、分割の終わった (group の大きさが全て 1 の) 連結成分が残余グラフに溜まっていく
+  // そのような頂点の割合が cut_tree_compaction_threshold を超えていたら、生きている連結成分だけを残して詰め直す
+  // 元の頂点の番号は変えず、取り除いた元の頂点は辺の無い頂点として残す. 縮約で追加した頂点は番号を詰める
+  // 辺のハンドルや縮約で追加した頂点の番号を持っていない所で呼ぶこと
+  void compact_if_needed() {
+    if (FLAGS_cut_tree_compaction_threshold <= 0 || max_flow_times_ < next_compaction_check_) return;
+
+    // 大きさ 2 以上の group を含む連結成分を辿る. 一度分割の終わった連結成分が生き返ることはないので、
+    // 前回生きていた元の頂点からだけ辿ればよい
+    const int n = dz_.n();
+    vector<char> live(n);
+    vector<V> q, next_live_vertices;
+    for (V s : live_vertices_) {
+      if (live[s] || dcs_->group_size(dcs_->group_id(s)) < 2) continue;
+      live[s] = true;
+      q.assign(1, s);
+      for (size_t i = 0; i < q.size(); i++) {
+        const V v = q[i];
+        if (v < num_original_vertices_) next_live_vertices.push_back(v);
+        for (auto e : dz_.edges(v)) {
+          if (live[dz_.to(e)]) continue;
+          live[dz_.to(e)] = true;
+          q.push_back(dz_.to(e));
+        }
+      }
+    }
+    live_vertices_.swap(next_live_vertices);
+
+    int num_live = 0;
+    for (V v = 0; v < n; v++) num_live += live[v];
+    // 次に調べるのは、生きている頂点数に比例した回数の maxflow の後 (調べる手間を maxflow 1回あたり定数に抑える)
+    next_compaction_check_ = max_flow_times_ + max(1, int(FLAGS_cut_tree_compaction_threshold * num_live));
+    // 前回までに取り除いた元の頂点は数えない
+    // 生きている頂点が無ければもう maxflow は流さないので、詰め直すだけ無駄
+    const int num_dead = n - num_live - num_removed_original_vertices_;
+    if (num_live == 0 || num_dead < FLAGS_cut_tree_compaction_threshold * (n - num_removed_original_vertices_)) return;
+
+    vector<int> new_id(n, -1);
+    vector<V> side_gh_id;
+    for (V v = 0; v < num_original_vertices_; v++) {
+      if (live[v]) new_id[v] = v;
+    }
+    for (V v = num_original_vertices_; v < n; v++) {
+      if (!live[v]) continue;
+      new_id[v] = num_original_vertices_ + int(side_gh_id.size());
+      side_gh_id.push_back(side_gh_id_[v - num_original_vertices_]);
+    }
+    const int new_n = num_original_vertices_ + int(side_gh_id.size());
+    num_removed_original_vertices_ = num_original_vertices_ - int(live_vertices_.size());
+    dz_.compact(new_id, new_n);
+    side_gh_id_.swap(side_gh_id);
+    // 使用済みの印 (max_flow_times_ 以下) は次の maxflow 以降の印と被らない
+    grouping_used_.assign(new_n, 0);
+    contraction_used_.assign(new_n, 0);
+    compaction_count_++;
+  }
+
   void output_debug_infomation() const {
     if (debug_count_cut_size_all_time_.size() > 10) {
       stringstream ss;
       for (auto& kv : debug_count_cut_size_all_time_) ss << "(" << kv.first << "," << kv.second << "), ";
       JLOG_ADD("separator.debug_count_cut_size_all_time_", ss.str());
       JLOG_ADD("separator.contraction_count", contraction_count_);
+      JLOG_ADD("separator.uncross_count", uncross_count_);
+      JLOG_ADD("separator.compaction_count", compaction_count_);
     }
   }
 
@@ -541,19 +653,24 @@ public:
     if (dcs_->node_num() > 10000) fprintf(stderr, "OK\n");
   }
 
-  const bi_dinitz& get_bi_dinitz() const { return dz_; }
+  const flow_t& get_bi_dinitz() const { return dz_; }
   const disjoint_cut_set* get_disjoint_cut_set() const { return dcs_; }
 
   const int contraction_count() { return contraction_count_; }
+  cap_t last_max_flow_cost() const { return debug_last_max_flow_cost_; }
+  const int compaction_count() { return compaction_count_; }
+  cap_t upper_bound() const { return upper_bound_; }
 
 private:
 
-  bi_dinitz& dz_;
+  flow_t& dz_;
   disjoint_cut_set* dcs_;
   unique_ptr<gomory_hu_tree_builder>& gh_builder_;
 
   int max_flow_times_; //maxflowを流した回数
   int contraction_count_; // contractionが呼ばれた回数
+  int uncross_count_; // uncross_cut で交わらない cut に直した回数
+  vector<V> last_cut_vs_; // 直前の max_flow で反映した cut の vs[0] 側
   vector<int> grouping_used_; // 'maxflowを流した後、mincutを求めるbfs'で使うused
   vector<int> contraction_used_; // 'mincutを元に、頂点縮約を行うbfs'で使うused
 
@@ -563,12 +680,25 @@ private:
 
   map<int, int> debug_count_cut_size_all_time_;
   map<int, int> debug_count_cut_size_for_a_period_;
-  int debug_last_max_flow_cost_;
+  cap_t debug_last_max_flow_cost_;
+  vector<typename flow_t::arc_t> cut_arcs_; // 縮約でつなぎ直す辺
+
+  const int num_original_vertices_;
+  int num_removed_original_vertices_; // compact で辺を取り除いた元の頂点の数
+  vector<V> side_gh_id_; // 縮約で追加した頂点 (num_original_vertices_ + i) の gomory_hu_tree_builder での番号
+  vector<V> gh_vs_; // to_gh_vertices の結果
+  int compaction_count_;
+  int next_compaction_check_; // max_flow_times_ がこれに達したら compact_if_needed で調べる
+  vector<V> live_vertices_; // 前回の compact_if_needed で生きていた連結成分の元の頂点
+  vector<int> cut_cost_used_; // cut_cost で side の頂点に付ける印
+  int cut_cost_revision_;
+  const cap_t upper_bound_; // maxflow をこれ以上流さない (cut_tree_connectivity_bound)
 };
 } // cut_tree_internal
 
 //class cut_tree_with_2ecc
-void cut_tree_with_2ecc::find_cuts_by_tree_packing(vector<pair<V, V>>& edges, disjoint_cut_set* dcs, const vector<int>& degree) {
+template<class edge_t>
+void basic_cut_tree_with_2ecc<edge_t>::find_cuts_by_tree_packing(vector<pair<V, V>>& edges, disjoint_cut_set* dcs, const vector<int>& degree) {
   vector<int> current_parent(num_vertices_, -1);
   vector<int> current_weight(num_vertices_, -1);
   greedy_treepacking packing_base(edges, num_vertices_);
@@ -592,7 +722,7 @@ void cut_tree_with_2ecc::find_cuts_by_tree_packing(vector<pair<V, V>>& edges, di
     if (degree[v] == 2) set_solved(v, temp_root, 2); //二重連結成分分解後なので自明なcut
   }
 
-  if (FLAGS_cut_tree_enable_greedy_tree_packing) {
+  if (plan_.greedy_tree_packing) {
     //次数の高い頂点から順に、 一定回数 greedy tree packingを行って、flowの下界を求める
     const int iteration = min(FLAGS_cut_tree_try_greedy_tree_packing, num_vertices_);
     vector<int> idx(num_vertices_);
@@ -601,24 +731,44 @@ void cut_tree_with_2ecc::find_cuts_by_tree_packing(vector<pair<V, V>>& edges, di
       return degree[l] > degree[r];
     });
 
-    for (int trying = 0; trying < iteration; trying++) {
-      const V v = idx[trying];
-      if (degree[v] == 2) continue; // 自明なcutがある
+    // 上限があれば、その本数だけ詰めれば上限以上つながっているかが分かる
+    const int bound = FLAGS_cut_tree_connectivity_bound;
+    auto is_solved_by_packing = [&degree, bound](int inedge_count, V to) {
+      //tree packingの結果がdegreeと一致するか上限に達したなら、flowは流さなくてよい
+      return inedge_count == degree[to] || (bound > 0 && inedge_count >= bound);
+    };
 
-      //debug infomation
-      auto packing = packing_base;
-      packing.arborescence_packing(v);
+    // 根を num_threads 個ずつ別々のスレッドで詰め、結果は直列と同じ根の順に反映する
+    // packing はスレッド毎に1つを使い回す (arborescence_packing は前の結果を触った頂点だけ戻す)
+    const int num_threads = max(1, min(resolve_num_threads(FLAGS_cut_tree_tree_packing_threads), iteration));
+    vector<unique_ptr<greedy_treepacking>> packing_copies(num_threads);
+    for (int i = 1; i < num_threads; i++) packing_copies[i].reset(new greedy_treepacking(packing_base));
+    vector<vector<pair<V, int>>> solved(num_threads); // 根 idx[begin + i] の packing で flow が要らなくなった頂点と in-edge の本数
+    for (int begin = 0; begin < iteration; begin += num_threads) {
+      const int end = min(iteration, begin + num_threads);
+      parallel_for(end - begin, num_threads, [&](int i, int thread_id) {
+        const V v = idx[begin + i];
+        solved[i].clear();
+        if (degree[v] == 2) return; // 自明なcutがある
+
+        greedy_treepacking& packing = thread_id == 0 ? packing_base : *packing_copies[thread_id];
+        packing.arborescence_packing(v, bound > 0 ? bound : numeric_limits<int>::max());
+        for (int to = 0; to < num_vertices_; to++) {
+          const int count = packing.inedge_count(to);
+          if (to != v && is_solved_by_packing(count, to)) solved[i].emplace_back(to, count);
+        }
+      });
 
-      if (current_parent[v] != -1) {
-        current_parent[v] = v; // 閉路が出来上がるのを防ぐために、親を自分自身であると登録しておく
-      }
-      for (int to = 0; to < num_vertices_; to++) {
-        if (to == v) continue;
-        if (current_parent[to] != -1) continue;
-        //tree packingの結果がdegreeと一致するなら、flowは流さなくてよい
-        if (packing.inedge_count(to) == degree[to]) {
-          set_solved(to, v, packing.inedge_count(to));
-          // fprintf(stderr, "(%d, %d), cost = %d\n",v, to, packing.inedge_count(to));
+      for (int i = 0; i < end - begin; i++) {
+        const V v = idx[begin + i];
+        if (degree[v] == 2) continue;
+        if (current_parent[v] != -1) {
+          current_parent[v] = v; // 閉路が出来上がるのを防ぐために、親を自分自身であると登録しておく
+        }
+        for (auto& tc : solved[i]) {
+          if (current_parent[tc.first] != -1) continue;
+          set_solved(tc.first, v, tc.second);
+          // fprintf(stderr, "(%d, %d), cost = %d\n",v, tc.first, tc.second);
         }
       }
     }
@@ -655,7 +805,8 @@ void cut_tree_with_2ecc::find_cuts_by_tree_packing(vector<pair<V, V>>& edges, di
   }
 }
 
-void cut_tree_with_2ecc::contract_degree2_vertices(vector<pair<V, V>>& edges, vector<int>& degree) {
+template<class edge_t>
+void basic_cut_tree_with_2ecc<edge_t>::contract_degree2_vertices(vector<pair<V, V>>& edges, vector<int>& degree) {
   const int n = int(degree.size());
   vector<vector<int>> e(n);
 
@@ -708,9 +859,11 @@ void cut_tree_with_2ecc::contract_degree2_vertices(vector<pair<V, V>>& edges, ve
 }
 
 //次数の大きい頂点対をcutする
-void cut_tree_with_2ecc::separate_high_degreepairs(separator* sep) {
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::separate_high_degreepairs(separator<flow_t>* sep) {
   const disjoint_cut_set* dcs = sep->get_disjoint_cut_set();
-  const bi_dinitz& dz = sep->get_bi_dinitz();
+  const flow_t& dz = sep->get_bi_dinitz();
 
   vector<int> vtxs;
   for (int v = 0; v < num_vertices_; v++) {
@@ -731,6 +884,7 @@ void cut_tree_with_2ecc::separate_high_degreepairs(separator* sep) {
       cut_large_degreecount++;
     }
   }
+  sep->compact_if_needed();
 
   if (cut_large_degreecount > 0) {
     JLOG_PUT("separate_high_degreepairs.cut_large_degreecount", cut_large_degreecount);
@@ -739,8 +893,10 @@ void cut_tree_with_2ecc::separate_high_degreepairs(separator* sep) {
 }
 
 //隣接頂点同士を見て、まだ切れていなかったらcutする
-void cut_tree_with_2ecc::separate_adjacent_pairs(separator* sep) {
-  const bi_dinitz& dz = sep->get_bi_dinitz();
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::separate_adjacent_pairs(separator<flow_t>* sep) {
+  const flow_t& dz = sep->get_bi_dinitz();
   const disjoint_cut_set* dcs = sep->get_disjoint_cut_set();
 
   for (int s = 0; s < num_vertices_; s++) {
@@ -749,22 +905,36 @@ void cut_tree_with_2ecc::separate_adjacent_pairs(separator* sep) {
       if (!dcs->is_same_group(s, t)) continue;
       sep->mincut(s, t);
     }
+    sep->compact_if_needed();
   }
 }
 
-void cut_tree_with_2ecc::separate_all(separator* sep) {
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::separate_all(separator<flow_t>* sep) {
   const disjoint_cut_set* dcs = sep->get_disjoint_cut_set();
+  if (FLAGS_cut_tree_separate_all_threads >= 0) {
+    // 1 スレッドでも同じ木になるように、スレッド数を指定したら常にこちらを使う
+    const int num_threads = resolve_num_threads(FLAGS_cut_tree_separate_all_threads);
+    // 複製する前に詰めておく
+    sep->compact_if_needed();
+    parallel_separate_all(sep, sep->get_bi_dinitz(), *dcs, num_vertices_, num_threads, sep->upper_bound());
+    return;
+  }
   for (int group_id = 0; group_id < num_vertices_; group_id++) {
     while (dcs->has_two_elements(group_id)) {
       V s, t; tie(s, t) = dcs->get_two_elements(group_id);
       sep->mincut(s, t);
+      sep->compact_if_needed();
     }
   }
 }
 
-void cut_tree_with_2ecc::separate_near_pairs(separator* sep) {
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::separate_near_pairs(separator<flow_t>* sep) {
   const disjoint_cut_set* dcs = sep->get_disjoint_cut_set();
-  const bi_dinitz& dz = sep->get_bi_dinitz();
+  const flow_t& dz = sep->get_bi_dinitz();
 
   vector<int> used(num_vertices_ * 2, -1);
   int used_revision = 0;
@@ -778,7 +948,7 @@ void cut_tree_with_2ecc::separate_near_pairs(separator* sep) {
       const int loop_num = int(q.size());
       for (int _ = 0; _ < loop_num; _++) {
         const V v = q.front(); q.pop();
-        for (auto& to_edge : dz.edges(v)) {
+        for (auto to_edge : dz.edges(v)) {
           const V t = dz.to(to_edge);
           if (used[t] == used_revision) continue;
           used[t] = used_revision;
@@ -791,55 +961,299 @@ void cut_tree_with_2ecc::separate_near_pairs(separator* sep) {
       }
     }
     used_revision++;
+    sep->compact_if_needed();
   }
 }
 
-//次数の最も高い頂点に対して、出来る限りの頂点からflowを流してmincutを求める
-void cut_tree_with_2ecc::find_cuts_by_goal_oriented_search(separator* sep) {
-  const bi_dinitz& dz = sep->get_bi_dinitz();
+//次数の高い頂点 (hub) に対して、出来る限りの頂点からflowを流してmincutを求める
+//hub は次数の高い順に、既に選んだ hub から cut_tree_goal_oriented_hub_distance 以上離れたものを選ぶ
+//各頂点はまず一番近い hub に流し、最後に最初の hub へ、まだ分かれていない全ての頂点から流す
+//bfs の深さは hub 毎に goal_oriented_bfs_init で作り直すので、同時に持つのは1つ分 (O(n) の追加メモリ)
+//作り直しは bfs と辺の並べ替え (比較しない) で O(n + m). landmark の下界は使わず、深さだけで枝刈りする
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::find_cuts_by_goal_oriented_search(separator<flow_t>* sep) {
+  const flow_t& dz = sep->get_bi_dinitz();
   const disjoint_cut_set* dcs = sep->get_disjoint_cut_set();
 
   int max_degreevtx = 0;
   for (int v = 0; v < num_vertices_; v++)
     if (dz.edges(max_degreevtx).size() < dz.edges(v).size()) max_degreevtx = v;
 
-  sep->goal_oriented_bfs_init(max_degreevtx);
-  for (int v = 0; v < num_vertices_; v++) {
-    if (v == max_degreevtx) continue;
-    if (!dcs->is_same_group(v, max_degreevtx)) continue;
-    //graphの形状が変わると損なので、ここでは enable_contraction = false する
-    sep->mincut(v, max_degreevtx, false);
+  vector<V> hubs;
+  vector<int> nearest_hub(num_vertices_, 0);
+  const int max_hubs = min(plan_.goal_oriented_hubs, num_vertices_);
+  if (max_hubs <= 1) {
+    hubs.push_back(max_degreevtx);
+  } else {
+    // hub を足す度に、その hub からの bfs で近くなった頂点をその hub に付け替える
+    vector<int> hub_depth(num_vertices_, num_vertices_);
+    vector<V> q;
+    auto add_hub = [&](V h) {
+      const int k = int(hubs.size());
+      hubs.push_back(h);
+      hub_depth[h] = 0;
+      nearest_hub[h] = k;
+      q.assign(1, h);
+      for (size_t i = 0; i < q.size(); i++) {
+        const V v = q[i];
+        for (auto e : dz.edges(v)) {
+          const V to = dz.to(e);
+          if (hub_depth[to] <= hub_depth[v] + 1) continue;
+          hub_depth[to] = hub_depth[v] + 1;
+          nearest_hub[to] = k;
+          q.push_back(to);
+        }
+      }
+    };
+    add_hub(max_degreevtx);
+
+    vector<V> candidates(num_vertices_);
+    for (V v = 0; v < num_vertices_; v++) candidates[v] = v;
+    sort(candidates.begin(), candidates.end(), [&dz](V l, V r) {
+      return dz.edges(l).size() > dz.edges(r).size();
+    });
+    for (V h : candidates) {
+      if (int(hubs.size()) >= max_hubs || int(dz.edges(h).size()) < plan_.goal_oriented_hub_min_degree) break;
+      if (hub_depth[h] >= FLAGS_cut_tree_goal_oriented_hub_distance) add_hub(h);
+    }
+  }
+  if (num_vertices_ > 10000) JLOG_ADD("goal_oriented_search.num_hubs", hubs.size());
+
+  // 最初の hub は最後に、残った全ての頂点から流す
+  for (int k = int(hubs.size()) - 1; k >= 0; k--) {
+    const V hub = hubs[k];
+    sep->goal_oriented_bfs_init(hub);
+    for (int v = 0; v < num_vertices_; v++) {
+      if (v == hub) continue;
+      if (k > 0 && nearest_hub[v] != k) continue;
+      if (!dcs->is_same_group(v, hub)) continue;
+      //graphの形状が変わると損なので、ここでは enable_contraction = false する
+      sep->mincut(v, hub, false);
+    }
   }
 }
 
-cut_tree_with_2ecc::cut_tree_with_2ecc(vector<pair<V, V>>&& edges, int num_vs) :
-  num_vertices_(num_vs),
-  gh_builder_(new gomory_hu_tree_builder(num_vs)) {
-  vector<int> degree(num_vertices_);
-  for (auto& e : edges) degree[e.first]++, degree[e.second]++;
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::find_cuts_by_hint(separator<flow_t>* sep) {
+  const disjoint_cut_set* dcs = sep->get_disjoint_cut_set();
+  const flow_t& dz = sep->get_bi_dinitz();
+  const int n = num_vertices_;
+  CHECK(int(hint_parent_.size()) == n);
+  // hint の頂点をそのまま残余グラフの頂点として使うので、縮約 (頂点の追加) の前でなければならない
+  // (compact は元の頂点の番号を変えない)
+  CHECK_MSG(sep->contraction_count() == 0, "find_cuts_by_hint must run before any contraction");
+
+  // hint の森の行きがけ順. 部分木は order の連続した区間になる
+  vector<int> offset(n + 1), children(n);
+  for (V v = 0; v < n; v++) if (hint_parent_[v] != -1) offset[hint_parent_[v] + 1]++;
+  for (V v = 0; v < n; v++) offset[v + 1] += offset[v];
+  {
+    vector<int> pos(offset.begin(), offset.end() - 1);
+    for (V v = 0; v < n; v++) if (hint_parent_[v] != -1) children[pos[hint_parent_[v]]++] = v;
+  }
+  vector<V> order, stack;
+  vector<int> pre(n, -1), subtree_size(n, 1);
+  for (V r = 0; r < n; r++) {
+    if (hint_parent_[r] != -1) continue;
+    stack.assign(1, r);
+    while (!stack.empty()) {
+      const V v = stack.back(); stack.pop_back();
+      pre[v] = int(order.size());
+      order.push_back(v);
+      for (int i = offset[v]; i < offset[v + 1]; i++) stack.push_back(children[i]);
+    }
+  }
+  CHECK(int(order.size()) == n);
+  for (int i = n - 1; i >= 0; i--) {
+    const V v = order[i];
+    if (hint_parent_[v] != -1) subtree_size[hint_parent_[v]] += subtree_size[v];
+  }
 
-  //次数2の頂点と接続を持つ辺を削除して、探索しやすくする
-  JLOG_ADD_BENCHMARK_IF("time.contract_degree2_vertices", num_vertices_ > 10000) {
-    contract_degree2_vertices(edges, degree);
+  // 木の辺 (v, 親) の cut の小さい側を side とする. 次数2の縮約で辺の無くなった頂点は入れない
+  // cut の大きさが端点の次数より大きければ mincut ではないので、流さずに捨てる
+  int verified = 0, rejected_by_cost = 0, invalidated = 0;
+  vector<V> side;
+  for (int i = n - 1; i >= 0; i--) {
+    const V v = order[i], p = hint_parent_[v];
+    if (p == -1 || !dcs->is_same_group(v, p)) continue;
+    if (dz.edges(v).size() == 0 || dz.edges(p).size() == 0) continue;
+    const int begin = pre[v], end = pre[v] + subtree_size[v];
+    side.clear();
+    auto add_range = [&](int l, int r) {
+      for (int j = l; j < r; j++) {
+        if (order[j] != p && dz.edges(order[j]).size() > 0) side.push_back(order[j]);
+      }
+    };
+    if (subtree_size[v] <= n - subtree_size[v]) {
+      add_range(begin, end);
+    } else {
+      side.push_back(p);
+      add_range(0, begin);
+      add_range(end, n);
+    }
+    const V s = side[0], t = s == v ? p : v;
+    const auto cost = sep->cut_cost(side);
+    if (cost > min(sep->cut_cost(vector<V>(1, s)), sep->cut_cost(vector<V>(1, t)))) {
+      rejected_by_cost++;
+      continue;
+    }
+    if (sep->try_cut(s, t, side, cost)) verified++;
+    else invalidated++;
   }
+  hint_parent_.clear(); hint_parent_.shrink_to_fit();
 
-  unique_ptr<disjoint_cut_set> dcs(new disjoint_cut_set(num_vs));
+  if (num_vertices_ > 10000) {
+    JLOG_OPEN("hint") {
+      JLOG_ADD("num_vs", num_vertices_);
+      JLOG_ADD("verified", verified);
+      JLOG_ADD("rejected_by_cost", rejected_by_cost);
+      JLOG_ADD("invalidated", invalidated);
+    }
+  }
+}
 
-  JLOG_ADD_BENCHMARK_IF("time.find_cuts_by_tree_packing", num_vertices_ > 10000) {
-    find_cuts_by_tree_packing(edges, dcs.get(), degree);
+// 小さな成分は数える方が高くつくので、gflags のまま
+static const int kMinAutotuneVertices = 1000;
+
+// 平均次数が高いと、tree packing で分かる cut は goal oriented search ですぐ求まるので packing の方が損になる
+template<class edge_t>
+void basic_cut_tree_with_2ecc<edge_t>::plan_preprocessing(const vector<int>& degree) {
+  int64_t sum_degree = 0;
+  for (int d : degree) sum_degree += d;
+  plan_.input_average_degree = num_vertices_ > 0 ? double(sum_degree) / num_vertices_ : 0;
+  if (!FLAGS_cut_tree_autotune || num_vertices_ < kMinAutotuneVertices) return;
+
+  const double kMaxTreePackingAverageDegree = 20;
+  if (plan_.input_average_degree >= kMaxTreePackingAverageDegree) plan_.greedy_tree_packing = false;
+}
+
+// 残余グラフを作った後の段階を決める
+//   次数最大の頂点 (最初の hub) からの bfs の深さの平均が log2(頂点数) に比べて大きければ (格子のようなグラフ)、
+//   hub まで流すと増加路が長くなるので goal oriented search をせず、隣接頂点対から求める
+//   そうでなければ、次の hub の候補から最初の hub へ maxflow を流して (そのまま cut として使う) 、
+//   候補の次数より小さい cut で止められた割合を見る. 次数の高い頂点同士が疎な cut で分かれている
+//   (塊が疎につながっている) なら、塊毎に hub を置いた方が増加路が短くなるので hub を増やす
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::plan_max_flow_phases(separator<flow_t>* sep) {
+  typedef typename flow_t::cap_t cap_t;
+  if (!FLAGS_cut_tree_autotune || num_vertices_ < kMinAutotuneVertices) return;
+
+  const flow_t& dz = sep->get_bi_dinitz();
+  const disjoint_cut_set* dcs = sep->get_disjoint_cut_set();
+  int num_live = 0, num_unresolved = 0;
+  int64_t sum_degree = 0;
+  V hub = 0;
+  for (V v = 0; v < num_vertices_; v++) {
+    const int d = int(dz.edges(v).size());
+    if (d == 0) continue;
+    num_live++;
+    sum_degree += d;
+    if (dz.edges(hub).size() < dz.edges(v).size()) hub = v;
+    if (dcs->group_size(dcs->group_id(v)) >= 2) num_unresolved++;
+  }
+  const double average_degree = num_live > 0 ? double(sum_degree) / num_live : 0;
+
+  vector<int> depth(dz.n(), -1);
+  double average_depth = 0;
+  if (num_live > 0) {
+    vector<V> q(1, hub);
+    depth[hub] = 0;
+    int64_t sum_depth = 0;
+    for (size_t i = 0; i < q.size(); i++) {
+      const V v = q[i];
+      sum_depth += depth[v];
+      for (auto e : dz.edges(v)) {
+        const V to = dz.to(e);
+        if (depth[to] != -1) continue;
+        depth[to] = depth[v] + 1;
+        q.push_back(to);
+      }
+    }
+    average_depth = double(sum_depth) / q.size();
+  }
+  const double kMaxDepthPerLog = 2;
+  const bool lattice = average_depth > kMaxDepthPerLog * log2(max(num_live, 2));
+
+  int num_samples = 0, num_stopped = 0;
+  if (plan_.goal_oriented_search && lattice) {
+    plan_.goal_oriented_search = false;
+  } else if (plan_.goal_oriented_search && num_unresolved > 0) {
+    // hub の候補 (次数の高い順に、最初の hub から cut_tree_goal_oriented_hub_distance 以上離れた頂点) から流す
+    const int kNumSamples = 16;
+    vector<V> candidates;
+    for (V v = 0; v < num_vertices_; v++) {
+      if (depth[v] >= FLAGS_cut_tree_goal_oriented_hub_distance) candidates.push_back(v);
+    }
+    const size_t num_candidates = min(candidates.size(), size_t(kNumSamples));
+    partial_sort(candidates.begin(), candidates.begin() + num_candidates, candidates.end(), [&dz](V l, V r) {
+      return dz.edges(l).size() != dz.edges(r).size() ? dz.edges(l).size() > dz.edges(r).size() : l < r;
+    });
+    sep->goal_oriented_bfs_init(hub);
+    for (size_t i = 0; i < num_candidates; i++) {
+      const V v = candidates[i];
+      num_samples++;
+      // 前処理で既に hub と分かれていれば、疎な cut で止められたとみなす
+      if (!dcs->is_same_group(v, hub)) {
+        num_stopped++;
+        continue;
+      }
+      const cap_t degree = sep->cut_cost(vector<V>(1, v));
+      sep->mincut(v, hub, false);
+      if (is_lt(sep->last_max_flow_cost(), min(degree, sep->upper_bound()))) num_stopped++;
+    }
+    const double stopped = num_samples > 0 ? double(num_stopped) / num_samples : 0;
+    const double kMinStoppedFraction = 0.25;
+    const int kMaxHubs = 16;
+    if (stopped >= kMinStoppedFraction) {
+      // 止められた候補はそれぞれ別の塊にいるとみなし、その数を上限 kMaxHubs まで hub にする
+      plan_.goal_oriented_hubs = min(kMaxHubs, 1 + num_stopped);
+      plan_.goal_oriented_hub_min_degree = max(3, int(ceil(average_degree)));
+    }
   }
 
-  //dinicの初期化
-  bi_dinitz dz_base(std::move(edges), num_vs);
+  JLOG_OPEN("autotune") {
+    JLOG_ADD("num_vs", num_vertices_);
+    JLOG_ADD("input_average_degree", plan_.input_average_degree);
+    JLOG_ADD("greedy_tree_packing", plan_.greedy_tree_packing);
+    JLOG_ADD("num_live_vs", num_live);
+    JLOG_ADD("num_unresolved_vs", num_unresolved);
+    JLOG_ADD("average_degree", average_degree);
+    JLOG_ADD("average_depth", average_depth);
+    JLOG_ADD("num_samples", num_samples);
+    JLOG_ADD("num_stopped_samples", num_stopped);
+    JLOG_ADD("goal_oriented_search", plan_.goal_oriented_search);
+    JLOG_ADD("goal_oriented_hubs", plan_.goal_oriented_hubs);
+    JLOG_ADD("goal_oriented_hub_min_degree", plan_.goal_oriented_hub_min_degree);
+  }
+}
 
-  separator sep(dz_base, dcs.get(), gh_builder_);
+template<class edge_t>
+template<class flow_t>
+void basic_cut_tree_with_2ecc<edge_t>::find_cuts_by_max_flow(edge_list_type&& edges, disjoint_cut_set* dcs) {
+  flow_t dz_base(std::move(edges), num_vertices_);
 
-  if (FLAGS_cut_tree_enable_goal_oriented_search) {
+  separator<flow_t> sep(dz_base, dcs, gh_builder_);
+
+  JLOG_ADD_BENCHMARK_IF("time.plan_max_flow_phases", num_vertices_ > 10000) {
+    plan_max_flow_phases(&sep);
+  }
+
+  if (plan_.goal_oriented_search) {
     JLOG_ADD_BENCHMARK_IF("time.find_cuts_by_goal_oriented_search", num_vertices_ > 10000) {
       find_cuts_by_goal_oriented_search(&sep);
     }
   }
 
+  // 前の木の辺のうち、ここまでで分かれていないものの cut を確かめて使う
+  if (!hint_parent_.empty()) {
+    JLOG_ADD_BENCHMARK_IF("time.find_cuts_by_hint", num_vertices_ > 10000) {
+      find_cuts_by_hint(&sep);
+    }
+  }
+
   // 次数の高い頂点対をcutする
   // グラフをなるべく2分するcutを見つけられると有用
   JLOG_ADD_BENCHMARK_IF("time.separate_high_degreepairs", num_vertices_ > 10000) {
@@ -868,17 +1282,115 @@ cut_tree_with_2ecc::cut_tree_with_2ecc(vector<pair<V, V>>&& edges, int num_vs) :
   }
 
   sep.output_debug_infomation();
+}
+
+// 重み付きの残余グラフは aos のみ. push_relabel は容量1専用なので、auto なら bi_dinitz にする
+template<class edge_t>
+void basic_cut_tree_with_2ecc<edge_t>::find_remaining_cuts(edge_list_type&& edges, disjoint_cut_set* dcs) {
+  if (FLAGS_cut_tree_flow_engine == "bi_dinitz" || FLAGS_cut_tree_flow_engine == "auto") {
+    find_cuts_by_max_flow<weighted_bi_dinitz<W>>(std::move(edges), dcs);
+  } else if (FLAGS_cut_tree_flow_engine == "boykov_kolmogorov") {
+    find_cuts_by_max_flow<weighted_boykov_kolmogorov<W>>(std::move(edges), dcs);
+  } else if (FLAGS_cut_tree_flow_engine == "push_relabel") {
+    FAIL_MSG("push_relabel supports unit capacities only");
+  } else {
+    FAIL_MSG("unknown cut_tree_flow_engine: " + FLAGS_cut_tree_flow_engine);
+  }
+}
+
+// auto なら成分毎に選ぶ. 平均次数が高ければ push_relabel、そうでなければ bi_dinitz
+template<>
+void basic_cut_tree_with_2ecc<unweighted_edge>::find_remaining_cuts(edge_list_type&& edges, disjoint_cut_set* dcs) {
+  if (FLAGS_cut_tree_residual_graph_layout != "aos" && FLAGS_cut_tree_residual_graph_layout != "soa") {
+    FAIL_MSG("unknown cut_tree_residual_graph_layout: " + FLAGS_cut_tree_residual_graph_layout);
+  }
+  const bool aos = FLAGS_cut_tree_residual_graph_layout == "aos";
+  string engine = FLAGS_cut_tree_flow_engine;
+  if (engine == "auto") {
+    const double average_degree = num_vertices_ > 0 ? 2.0 * edges.size() / num_vertices_ : 0;
+    engine = average_degree >= FLAGS_cut_tree_push_relabel_min_average_degree ? "push_relabel" : "bi_dinitz";
+  }
+  if (engine == "bi_dinitz") {
+    if (aos) find_cuts_by_max_flow<bi_dinitz>(std::move(edges), dcs);
+    else find_cuts_by_max_flow<soa_bi_dinitz>(std::move(edges), dcs);
+  } else if (engine == "boykov_kolmogorov") {
+    if (aos) find_cuts_by_max_flow<boykov_kolmogorov>(std::move(edges), dcs);
+    else find_cuts_by_max_flow<soa_boykov_kolmogorov>(std::move(edges), dcs);
+  } else if (engine == "push_relabel") {
+    if (aos) find_cuts_by_max_flow<push_relabel>(std::move(edges), dcs);
+    else find_cuts_by_max_flow<soa_push_relabel>(std::move(edges), dcs);
+  } else {
+    FAIL_MSG("unknown cut_tree_flow_engine: " + engine);
+  }
+}
+
+template<class edge_t>
+void basic_cut_tree_with_2ecc<edge_t>::find_cuts_by_unit_capacity_preprocessing(edge_list_type&, disjoint_cut_set*) {}
+
+template<>
+void basic_cut_tree_with_2ecc<unweighted_edge>::find_cuts_by_unit_capacity_preprocessing(edge_list_type& edges, disjoint_cut_set* dcs) {
+  // 2辺連結成分毎に作るので、1 で頭打ちにすると全て 1 になってしまう (two_edge_cc_filter も重み 2 以上を仮定している)
+  CHECK_MSG(FLAGS_cut_tree_connectivity_bound != 1, "cut_tree_connectivity_bound must be 0 or at least 2");
+  vector<int> degree(num_vertices_);
+  for (auto& e : edges) degree[e.first]++, degree[e.second]++;
+  plan_preprocessing(degree);
+
+  //次数2の頂点と接続を持つ辺を削除して、探索しやすくする
+  JLOG_ADD_BENCHMARK_IF("time.contract_degree2_vertices", num_vertices_ > 10000) {
+    contract_degree2_vertices(edges, degree);
+  }
+
+  JLOG_ADD_BENCHMARK_IF("time.find_cuts_by_tree_packing", num_vertices_ > 10000) {
+    find_cuts_by_tree_packing(edges, dcs, degree);
+  }
+}
+
+template<class edge_t>
+basic_cut_tree_with_2ecc<edge_t>::basic_cut_tree_with_2ecc(edge_list_type&& edges, int num_vs) :
+  basic_cut_tree_with_2ecc(std::move(edges), num_vs, vector<V>()) {}
+
+template<class edge_t>
+basic_cut_tree_with_2ecc<edge_t>::basic_cut_tree_with_2ecc(edge_list_type&& edges, int num_vs, vector<V>&& hint_parent) :
+  num_vertices_(num_vs),
+  gh_builder_(new gomory_hu_tree_builder(num_vs,
+    FLAGS_cut_tree_connectivity_bound > 0 ? W(FLAGS_cut_tree_connectivity_bound) : numeric_limits<W>::max())),
+  hint_parent_(std::move(hint_parent)) {
+  plan_.greedy_tree_packing = FLAGS_cut_tree_enable_greedy_tree_packing;
+  plan_.goal_oriented_search = FLAGS_cut_tree_enable_goal_oriented_search;
+  plan_.goal_oriented_hubs = FLAGS_cut_tree_goal_oriented_hubs;
+  plan_.goal_oriented_hub_min_degree = 3;
+  plan_.input_average_degree = 0;
+  unique_ptr<disjoint_cut_set> dcs(new disjoint_cut_set(num_vs));
+
+  // 上限 k 未満の連結度しか求めないなら、それを保つ疎なグラフに置き換える
+  if (FLAGS_cut_tree_connectivity_bound > 0 && FLAGS_cut_tree_sparse_certificate) {
+    JLOG_ADD_BENCHMARK_IF("time.sparse_certificate", num_vertices_ > 10000) {
+      sparse_certificate(num_vs, W(FLAGS_cut_tree_connectivity_bound), &edges);
+    }
+  }
+
+  find_cuts_by_unit_capacity_preprocessing(edges, dcs.get());
+
+  //dinicの初期化
+  find_remaining_cuts(std::move(edges), dcs.get());
 
   gh_builder_->build();
 }
 
-cut_tree_with_2ecc::~cut_tree_with_2ecc() = default;
+template<class edge_t>
+basic_cut_tree_with_2ecc<edge_t>::~basic_cut_tree_with_2ecc() = default;
 
-int cut_tree_with_2ecc::query(V u, V v) const {
+template<class edge_t>
+typename basic_cut_tree_with_2ecc<edge_t>::W basic_cut_tree_with_2ecc<edge_t>::query(V u, V v) const {
   return gh_builder_->query(u, v);
 }
 
-const vector<pair<V, int>>& cut_tree_with_2ecc::parent_weight() const {
+template<class edge_t>
+const vector<pair<V, typename basic_cut_tree_with_2ecc<edge_t>::W>>& basic_cut_tree_with_2ecc<edge_t>::parent_weight() const {
   return gh_builder_->parent_weight();
 }
+
+template class basic_cut_tree_with_2ecc<unweighted_edge>;
+template class basic_cut_tree_with_2ecc<weighted_edge<int64_t>>;
+template class basic_cut_tree_with_2ecc<weighted_edge<double>>;
 } // namespace agl
@@ -1,51 +1,133 @@
 #pragma once
 #include <base/base.h>
 #include <graph/graph.h>
+#include <algorithm>
 
 DECLARE_int32(cut_tree_try_greedy_tree_packing);
+DECLARE_int32(cut_tree_tree_packing_threads);
 DECLARE_int32(cut_tree_try_large_degreepairs);
 DECLARE_int32(cut_tree_separate_near_pairs_d);
 DECLARE_int32(cut_tree_contraction_lower_bound);
 DECLARE_bool(cut_tree_enable_greedy_tree_packing);
 DECLARE_bool(cut_tree_enable_adjacent_cut);
 DECLARE_bool(cut_tree_enable_goal_oriented_search);
+DECLARE_int32(cut_tree_goal_oriented_hubs);
+DECLARE_int32(cut_tree_goal_oriented_hub_distance);
+DECLARE_bool(cut_tree_autotune);
+DECLARE_int32(cut_tree_connectivity_bound);
+DECLARE_double(cut_tree_compaction_threshold);
+DECLARE_string(cut_tree_flow_engine);
 
 namespace agl {
 namespace cut_tree_internal {
 class disjoint_cut_set;
-class separator;
-class gomory_hu_tree_builder;
+template<class flow_t> class separator;
+template<class weight_t> class basic_gomory_hu_tree_builder;
 } // cut_tree_internal
 
 // 2ecc = two-edge connected components
-class cut_tree_with_2ecc {
+// edge_t は unweighted_edge か weighted_edge<W>
+// 重み付きの場合は辺の重みを容量とし、容量1を仮定する前処理 (次数2の頂点の縮約, greedy tree packing) は行わない
+template<class edge_t>
+class basic_cut_tree_with_2ecc {
+public:
+  typedef edge_t E;
+  typedef decltype(weight(E())) W;
+  typedef std::vector<std::pair<V, E>> edge_list_type;
+
+private:
+  typedef cut_tree_internal::basic_gomory_hu_tree_builder<W> gomory_hu_tree_builder;
+
   void find_cuts_by_tree_packing(std::vector<std::pair<V, V>>& edges, cut_tree_internal::disjoint_cut_set* dcs, const std::vector<int>& degree);
   void contract_degree2_vertices(std::vector<std::pair<V, V>>& edges, std::vector<int>& degree);
 
+  // 容量1の時だけ、次数2の頂点の縮約と greedy tree packing で自明な cut を求めておく
+  void find_cuts_by_unit_capacity_preprocessing(edge_list_type& edges, cut_tree_internal::disjoint_cut_set* dcs);
+
   //次数の大きい頂点対をcutする
-  void separate_high_degreepairs(cut_tree_internal::separator* sep);
+  template<class flow_t>
+  void separate_high_degreepairs(cut_tree_internal::separator<flow_t>* sep);
 
   //隣接頂点同士を見て、まだ切れていなかったらcutする
-  void separate_adjacent_pairs(cut_tree_internal::separator* sep);
+  template<class flow_t>
+  void separate_adjacent_pairs(cut_tree_internal::separator<flow_t>* sep);
 
-  void separate_all(cut_tree_internal::separator* sep);
+  template<class flow_t>
+  void separate_all(cut_tree_internal::separator<flow_t>* sep);
 
-  void separate_near_pairs(cut_tree_internal::separator* sep);
+  template<class flow_t>
+  void separate_near_pairs(cut_tree_internal::separator<flow_t>* sep);
 
   //次数の最も高い頂点に対して、出来る限りの頂点からflowを流してmincutを求める
-  void find_cuts_by_goal_oriented_search(cut_tree_internal::separator* sep);
+  template<class flow_t>
+  void find_cuts_by_goal_oriented_search(cut_tree_internal::separator<flow_t>* sep);
+
+  // 前に作った木 (hint_parent_) の辺の cut が今のグラフでも mincut かを確かめ、そうならそのまま使う
+  template<class flow_t>
+  void find_cuts_by_hint(cut_tree_internal::separator<flow_t>* sep);
+
+  // 各段階の設定を決める (plan_). cut_tree_autotune でなければ gflags のまま
+  // plan_preprocessing は tree packing を、plan_max_flow_phases は残余グラフを作った後の段階を決める
+  void plan_preprocessing(const std::vector<int>& degree);
+  template<class flow_t>
+  void plan_max_flow_phases(cut_tree_internal::separator<flow_t>* sep);
+
+  // 残余グラフを作り、maxflow で残りの cut を求める
+  template<class flow_t>
+  void find_cuts_by_max_flow(edge_list_type&& edges, cut_tree_internal::disjoint_cut_set* dcs);
+
+  // 残余グラフの持ち方を選んで find_cuts_by_max_flow を呼ぶ
+  void find_remaining_cuts(edge_list_type&& edges, cut_tree_internal::disjoint_cut_set* dcs);
 
 public:
 
-  cut_tree_with_2ecc(std::vector<std::pair<V, V>>&& edges, int num_vs);
-  ~cut_tree_with_2ecc();
+  basic_cut_tree_with_2ecc(edge_list_type&& edges, int num_vs);
+  // hint_parent は前に作った Gomory-Hu 木の親 (根は -1). 辺の cut を確かめてから残りを求める
+  basic_cut_tree_with_2ecc(edge_list_type&& edges, int num_vs, std::vector<V>&& hint_parent);
+  ~basic_cut_tree_with_2ecc();
 
-  int query(V u, V v) const;
-  const std::vector<std::pair<V, int>>& parent_weight() const;
+  W query(V u, V v) const;
+  const std::vector<std::pair<V, W>>& parent_weight() const;
 
 private:
   const int num_vertices_;
-  std::unique_ptr<cut_tree_internal::gomory_hu_tree_builder> gh_builder_;
+  std::unique_ptr<gomory_hu_tree_builder> gh_builder_;
+  std::vector<V> hint_parent_;
+
+  // 各段階の設定. 普段は gflags のまま、cut_tree_autotune なら成分毎に決める
+  struct phase_plan {
+    bool greedy_tree_packing;
+    bool goal_oriented_search;
+    int goal_oriented_hubs;
+    int goal_oriented_hub_min_degree; // hub にする頂点の次数の下限
+    double input_average_degree; // 前処理の前の平均次数 (記録用, 容量1の時だけ)
+  };
+  phase_plan plan_;
 };
 
+typedef basic_cut_tree_with_2ecc<unweighted_edge> cut_tree_with_2ecc;
+template<class weight_t> using weighted_cut_tree_with_2ecc = basic_cut_tree_with_2ecc<weighted_edge<weight_t>>;
+
+// 無向辺のリストで、同じ頂点対の辺 (逆向きの辺も含む) を重みの和を容量とする1本にまとめる. 自己ループは捨てる
+template<class weight_t>
+typename weighted_graph<weight_t>::edge_list_type merge_parallel_edges(const typename weighted_graph<weight_t>::edge_list_type& es) {
+  typedef std::pair<V, weighted_edge<weight_t>> edge_type;
+  typename weighted_graph<weight_t>::edge_list_type sorted;
+  for (auto& e : es) {
+    V u = e.first, v = to(e.second);
+    if (u == v) continue;
+    if (u > v) std::swap(u, v);
+    sorted.emplace_back(u, weighted_edge<weight_t>{v, weight(e.second)});
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const edge_type& l, const edge_type& r) {
+    return std::make_pair(l.first, to(l.second)) < std::make_pair(r.first, to(r.second));
+  });
+  typename weighted_graph<weight_t>::edge_list_type ret;
+  for (auto& e : sorted) {
+    if (!ret.empty() && ret.back().first == e.first && to(ret.back().second) == to(e.second)) ret.back().second.weight += weight(e.second);
+    else ret.push_back(e);
+  }
+  return ret;
+}
+
 } // namespace agl
\ No newline at end of file
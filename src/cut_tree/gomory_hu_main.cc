@@ -1,8 +1,11 @@
 #include <cut_tree/cut_tree.h>
 #include <easy_cui.h>
 
-DEFINE_string(cut_tree_builder, "cut_tree_with_2ecc", "cut_tree_with_2ecc, PlainGusfield, PlainGusfield_bi_dinitz");
+DEFINE_string(cut_tree_builder, "cut_tree_with_2ecc", "cut_tree_with_2ecc, cut_tree_with_2ecc_boykov_kolmogorov, cut_tree_with_2ecc_push_relabel, gomory_hu_dinitz, gomory_hu_bi_dinitz, gomory_hu_boykov_kolmogorov, gomory_hu_push_relabel, write_directed_graph");
 DEFINE_string(cut_tree_output_path, "", "output gomory_hu tree path");
+DEFINE_string(cut_tree_output_format, "text", "text, binary");
+DEFINE_bool(cut_tree_output_index, true, "write the query index with -cut_tree_output_format=binary");
+DEFINE_string(cut_tree_hint_path, "", "previous gomory_hu tree (text or binary) whose cuts are verified and reused before the remaining max flows (cut_tree_with_2ecc builders only)");
 
 G to_directed_graph(G&& g) {
   vector<pair<V, V>> ret;
@@ -35,14 +38,22 @@ void print_gomory_hu_tree(G&& g) {
     auto gname = graph_name();
     FLAGS_cut_tree_output_path = gname + ".tree";
   }
+  vector<V> hint_parent;
+  if (FLAGS_cut_tree_hint_path != "") {
+    hint_parent = read_cut_tree_parent(FLAGS_cut_tree_hint_path.c_str(), g.num_vertices());
+  }
   gomory_hu_tree_t* gf = nullptr;
   JLOG_PUT_BENCHMARK("test_time") {
-    gf = new gomory_hu_tree_t(g);
+    gf = new gomory_hu_tree_t(g, hint_parent);
   }
   CHECK(gf);
 
-  ofstream os(FLAGS_cut_tree_output_path.c_str(), ios_base::out);
-  gf->print_gomory_hu_tree(os);
+  if (FLAGS_cut_tree_output_format == "binary") {
+    print_gomory_hu_tree_binary(*gf, FLAGS_cut_tree_output_path.c_str(), FLAGS_cut_tree_output_index);
+  } else {
+    ofstream os(FLAGS_cut_tree_output_path.c_str(), ios_base::out);
+    gf->print_gomory_hu_tree(os);
+  }
   delete gf;
 }
 
@@ -57,6 +68,10 @@ DEFINE_string(write_directed_graph_name, "", "");
 
 int main(int argc, char** argv) {
   G g = easy_cui_init(argc, argv);
+  if (FLAGS_cut_tree_output_format != "text" && FLAGS_cut_tree_output_format != "binary") {
+    fprintf(stderr, "unrecognized option -cut_tree_output_format='%s'\n", FLAGS_cut_tree_output_format.c_str());
+    exit(-1);
+  }
   fprintf(stderr, "easy_cui_init : memory %ld MB\n", jlog_internal::get_memory_usage() / 1024);
   if (FLAGS_graph.find(".directed") == string::npos) {
     g = to_directed_graph(std::move(g));
@@ -78,6 +93,18 @@ int main(int argc, char** argv) {
     main_<gomory_hu_bi_dinitz>(std::move(g));
   } else if (FLAGS_cut_tree_builder == "cut_tree_with_2ecc") {
     main_<cut_tree>(std::move(g));
+  } else if (FLAGS_cut_tree_builder == "gomory_hu_boykov_kolmogorov") {
+    FLAGS_cut_tree_flow_engine = "boykov_kolmogorov";
+    main_<gomory_hu_bi_dinitz>(std::move(g));
+  } else if (FLAGS_cut_tree_builder == "cut_tree_with_2ecc_boykov_kolmogorov") {
+    FLAGS_cut_tree_flow_engine = "boykov_kolmogorov";
+    main_<cut_tree>(std::move(g));
+  } else if (FLAGS_cut_tree_builder == "gomory_hu_push_relabel") {
+    FLAGS_cut_tree_flow_engine = "push_relabel";
+    main_<gomory_hu_bi_dinitz>(std::move(g));
+  } else if (FLAGS_cut_tree_builder == "cut_tree_with_2ecc_push_relabel") {
+    FLAGS_cut_tree_flow_engine = "push_relabel";
+    main_<cut_tree>(std::move(g));
   } else {
     fprintf(stderr, "unrecognized option -cut_tree_builder='%s'\n", FLAGS_cut_tree_builder.c_str());
     exit(-1);
@@ -1,32 +1,44 @@
 #include <easy_cui.h>
 #include "cut_tree_query_handler.h"
+#include "cut_tree_binary.h"
 
 DEFINE_int32(cut_tree_num_query, 10000000, "");
 DEFINE_int64(cut_tree_node_pair_random_seed, 922337203685477583LL, "");
 DEFINE_string(cut_tree_path, "", "");
+DEFINE_string(cut_tree_query_method, "index", "index, walk");
 
+// バイナリ形式なら mapped_cut_tree で mmap して読む
+template<class cut_tree_t>
 void from_file() {
-  cut_tree_query_handler tq;
+  cut_tree_t tq;
   JLOG_PUT_BENCHMARK("initialize_time") {
-    tq = cut_tree_query_handler::from_file(FLAGS_cut_tree_path);
+    tq = cut_tree_t::from_file(FLAGS_cut_tree_path);
   }
 
+  const bool walk = FLAGS_cut_tree_query_method == "walk";
+  CHECK_MSG(walk || FLAGS_cut_tree_query_method == "index", "unrecognized option -cut_tree_query_method");
   agl::random_type random(FLAGS_cut_tree_node_pair_random_seed);
+  long long sum = 0;
   JLOG_PUT_BENCHMARK("query_time") {
     for (int i = 0; i < FLAGS_cut_tree_num_query; i++) {
       V s = random() % tq.num_vertices();
       V t = random() % (tq.num_vertices() - 1);
       if (s <= t) t++;
-      tq.query(s, t);
+      sum += walk ? tq.query_by_walk(s, t) : tq.query(s, t);
     }
   }
+  JLOG_PUT("query_sum", sum);
 }
 
 int main(int argc, char** argv) {
   JLOG_INIT(&argc, argv);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
 
-  from_file();
+  if (is_cut_tree_binary(FLAGS_cut_tree_path.c_str())) {
+    from_file<mapped_cut_tree>();
+  } else {
+    from_file<cut_tree_query_handler>();
+  }
 
   return 0;
 }
@@ -5,46 +5,84 @@ using namespace std;
 
 namespace agl {
 
-void greedy_treepacking::dfs(int v) {
-  used_revision_[v] = vertices_revision_;
-  auto& to_edges = edges_[v];
-  const int rem_edges = min(to_edges.size(), FLAGS_cut_tree_gtp_dfs_edge_max);
-  for (int i = 0; i < rem_edges; i++) {
-    V to = to_edges.current();
+void greedy_treepacking::touch(int v) {
+  if (touched_revision_[v] == packing_revision_) return;
+  touched_revision_[v] = packing_revision_;
+  copy(base_to_.begin() + offset_[v], base_to_.begin() + offset_[v + 1], to_.begin() + offset_[v]);
+  rem_size_[v] = offset_[v + 1] - offset_[v];
+  idx_[v] = 0;
+  inedge_count_[v] = 0;
+}
+
+// 再帰すると深さが頂点数になるので、スタックを自前で持つ
+void greedy_treepacking::dfs(int root) {
+  auto visit = [this](int v) {
+    touch(v);
+    used_revision_[v] = vertices_revision_;
+    stack_.emplace_back(v, min(rem_size_[v], FLAGS_cut_tree_gtp_dfs_edge_max));
+  };
+  visit(root);
+  while (!stack_.empty()) {
+    const V v = stack_.back().first;
+    if (stack_.back().second == 0) {
+      stack_.pop_back();
+      continue;
+    }
+    stack_.back().second--;
+    int& idx = idx_[v];
+    int& rem_size = rem_size_[v];
+    V* to_edges = &to_[offset_[v]];
+    const V to = to_edges[idx];
     // logging::gtp_edge_count++;
     if (used_revision_[to] == vertices_revision_) {
-      to_edges.advance();
+      // advance
+      if (++idx == rem_size) idx = 0;
       // logging::gtp_edge_miss++;
     } else {
-      to_edges.remove_current();
+      // remove_current
+      swap(to_edges[idx], to_edges[rem_size - 1]);
+      if (--rem_size == idx) idx = 0;
+      touch(to);
       inedge_count_[to]++; // in-edgeの本数が増える
-      dfs(to);
+      visit(to);
       // logging::gtp_edge_use++;
     }
   }
 }
+
 greedy_treepacking::greedy_treepacking(const vector<pair<V, V>>& edges, int num_vs) :
-  n_(num_vs), edges_(n_), inedge_count_(n_), used_revision_(n_), vertices_revision_(1) {
+  n_(num_vs), offset_(n_ + 1), base_to_(2 * edges.size()), to_(2 * edges.size()),
+  rem_size_(n_), idx_(n_), inedge_count_(n_), touched_revision_(n_), packing_revision_(0),
+  used_revision_(n_), vertices_revision_(1) {
+  for (auto& e : edges) {
+    offset_[e.first + 1]++;
+    offset_[e.second + 1]++;
+  }
+  for (int v = 0; v < n_; v++) offset_[v + 1] += offset_[v];
+  vector<int> pos(offset_.begin(), offset_.end() - 1);
   for (auto& e : edges) {
-    edges_[e.first].add(e.second);
-    edges_[e.second].add(e.first);
+    base_to_[pos[e.first]++] = e.second;
+    base_to_[pos[e.second]++] = e.first;
   }
 
-  for (auto& e : edges_) {
-    auto& edges_ = this->edges_;
-    sort(e.to_.begin(), e.to_.end(), [&edges_](const V l, const V r) {
-      int a = edges_[l].size();
-      int b = edges_[r].size();
+  const vector<int>& offset = offset_;
+  for (int v = 0; v < n_; v++) {
+    stable_sort(base_to_.begin() + offset_[v], base_to_.begin() + offset_[v + 1], [&offset](const V l, const V r) {
+      int a = offset[l + 1] - offset[l];
+      int b = offset[r + 1] - offset[r];
       return a < b;
     });
   }
 }
 
-void greedy_treepacking::arborescence_packing(int from) {
-  for (int i = 0; i < edges_[from].size(); i++) {
+void greedy_treepacking::arborescence_packing(int from, int max_trees) {
+  packing_revision_++;
+  touch(from);
+  const int num_trees = min(rem_size_[from], max_trees);
+  for (int i = 0; i < num_trees; i++) {
     dfs(from);
     vertices_revision_++;
   }
 }
 
-} // namespace agl
\ No newline at end of file
+} // namespace agl
@@ -7,46 +7,32 @@ DECLARE_int32(cut_tree_gtp_dfs_edge_max);
 namespace agl {
 
 // ある頂点からdfsをして、貪欲にtree packingを求める
+// 辺のリストは頂点毎に CSR で持ち、packing で使った辺はその頂点の区間の末尾に寄せる
+// 次の packing では、初めて触った頂点の区間だけを元に戻すので、packing 毎にグラフを複製しなくてよい
+// 別々のスレッドで packing するなら、スレッド毎に複製して使う
 class greedy_treepacking {
-  class vecE {
-  public:
-    vecE() {
-      idx_ = 0;
-    }
-
-    void add(int to) {
-      to_.emplace_back(to);
-    }
-
-    bool empty() const { return to_.empty(); }
-    int size() const { return int(to_.size()); }
-    void advance() {
-      idx_++;
-      if (int(to_.size()) == idx_) idx_ = 0;
-    }
-    const V current() const { return to_[idx_]; }
-    void remove_current() {
-      std::swap(to_[idx_], to_.back());
-      to_.pop_back();
-      if (int(to_.size()) == idx_) idx_ = 0;
-    }
-  public:
-    int rem_size_, idx_;
-    std::vector<V> to_;
-  };
-
-  void dfs(int v);
+  // この packing で v を初めて触るなら、v の辺のリストと in-edge の本数を元に戻す
+  void touch(int v);
+  void dfs(int root);
 public:
   greedy_treepacking(const std::vector<std::pair<V, V>>& edges, int num_vs);
-  void arborescence_packing(int from);
+  // from を根とする arborescence を max_trees 個まで (from の次数まで) 詰める
+  // 前の arborescence_packing の結果は捨てる
+  void arborescence_packing(int from, int max_trees = std::numeric_limits<int>::max());
 
-  int inedge_count(int v) const { return inedge_count_[v]; }
+  int inedge_count(int v) const { return touched_revision_[v] == packing_revision_ ? inedge_count_[v] : 0; }
 
 private:
   int n_;
-  std::vector<vecE> edges_;
+  std::vector<int> offset_; // v の辺は [offset_[v], offset_[v + 1])
+  std::vector<V> base_to_; // 隣接頂点を次数の小さい順に並べたもの. 変えない
+  std::vector<V> to_; // packing 中の辺のリスト. v の残りの辺は [offset_[v], offset_[v] + rem_size_[v])
+  std::vector<int> rem_size_, idx_;
   std::vector<int> inedge_count_; // dfs tree packingで、その頂点に何本のin-edgeがあるか
+  std::vector<int> touched_revision_;
+  int packing_revision_;
   std::vector<int> used_revision_;
   int vertices_revision_;
+  std::vector<std::pair<V, int>> stack_; // dfs の (頂点, 残りの辺を見る回数)
 };
-} // namespace agl
\ No newline at end of file
+} // namespace agl
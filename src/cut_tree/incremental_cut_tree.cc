@@ -0,0 +1,381 @@
+#include "incremental_cut_tree.h"
+#include "cut_tree.h"
+#include <algorithm>
+#include <limits>
+
+DEFINE_int32(cut_tree_incremental_max_flows, 64, "incremental_cut_tree rebuilds the whole tree when an update would need more max flows than this");
+
+using namespace std;
+
+namespace agl {
+namespace {
+// 頂点毎に、接続する木の辺の番号を CSR で並べる
+void build_incident_edges(int num_vs, const vector<pair<int, int>>& endpoints, const vector<int>& edge_ids, vector<int>* offset, vector<int>* incident) {
+  offset->assign(num_vs + 1, 0);
+  for (int i : edge_ids) (*offset)[endpoints[i].first + 1]++, (*offset)[endpoints[i].second + 1]++;
+  for (int v = 0; v < num_vs; v++) (*offset)[v + 1] += (*offset)[v];
+  incident->resize((*offset)[num_vs]);
+  vector<int> pos(offset->begin(), offset->end() - 1);
+  for (int i : edge_ids) {
+    (*incident)[pos[endpoints[i].first]++] = i;
+    (*incident)[pos[endpoints[i].second]++] = i;
+  }
+}
+} // namespace
+
+incremental_cut_tree::incremental_cut_tree(const G& g)
+  : n_(g.num_vertices()), adj_(n_), last_num_max_flows_(-1), num_rebuilds_(0) {
+  for (V v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
+    const V w = to(e);
+    if (v == w) continue;
+    adj_[v].push_back(w);
+    adj_[w].push_back(v);
+  }
+  rebuild();
+  num_rebuilds_ = 0;
+}
+
+incremental_cut_tree::incremental_cut_tree(const vector<pair<V, V>>& edges, int num_vs, const vector<pair<V, int>>& parent_weight)
+  : n_(num_vs), adj_(n_), last_num_max_flows_(-1), num_rebuilds_(0) {
+  CHECK(int(parent_weight.size()) == n_);
+  for (auto& e : edges) {
+    if (e.first == e.second) continue;
+    adj_[e.first].push_back(e.second);
+    adj_[e.second].push_back(e.first);
+  }
+  vector<tuple<V, V, int>> tree_edges;
+  for (V v = 0; v < n_; v++) {
+    if (parent_weight[v].first >= 0) tree_edges.emplace_back(v, parent_weight[v].first, parent_weight[v].second);
+  }
+  set_tree(move(tree_edges));
+}
+
+void incremental_cut_tree::rebuild() {
+  vector<pair<V, V>> edges;
+  for (V u = 0; u < n_; u++) for (V w : adj_[u]) {
+    if (u < w) edges.emplace_back(u, w);
+  }
+  sort(edges.begin(), edges.end());
+  vector<tuple<V, V, int>> tree_edges;
+  auto add_tree_edge = [&tree_edges](V u, V v, int64_t weight) {
+    tree_edges.emplace_back(u, v, int(weight));
+  };
+  if (adjacent_find(edges.begin(), edges.end()) == edges.end()) {
+    G g(edges, n_);
+    edges.clear(); edges.shrink_to_fit();
+    cut_tree ct(g);
+    ct.for_each_gomory_hu_tree_edge(add_tree_edge);
+  } else {
+    // cut_tree は多重辺を扱えないので、本数を容量にする
+    weighted_graph<int64_t>::edge_list_type wes;
+    for (auto& e : edges) {
+      if (!wes.empty() && wes.back().first == e.first && wes.back().second.to == e.second) wes.back().second.weight++;
+      else wes.emplace_back(e.first, weighted_edge<int64_t>{e.second, 1});
+    }
+    edges.clear(); edges.shrink_to_fit();
+    weighted_cut_tree<int64_t> ct(weighted_graph<int64_t>(wes, n_));
+    ct.for_each_gomory_hu_tree_edge(add_tree_edge);
+  }
+  set_tree(move(tree_edges));
+  last_num_max_flows_ = -1;
+  num_rebuilds_++;
+}
+
+void incremental_cut_tree::set_tree(vector<tuple<V, V, int>>&& tree_edges) {
+  parent_weight_ = cut_tree_parent_weight(n_, tree_edges);
+  tree_edges.clear(); tree_edges.shrink_to_fit();
+  // 別の連結成分の木は、重み 0 の辺で頂点 0 の木につなぐ (cut の大きさは 0 なので正しい)
+  for (V v = 1; v < n_; v++) {
+    if (parent_weight_[v].first == -1) parent_weight_[v] = make_pair(0, 0);
+  }
+
+  depth_.assign(n_, -1);
+  vector<V> stack;
+  for (V v = 0; v < n_; v++) {
+    for (V u = v; depth_[u] == -1; u = parent_weight_[u].first) {
+      if (parent_weight_[u].first == -1) {
+        depth_[u] = 0;
+        break;
+      }
+      stack.push_back(u);
+    }
+    while (!stack.empty()) {
+      const V u = stack.back();
+      stack.pop_back();
+      depth_[u] = depth_[parent_weight_[u].first] + 1;
+    }
+  }
+}
+
+vector<V> incremental_cut_tree::tree_path(V u, V v) const {
+  vector<V> path;
+  while (u != v) {
+    if (depth_[u] < depth_[v]) swap(u, v);
+    path.push_back(u);
+    u = parent_weight_[u].first;
+  }
+  return path;
+}
+
+int incremental_cut_tree::query(V u, V v) const {
+  CHECK(u != v);
+  CHECK(u < n_ && v < n_);
+  int ans = numeric_limits<int>::max();
+  for (V x : tree_path(u, v)) ans = min(ans, parent_weight_[x].second);
+  return ans;
+}
+
+void incremental_cut_tree::insert_edge(V u, V v) {
+  CHECK(u != v);
+  CHECK(u < n_ && v < n_);
+  adj_[u].push_back(v);
+  adj_[v].push_back(u);
+  repair(tree_path(u, v));
+}
+
+void incremental_cut_tree::delete_edge(V u, V v) {
+  CHECK(u < n_ && v < n_);
+  auto erase_one = [this](V x, V y) {
+    auto it = find(adj_[x].begin(), adj_[x].end(), y);
+    CHECK_MSG(it != adj_[x].end(), "the edge to delete does not exist");
+    *it = adj_[x].back();
+    adj_[x].pop_back();
+  };
+  erase_one(u, v);
+  erase_one(v, u);
+
+  // 路上の辺の cut は (u, v) を含むので1減り、λ も高々1しか減らないのでそのまま正しい
+  // 路の外の辺 (a, b) が正しくなくなるのは、u と v も分ける大きさ λ(a, b) の a-b cut がある時だけで、λ(a, b) >= λ(u, v) が要る
+  const vector<V> path = tree_path(u, v);
+  int lambda_uv = numeric_limits<int>::max();
+  vector<char> on_path(n_);
+  for (V x : path) {
+    lambda_uv = min(lambda_uv, parent_weight_[x].second);
+    on_path[x] = true;
+    parent_weight_[x].second--;
+  }
+  vector<V> invalid;
+  for (V x = 0; x < n_; x++) {
+    if (parent_weight_[x].first == -1 || on_path[x]) continue;
+    if (parent_weight_[x].second >= lambda_uv) invalid.push_back(x);
+  }
+  repair(invalid);
+}
+
+void incremental_cut_tree::repair(const vector<V>& invalid) {
+  last_num_max_flows_ = 0;
+  if (invalid.empty()) return;
+  if (int(invalid.size()) > FLAGS_cut_tree_incremental_max_flows) {
+    rebuild();
+    return;
+  }
+
+  // 木の辺 i = (tree_ends[i].first, tree_ends[i].second), 重み tree_weight[i]
+  vector<pair<int, int>> tree_ends;
+  vector<int64_t> tree_weight;
+  vector<int> edge_of(n_, -1);
+  for (V v = 0; v < n_; v++) {
+    if (parent_weight_[v].first == -1) continue;
+    edge_of[v] = int(tree_ends.size());
+    tree_ends.emplace_back(v, parent_weight_[v].first);
+    tree_weight.push_back(parent_weight_[v].second);
+  }
+  vector<char> is_invalid(tree_ends.size());
+  for (V x : invalid) is_invalid[edge_of[x]] = true;
+
+  // 正しくないかもしれない辺の端点は1頂点ずつ、残りの頂点は木でつながっている塊毎にまとめて1頂点 (atom) にする
+  vector<int> atom_of(n_, -1);
+  vector<V> atom_vertex;
+  for (V x : invalid) {
+    for (V v : {x, parent_weight_[x].first}) {
+      if (atom_of[v] != -1) continue;
+      atom_of[v] = int(atom_vertex.size());
+      atom_vertex.push_back(v);
+    }
+  }
+  const int num_super_atoms = int(atom_vertex.size());
+  int num_atoms = num_super_atoms;
+  {
+    vector<int> all_edges(tree_ends.size()), offset, incident;
+    for (int i = 0; i < int(all_edges.size()); i++) all_edges[i] = i;
+    build_incident_edges(n_, tree_ends, all_edges, &offset, &incident);
+    vector<V> q;
+    for (V s = 0; s < n_; s++) {
+      if (atom_of[s] != -1) continue;
+      atom_of[s] = num_atoms;
+      q.assign(1, s);
+      for (size_t i = 0; i < q.size(); i++) {
+        const V v = q[i];
+        for (int j = offset[v]; j < offset[v + 1]; j++) {
+          const int e = incident[j];
+          const V w = tree_ends[e].first == v ? tree_ends[e].second : tree_ends[e].first;
+          if (atom_of[w] != -1) continue;
+          atom_of[w] = num_atoms;
+          q.push_back(w);
+        }
+      }
+      num_atoms++;
+    }
+  }
+
+  // atom 間の辺を容量付きにまとめる
+  vector<pair<int, int>> atom_pairs;
+  for (V u = 0; u < n_; u++) for (V w : adj_[u]) {
+    if (u > w || atom_of[u] == atom_of[w]) continue;
+    atom_pairs.emplace_back(min(atom_of[u], atom_of[w]), max(atom_of[u], atom_of[w]));
+  }
+  sort(atom_pairs.begin(), atom_pairs.end());
+  vector<pair<pair<int, int>, int64_t>> atom_edges;
+  for (auto& p : atom_pairs) {
+    if (atom_edges.empty() || atom_edges.back().first != p) atom_edges.emplace_back(p, 0);
+    atom_edges.back().second++;
+  }
+  atom_pairs.clear(); atom_pairs.shrink_to_fit();
+
+  // atom 同士をつなぐ木の辺. 正しくないかもしれない辺でつながった atom を supernode とする
+  vector<int> atom_tree_edges;
+  union_find uf(num_super_atoms);
+  for (int i = 0; i < int(tree_ends.size()); i++) {
+    if (atom_of[tree_ends[i].first] == atom_of[tree_ends[i].second]) continue;
+    atom_tree_edges.push_back(i);
+    if (is_invalid[i]) uf.unite(atom_of[tree_ends[i].first], atom_of[tree_ends[i].second]);
+  }
+  vector<vector<int>> supernodes(num_super_atoms);
+  for (int a = 0; a < num_super_atoms; a++) supernodes[uf.root(a)].push_back(a);
+
+  vector<int> part_of(num_atoms, -1), ext_of(num_atoms, -1), local(num_atoms);
+  vector<pair<int, int>> atom_ends(tree_ends.size());
+  vector<int> offset, incident, q;
+  for (auto& S : supernodes) {
+    if (S.size() < 2) continue;
+    for (int a : S) part_of[a] = 0;
+    fill(ext_of.begin(), ext_of.end(), -1);
+
+    // 木から S を除いた各成分は、S と木の辺 boundary[j] でつながっている. 成分の atom の ext_of を j にする
+    for (int i : atom_tree_edges) atom_ends[i] = make_pair(atom_of[tree_ends[i].first], atom_of[tree_ends[i].second]);
+    build_incident_edges(num_atoms, atom_ends, atom_tree_edges, &offset, &incident);
+    vector<int> boundary, internal;
+    for (int a : S) {
+      for (int j = offset[a]; j < offset[a + 1]; j++) {
+        const int e = incident[j];
+        const int b = atom_ends[e].first == a ? atom_ends[e].second : atom_ends[e].first;
+        if (part_of[b] != -1) {
+          if (a < b) internal.push_back(e);
+          continue;
+        }
+        ext_of[b] = int(boundary.size());
+        q.assign(1, b);
+        for (size_t k = 0; k < q.size(); k++) {
+          const int c = q[k];
+          for (int l = offset[c]; l < offset[c + 1]; l++) {
+            const int f = incident[l];
+            const int d = atom_ends[f].first == c ? atom_ends[f].second : atom_ends[f].first;
+            if (part_of[d] != -1 || ext_of[d] != -1) continue;
+            ext_of[d] = int(boundary.size());
+            q.push_back(d);
+          }
+        }
+        boundary.push_back(e);
+      }
+    }
+    CHECK(internal.size() + 1 == S.size());
+
+    // Gomory-Hu: S を分けた部分 (part) の木と、各 boundary がどの part につながっているか (attach)
+    vector<vector<int>> parts(1, S);
+    vector<tuple<int, int, int64_t>> part_edges;
+    vector<int> attach(boundary.size(), 0);
+    for (int X = 0; X < int(parts.size()); X++) {
+      while (parts[X].size() >= 2) {
+        // X 以外の part と boundary の先の成分を、X を除いた木の連結成分毎に1頂点に縮約する
+        int num_nodes = int(parts[X].size());
+        for (int i = 0; i < num_nodes; i++) local[parts[X][i]] = i;
+        vector<int> comp_of_part(parts.size(), -1);
+        for (auto& pe : part_edges) {
+          int P = get<0>(pe) == X ? get<1>(pe) : get<1>(pe) == X ? get<0>(pe) : -1;
+          if (P == -1) continue;
+          comp_of_part[P] = num_nodes;
+          q.assign(1, P);
+          for (size_t k = 0; k < q.size(); k++) {
+            for (auto& pf : part_edges) {
+              const int c = q[k];
+              int R = get<0>(pf) == c ? get<1>(pf) : get<1>(pf) == c ? get<0>(pf) : -1;
+              if (R == -1 || R == X || comp_of_part[R] != -1) continue;
+              comp_of_part[R] = num_nodes;
+              q.push_back(R);
+            }
+          }
+          num_nodes++;
+        }
+        vector<int> comp_of_boundary(boundary.size());
+        for (int j = 0; j < int(boundary.size()); j++) {
+          comp_of_boundary[j] = attach[j] == X ? num_nodes++ : comp_of_part[attach[j]];
+        }
+        auto node = [&](int a) {
+          if (part_of[a] == -1) return comp_of_boundary[ext_of[a]];
+          return part_of[a] == X ? local[a] : comp_of_part[part_of[a]];
+        };
+
+        vector<pair<V, weighted_edge<int64_t>>> es;
+        for (auto& ae : atom_edges) {
+          const int x = node(ae.first.first), y = node(ae.first.second);
+          if (x != y) es.emplace_back(x, weighted_edge<int64_t>{y, ae.second});
+        }
+        weighted_bi_dinitz<int64_t> dz(move(es), num_nodes);
+        const int64_t flow = dz.max_flow(0, 1);
+        last_num_max_flows_++;
+
+        // 残余グラフで s から辿れる頂点が s 側
+        vector<char> sside(num_nodes);
+        sside[0] = true;
+        q.assign(1, 0);
+        for (size_t k = 0; k < q.size(); k++) {
+          for (auto e : dz.edges(q[k])) {
+            const int w = dz.to(e);
+            if (sside[w] || dz.cap(e) == 0) continue;
+            sside[w] = true;
+            q.push_back(w);
+          }
+        }
+        CHECK(!sside[1]);
+
+        const int Y = int(parts.size());
+        parts.emplace_back();
+        vector<int> kept;
+        for (int a : parts[X]) {
+          if (sside[local[a]]) kept.push_back(a);
+          else parts[Y].push_back(a), part_of[a] = Y;
+        }
+        parts[X].swap(kept);
+        for (auto& pe : part_edges) {
+          if (get<0>(pe) == X && !sside[comp_of_part[get<1>(pe)]]) get<0>(pe) = Y;
+          else if (get<1>(pe) == X && !sside[comp_of_part[get<0>(pe)]]) get<1>(pe) = Y;
+        }
+        for (int j = 0; j < int(boundary.size()); j++) {
+          if (attach[j] == X && !sside[comp_of_boundary[j]]) attach[j] = Y;
+        }
+        part_edges.emplace_back(X, Y, flow);
+      }
+    }
+
+    // 分け終わった part は1頂点ずつなので、木の辺をつなぎ直す
+    auto part_vertex = [&](int P) { return atom_vertex[parts[P][0]]; };
+    for (int j = 0; j < int(boundary.size()); j++) {
+      auto& ends = tree_ends[boundary[j]];
+      if (part_of[atom_of[ends.first]] != -1) ends.first = part_vertex(attach[j]);
+      else ends.second = part_vertex(attach[j]);
+    }
+    for (int k = 0; k < int(internal.size()); k++) {
+      const auto& pe = part_edges[k];
+      tree_ends[internal[k]] = make_pair(part_vertex(get<0>(pe)), part_vertex(get<1>(pe)));
+      tree_weight[internal[k]] = get<2>(pe);
+    }
+    for (int a : S) part_of[a] = -1;
+  }
+
+  vector<tuple<V, V, int>> tree_edges;
+  for (int i = 0; i < int(tree_ends.size()); i++) {
+    tree_edges.emplace_back(tree_ends[i].first, tree_ends[i].second, int(tree_weight[i]));
+  }
+  set_tree(move(tree_edges));
+}
+} // namespace agl
@@ -0,0 +1,50 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+
+DECLARE_int32(cut_tree_incremental_max_flows);
+
+namespace agl {
+// 辺の追加・削除に合わせて、容量1のグラフの Gomory-Hu 木を更新する
+//
+// 木の辺は、その辺で木を切った時の cut が両端の最小 cut になっていれば正しい
+// 辺 (u, v) を足すと、木の u-v 路上の辺だけが正しくなくなるかもしれない (路の外の辺の cut の大きさは変わらない)
+// 辺 (u, v) を消すと、路上の辺は重みが 1 減ったまま正しく、路の外で重みが λ(u, v) 以上の辺だけが正しくなくなるかもしれない
+// 正しくないかもしれない辺を縮約した頂点 (supernode) を、Gomory-Hu と同じく残りの木を縮約したグラフの maxflow で分け直す
+// maxflow は正しくないかもしれない辺の数だけ流し、cut_tree_incremental_max_flows を超えるなら作り直す
+class incremental_cut_tree {
+public:
+  // g を cut_tree で作った木から始める
+  explicit incremental_cut_tree(const G& g);
+  // edges (各無向辺を1回ずつ) とその Gomory-Hu 木 parent_weight から始める. 根の親は -1
+  incremental_cut_tree(const std::vector<std::pair<V, V>>& edges, int num_vs, const std::vector<std::pair<V, int>>& parent_weight);
+
+  void insert_edge(V u, V v);
+  // (u, v) の辺を1本消す. 無ければ落ちる
+  void delete_edge(V u, V v);
+
+  int query(V u, V v) const;
+  const std::vector<std::pair<V, int>>& parent_weight() const { return parent_weight_; }
+  int num_vertices() const { return n_; }
+
+  // 直前の更新で流した maxflow の回数. 作り直したら -1
+  int last_num_max_flows() const { return last_num_max_flows_; }
+  int num_rebuilds() const { return num_rebuilds_; }
+
+private:
+  // 今のグラフから cut_tree で木を作り直す
+  void rebuild();
+  // 木の u-v 路の辺 (子の頂点で表す)
+  std::vector<V> tree_path(V u, V v) const;
+  // 親への辺が正しくないかもしれない頂点 invalid を受け取り、その辺を分け直す
+  void repair(const std::vector<V>& invalid);
+  // 木の辺のリストから parent_weight_ と depth_ を作る. 木が連結でなければ重み 0 の辺でつなぐ
+  void set_tree(std::vector<std::tuple<V, V, int>>&& tree_edges);
+
+  int n_;
+  std::vector<std::vector<V>> adj_;
+  std::vector<std::pair<V, int>> parent_weight_;
+  std::vector<int> depth_;
+  int last_num_max_flows_, num_rebuilds_;
+};
+} // namespace agl
@@ -0,0 +1,3 @@
+#include "parallel_separate_all.h"
+
+DEFINE_int32(cut_tree_separate_all_threads, -1, "number of threads in separate_all (0 = hardware concurrency). the tree does not depend on it; -1 runs the serial separate_all, which contracts and may output different (equally valid) tree edges");
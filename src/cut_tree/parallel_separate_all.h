@@ -0,0 +1,220 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+DECLARE_int32(cut_tree_separate_all_threads);
+
+namespace agl {
+namespace cut_tree_internal {
+
+// 1回の maxflow で求まった (s,t) mincut
+template<class cost_t>
+struct basic_mincut_result {
+  V s, t;
+  cost_t cost;
+  // vs[0] を含む側の頂点 (vs[0] は s か t)
+  std::vector<V> vs;
+
+  basic_mincut_result() : s(-1), t(-1), cost() {}
+  basic_mincut_result(V s, V t, cost_t cost) : s(s), t(t), cost(cost) {}
+};
+typedef basic_mincut_result<int> mincut_result;
+
+// maxflow 後の残余グラフ上で、bfs が先に尽きた側の頂点を cut->vs に集める
+// used[v] == F を訪問済みとする
+template<class flow_t>
+void collect_cut_side(flow_t& dz, const int F, std::vector<int>* used, basic_mincut_result<typename flow_t::cap_t>* cut) {
+  assert(dz.reason_for_finishing_bfs() != flow_t::kReachedUpperBound);
+  const bool from_s = dz.reason_for_finishing_bfs() == flow_t::kQsIsEmpty;
+  std::vector<int>& u = *used;
+  std::vector<V>& vs = cut->vs;
+  vs.clear();
+  vs.emplace_back(from_s ? cut->s : cut->t);
+  u[vs[0]] = F;
+  for (size_t i = 0; i < vs.size(); i++) {
+    const V v = vs[i];
+    for (auto e : dz.edges(v)) {
+      const typename flow_t::cap_t cap = from_s ? dz.cap(e) : dz.cap(dz.rev(e));
+      if (cap == 0 || u[dz.to(e)] == F) continue;
+      u[dz.to(e)] = F;
+      vs.emplace_back(dz.to(e));
+    }
+  }
+}
+
+// s, t 間の mincut を求めて cut に入れる
+// maxflow が upper_bound に達して打ち切られたら、cost = upper_bound, vs = {s} とする
+// (s と t は upper_bound 以上つながっているので、s を t の隣の葉にしても upper_bound 未満の値は変わらない)
+template<class flow_t>
+void bounded_mincut(flow_t& dz, const V s, const V t, const typename flow_t::cap_t upper_bound,
+                    const int F, std::vector<int>* used, basic_mincut_result<typename flow_t::cap_t>* cut) {
+  *cut = basic_mincut_result<typename flow_t::cap_t>(s, t, dz.max_flow(s, t, upper_bound));
+  if (dz.reason_for_finishing_bfs() == flow_t::kReachedUpperBound) {
+    cut->cost = upper_bound;
+    cut->vs.assign(1, s);
+  } else {
+    collect_cut_side(dz, F, used, cut);
+  }
+}
+
+// cut->vs (mincut の vs[0] 側) が、s, t と別の group を一部だけ含んでいたら、その group を丸ごと含めるか丸ごと除いて交わらないようにする
+// group 毎に cut の大きさが増えない方を選ぶ (前の cut を X とすると、S ∪ X か S \ X は s-t mincut になる)
+// どちらでも増えてしまう group は交わったまま残す. cut->vs を変えたら true
+template<class flow_t, class disjoint_cut_set_t>
+bool uncross_cut(flow_t& dz, const disjoint_cut_set_t& dcs, basic_mincut_result<typename flow_t::cap_t>* cut) {
+  typedef typename flow_t::cap_t cap_t;
+  std::vector<V>& vs = cut->vs;
+  const V other = vs[0] == cut->s ? cut->t : cut->s;
+
+  // 一部だけ含まれている group を探す. 殆どの場合は他の group の頂点を含まないので、ここで終わる
+  std::vector<std::pair<int, V>> members;
+  for (std::size_t i = 1; i < vs.size(); i++) {
+    const V x = vs[i];
+    if (x >= dcs.node_num() || dcs.is_same_group(other, x)) continue;
+    const int g = dcs.group_id(x);
+    if (dcs.group_size(g) >= 2) members.emplace_back(g, x);
+  }
+  if (members.empty()) return false;
+  std::sort(members.begin(), members.end());
+  std::vector<int> crossing;
+  for (std::size_t i = 0, j; i < members.size(); i = j) {
+    for (j = i; j < members.size() && members[j].first == members[i].first; j++) {}
+    if (int(j - i) < dcs.group_size(members[i].first)) crossing.push_back(members[i].first);
+  }
+  if (crossing.empty()) return false;
+
+  std::vector<char> in_side(dz.n()), in_group(dz.n());
+  for (V v : vs) in_side[v] = true;
+  bool changed = false;
+  for (int g : crossing) {
+    const std::vector<int> group = dcs.get_group(g);
+    for (V u : group) in_group[u] = true;
+    // group を含めた時と除いた時の cut の大きさの差. 無向辺なので両向きの残余の和の半分が容量
+    cap_t delta_add = cap_t(), delta_remove = cap_t();
+    for (V u : group) {
+      for (auto e : dz.edges(u)) {
+        const V to = dz.to(e);
+        if (in_group[to] && to < u) continue; // group の中の辺は1回だけ数える
+        const cap_t c = (dz.cap(e) + dz.cap(dz.rev(e))) / 2;
+        const int now = in_side[u] != in_side[to];
+        const int added = in_group[to] ? 0 : !in_side[to];
+        const int removed = in_group[to] ? 0 : in_side[to];
+        delta_add += c * (added - now);
+        delta_remove += c * (removed - now);
+      }
+    }
+    for (V u : group) in_group[u] = false;
+
+    if (!is_lt(cap_t(), delta_add) || !is_lt(cap_t(), delta_remove)) {
+      const bool add = !is_lt(cap_t(), delta_add);
+      for (V u : group) in_side[u] = add;
+      changed = true;
+    }
+  }
+  if (!changed) return false;
+
+  // vs[0] を先頭に保ったまま作り直す
+  const V head = vs[0];
+  vs.assign(1, head);
+  in_side[head] = false;
+  for (V v = 0; v < dz.n(); v++) {
+    if (in_side[v]) vs.push_back(v);
+  }
+  return true;
+}
+
+// separate_all の1スレッド分
+// 自前の残余グラフと disjoint_cut_set を持ち、割り当てられた group を最後まで分割する
+// 縮約はしない (縮約の有無がスレッドへの割り当て順に依存してしまうため)
+template<class flow_t, class disjoint_cut_set_t>
+class separate_all_worker {
+public:
+  typedef typename flow_t::cap_t cap_t;
+  typedef basic_mincut_result<cap_t> mincut_result;
+
+  separate_all_worker(const flow_t& dz, const disjoint_cut_set_t& dcs, const cap_t upper_bound)
+    : dz_(dz), dcs_(dcs), used_(dz.n()), used_revision_(0), upper_bound_(upper_bound) {}
+
+  void separate_group(const int group_id, std::vector<mincut_result>* cuts) {
+    std::vector<int> groups(1, group_id);
+    while (!groups.empty()) {
+      const int g = groups.back(); groups.pop_back();
+      while (dcs_.has_two_elements(g)) {
+        V s, t; std::tie(s, t) = dcs_.get_two_elements(g);
+        if (dz_.edges(s).size() > dz_.edges(t).size()) std::swap(s, t);
+
+        mincut_result cut;
+        bounded_mincut(dz_, s, t, upper_bound_, ++used_revision_, &used_, &cut);
+
+        // separator と同じ規則で group を分ける
+        const V root = cut.vs[0];
+        const V other = root == s ? t : s;
+        dcs_.create_new_group(root);
+        for (size_t i = 1; i < cut.vs.size(); i++) {
+          if (dcs_.is_same_group(other, cut.vs[i])) dcs_.move_other_group(cut.vs[i], root);
+        }
+        groups.push_back(dcs_.group_id(root));
+        cuts->emplace_back(std::move(cut));
+      }
+    }
+  }
+
+private:
+  flow_t dz_;
+  disjoint_cut_set_t dcs_;
+  std::vector<int> used_;
+  int used_revision_;
+  const cap_t upper_bound_;
+};
+
+// separate_all を num_threads 本のスレッドで行う
+// 各 group の mincut をスレッド毎の残余グラフの複製上で求め、(group_id, 頂点対) の順番で sep->commit_cut に渡す
+// 木はスレッド数 (1 を含む) に依らない. 縮約する直列版 (-cut_tree_separate_all_threads=-1) の木とは
+// 辺が異なることがある (どちらも Gomory-Hu 木なので、任意の頂点対の答えと辺の重みの多重集合は同じ)
+template<class separator_t, class flow_t, class disjoint_cut_set_t>
+void parallel_separate_all(separator_t* sep, const flow_t& dz, const disjoint_cut_set_t& dcs,
+                           const int num_vertices, const int num_threads,
+                           const typename flow_t::cap_t upper_bound = std::numeric_limits<typename flow_t::cap_t>::max()) {
+  typedef separate_all_worker<flow_t, disjoint_cut_set_t> worker_t;
+  typedef typename worker_t::mincut_result mincut_result;
+
+  std::vector<int> groups;
+  for (int group_id = 0; group_id < num_vertices; group_id++) {
+    if (dcs.group_size(group_id) >= 2) groups.push_back(group_id);
+  }
+
+  std::vector<std::vector<mincut_result>> cuts(groups.size());
+  {
+    std::vector<std::unique_ptr<worker_t>> workers(num_threads);
+    parallel_for(int(groups.size()), num_threads, [&](int i, int thread_id) {
+      // 残余グラフの複製もそれぞれのスレッドで作る
+      if (!workers[thread_id]) workers[thread_id].reset(new worker_t(dz, dcs, upper_bound));
+      workers[thread_id]->separate_group(groups[i], &cuts[i]);
+    });
+  }
+
+  const long long n = dz.n();
+  std::unordered_map<long long, const mincut_result*> cut_of_pair;
+  for (auto& cs : cuts) for (auto& cut : cs) cut_of_pair[cut.s * n + cut.t] = &cut;
+
+  for (int group_id = 0; group_id < num_vertices; group_id++) {
+    while (dcs.has_two_elements(group_id)) {
+      V s, t; std::tie(s, t) = dcs.get_two_elements(group_id);
+      if (dz.edges(s).size() > dz.edges(t).size()) std::swap(s, t);
+      auto it = cut_of_pair.find(s * n + t);
+      if (it != cut_of_pair.end()) {
+        sep->commit_cut(*it->second);
+      } else {
+        // worker は同じ規則で group を分けるので普通は起こらないが、その時はこのスレッドで求める
+        sep->mincut(s, t, false);
+      }
+    }
+  }
+}
+
+} // namespace cut_tree_internal
+} // namespace agl
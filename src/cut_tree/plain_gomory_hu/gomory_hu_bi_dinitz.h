@@ -5,8 +5,14 @@ namespace agl {
 namespace cut_tree_internal {
 namespace plain_gomory_hu {
 class gomory_hu_bi_dinitz {
-  void separate_all(separator& sep) {
+  template<class flow_t>
+  void separate_all(separator<flow_t>& sep) {
     const disjoint_cut_set& dcs = sep.get_disjoint_cut_set();
+    if (FLAGS_cut_tree_separate_all_threads >= 0) {
+      const int num_threads = resolve_num_threads(FLAGS_cut_tree_separate_all_threads);
+      parallel_separate_all(&sep, sep.get_bi_dinitz(), dcs, num_vertices_, num_threads);
+      return;
+    }
     for(int group_id = 0; group_id < num_vertices_; group_id++) {
       while (dcs.has_two_elements(group_id)) {
         V s, t; std::tie(s, t) = dcs.get_two_elements(group_id);
@@ -15,6 +21,22 @@ class gomory_hu_bi_dinitz {
     }
   }
 
+  template<class flow_t>
+  void find_cuts_by_max_flow(std::vector<std::pair<V, V>>&& edges, disjoint_cut_set& dcs) {
+    //dinicの初期化
+    flow_t dz_base(std::move(edges), num_vertices_);
+    if(num_vertices_ > 10000) fprintf(stderr, "gomory_hu_bi_dinitz::bi_dinitz after init : memory %ld MB\n", jlog_internal::get_memory_usage() / 1024);
+
+    separator<flow_t> sep(dz_base, dcs, gh_builder_);
+
+    // 残った頂点groupをcutする、gomory_hu treeの完成
+    JLOG_ADD_BENCHMARK_IF("time.separate_all", num_vertices_ > 10000) {
+      separate_all(sep);
+    }
+
+    sep.output_debug_infomation();
+  }
+
 public:
 
   gomory_hu_bi_dinitz(std::vector<std::pair<V, V>>&& edges, int num_vs) :
@@ -26,18 +48,27 @@ public:
 
     disjoint_cut_set dcs(num_vs);
 
-    //dinicの初期化
-    bi_dinitz dz_base(std::move(edges), num_vs);
-    if(num_vs > 10000) fprintf(stderr, "gomory_hu_bi_dinitz::bi_dinitz after init : memory %ld MB\n", jlog_internal::get_memory_usage() / 1024);
-
-    separator sep(dz_base, dcs, gh_builder_);
-
-    // 残った頂点groupをcutする、gomory_hu treeの完成
-    JLOG_ADD_BENCHMARK_IF("time.separate_all", num_vertices_ > 10000) {
-      separate_all(sep);
+    if (FLAGS_cut_tree_residual_graph_layout != "aos" && FLAGS_cut_tree_residual_graph_layout != "soa") {
+      FAIL_MSG("unknown cut_tree_residual_graph_layout: " + FLAGS_cut_tree_residual_graph_layout);
+    }
+    const bool aos = FLAGS_cut_tree_residual_graph_layout == "aos";
+    std::string engine = FLAGS_cut_tree_flow_engine;
+    if (engine == "auto") {
+      const double average_degree = num_vs > 0 ? 2.0 * edges.size() / num_vs : 0;
+      engine = average_degree >= FLAGS_cut_tree_push_relabel_min_average_degree ? "push_relabel" : "bi_dinitz";
+    }
+    if (engine == "bi_dinitz") {
+      if (aos) find_cuts_by_max_flow<bi_dinitz>(std::move(edges), dcs);
+      else find_cuts_by_max_flow<soa_bi_dinitz>(std::move(edges), dcs);
+    } else if (engine == "boykov_kolmogorov") {
+      if (aos) find_cuts_by_max_flow<boykov_kolmogorov>(std::move(edges), dcs);
+      else find_cuts_by_max_flow<soa_boykov_kolmogorov>(std::move(edges), dcs);
+    } else if (engine == "push_relabel") {
+      if (aos) find_cuts_by_max_flow<push_relabel>(std::move(edges), dcs);
+      else find_cuts_by_max_flow<soa_push_relabel>(std::move(edges), dcs);
+    } else {
+      FAIL_MSG("unknown cut_tree_flow_engine: " + engine);
     }
-
-    sep.output_debug_infomation();
 
     gh_builder_.build();
     //gh_builder_.test(g);
@@ -1,9 +1,12 @@
 #pragma once
 #include "gomory_hu_tree_builder.h"
+#include "../parallel_separate_all.h"
 
 namespace agl {
 namespace cut_tree_internal {
 namespace plain_gomory_hu {
+// flow_t の interface は cut_tree_with_2ecc.cc の separator と同じ (compact は使わない)
+template<class flow_t>
 class separator {
 
   const int used_flag_value() const {
@@ -24,16 +27,8 @@ class separator {
     }
   }
 
-  int max_flow(const V s, const V t) {
-    int cost = dz_.max_flow(s, t);
-    debug_last_max_flow_cost_ = cost;
-
-    // fprintf(stderr, "(%d,%d) : %d\n", s, t, cost);
-    //debug infomation
-    
-    max_flow_times_++;
-    print_progress_at_regular_intervals(s, t, cost);
-
+  // 求めた mincut で disjoint_cut_set を分割し、gomory_hu treeの枝を登録する
+  void apply_cut(const mincut_result& cut) {
     cross_other_mincut_count_ = 0;
     auto check_crossed_mincut = [this](const V add) {
       if(add >= int(this->mincut_group_revision_.size())) return ;
@@ -52,60 +47,36 @@ class separator {
       if(this->mincut_group_counter_[group_id] == group_size) this->cross_other_mincut_count_--;
     };
 
-    //s側の頂点とt側の頂点に分類する
-    std::queue<int> q;
-    std::vector<int> vs;
-    const int F = used_flag_value();
-    int one_side = 0;
-    if (dz_.reason_for_finishing_bfs() == bi_dinitz::kQsIsEmpty) {
-      //s側に属する頂点の親を新しいgroupに移動する
-      q.push(s);
-      vs.emplace_back(s);
-      grouping_used_[s] = F;
-      dcs_.create_new_group(s);
-      while (!q.empty()) {
-        V v = q.front(); q.pop();
-        one_side++;
-        for (auto& e : dz_.edges(v)) {
-          const int cap = dz_.cap(e);
-          if (cap == 0 || grouping_used_[dz_.to(e)] == F) continue;
-          grouping_used_[dz_.to(e)] = F;
-          q.push(dz_.to(e));
-	  vs.emplace_back(dz_.to(e));
-          if (dcs_.is_same_group(t, dz_.to(e))) {
-            dcs_.move_other_group(dz_.to(e), s); //tと同じgroupにいた頂点を、s側のgroupに移動
-          } else {
-            check_crossed_mincut(dz_.to(e));
-          }
-        }
+    //vs[0]側の頂点の親を新しいgroupに移動し、もう一方と同じgroupにいた頂点をvs[0]側のgroupに移動する
+    const V root = cut.vs[0];
+    const V other = root == cut.s ? cut.t : cut.s;
+    dcs_.create_new_group(root);
+    for (size_t i = 1; i < cut.vs.size(); i++) {
+      const V x = cut.vs[i];
+      if (dcs_.is_same_group(other, x)) {
+        dcs_.move_other_group(x, root);
+      } else {
+        check_crossed_mincut(x);
       }
-      gh_builder_.add_edge(s, t, cost, vs, dcs_); //cutした結果をgomory_hu treeの枝を登録
-    } else {
-      //t側に属する頂点の親を,tに変更する
-      q.push(t);
-      vs.emplace_back(t);
-      grouping_used_[t] = F;
-      dcs_.create_new_group(t);
-      while (!q.empty()) {
-        V v = q.front(); q.pop();
-        one_side++;
-        for (auto& e : dz_.edges(v)) {
-          const int cap = dz_.cap(dz_.rev(e));
-          if (cap == 0 || grouping_used_[dz_.to(e)] == F) continue;
-          grouping_used_[dz_.to(e)] = F;
-          q.push(dz_.to(e));
-	  vs.emplace_back(dz_.to(e));
-          if (dcs_.is_same_group(s, dz_.to(e))) {
-            dcs_.move_other_group(dz_.to(e), t); //sと同じgroupにいた頂点を、t側のgroupに移動
-          } else {
-            check_crossed_mincut(dz_.to(e));
-          }
-        }
-      }
-      gh_builder_.add_edge(t, s, cost, vs, dcs_); //cutした結果をgomory_hu treeの枝を登録
     }
+    gh_builder_.add_edge(root, other, cut.cost, cut.vs, dcs_); //cutした結果をgomory_hu treeの枝を登録
+  }
 
-    return one_side;
+  int max_flow(const V s, const V t) {
+    int cost = dz_.max_flow(s, t);
+    debug_last_max_flow_cost_ = cost;
+
+    // fprintf(stderr, "(%d,%d) : %d\n", s, t, cost);
+    //debug infomation
+    
+    max_flow_times_++;
+    print_progress_at_regular_intervals(s, t, cost);
+
+    //s側の頂点とt側の頂点に分類する
+    mincut_result cut(s, t, cost);
+    collect_cut_side(dz_, used_flag_value(), &grouping_used_, &cut);
+    apply_cut(cut);
+    return int(cut.vs.size());
   }
 
   void contraction(const V s,const V t) {
@@ -115,7 +86,7 @@ class separator {
     const int sside_new_vtx = dz_.n();
     const int tside_new_vtx = sside_new_vtx + 1;
     for(int _ = 0; _ < 2; _++) {
-      dz_.add_vertex();
+      dz_.add_vertex(debug_last_max_flow_cost_); // 縮約後の頂点には、cutの辺がつなぎ直される
       grouping_used_.emplace_back();
       contraction_used_.emplace_back();
     }
@@ -125,12 +96,12 @@ class separator {
     std::queue<int> q;
     const int F = used_flag_value();
     int num_reconnected = 0; //枝を繋ぎ直した回数
-    if (dz_.reason_for_finishing_bfs() == bi_dinitz::kQsIsEmpty) {
+    if (dz_.reason_for_finishing_bfs() == flow_t::kQsIsEmpty) {
       q.push(s);
       contraction_used_[s] = F;
       while (!q.empty()) {
         V v = q.front(); q.pop();
-        for (auto& e : dz_.edges(v)) {
+        for (auto e : dz_.edges(v)) {
           const int cap = dz_.cap(e);
           if (contraction_used_[dz_.to(e)] == F) continue;
           if (cap == 0) {
@@ -150,7 +121,7 @@ class separator {
       contraction_used_[t] = F;
       while (!q.empty()) {
         V v = q.front(); q.pop();
-        for (auto& e : dz_.edges(v)) {
+        for (auto e : dz_.edges(v)) {
           const int cap = dz_.cap(dz_.rev(e));
           if (contraction_used_[dz_.to(e)] == F) continue;
           if (cap == 0) {
@@ -171,7 +142,7 @@ class separator {
 
 public:
 
-  separator(bi_dinitz& dz, disjoint_cut_set& dcs, gomory_hu_tree_builder& gh_builder) 
+  separator(flow_t& dz, disjoint_cut_set& dcs, gomory_hu_tree_builder& gh_builder) 
     : dz_(dz), dcs_(dcs), gh_builder_(gh_builder),
       max_flow_times_(0), contraction_count_(0), grouping_used_(dz.n()), contraction_used_(dz.n()), 
       mincut_group_counter_(dcs.node_num()), mincut_group_revision_(dcs.node_num()) {
@@ -203,6 +174,18 @@ public:
     debug_count_cut_size_for_a_period_[one_side]++;
   }
 
+  // 別の残余グラフ上で求めた mincut を反映する (縮約は行わない)
+  void commit_cut(const mincut_result& cut) {
+    debug_last_max_flow_cost_ = cut.cost;
+    max_flow_times_++;
+    print_progress_at_regular_intervals(cut.s, cut.t, cut.cost);
+    apply_cut(cut);
+
+    const int one_side = int(cut.vs.size());
+    debug_count_cut_size_all_time_[one_side]++;
+    debug_count_cut_size_for_a_period_[one_side]++;
+  }
+
   void output_debug_infomation() const {
     if (debug_count_cut_size_all_time_.size() > 10) {
       std::stringstream ss;
@@ -230,14 +213,14 @@ public:
     if(dcs_.node_num() > 10000) fprintf(stderr, "OK\n");
   }
 
-  const bi_dinitz& get_bi_dinitz() const { return dz_; }
+  const flow_t& get_bi_dinitz() const { return dz_; }
   const disjoint_cut_set& get_disjoint_cut_set() const { return dcs_; }
 
   const int contraction_count() { return contraction_count_; }
 
 private:
 
-  bi_dinitz& dz_;
+  flow_t& dz_;
   disjoint_cut_set& dcs_;
   gomory_hu_tree_builder& gh_builder_;
 
@@ -0,0 +1,450 @@
+#include "push_relabel.h"
+
+DEFINE_double(cut_tree_push_relabel_min_average_degree, 256, "with -cut_tree_flow_engine=auto, use push_relabel for 2-edge-connected components whose average degree is at least this");
+
+using namespace std;
+
+namespace agl {
+
+template<class residual_graph_t>
+basic_push_relabel<residual_graph_t>::basic_push_relabel(const G& g) : n_(g.num_vertices()) {
+  std::vector<int> degree(n_);
+  for (int v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
+    degree[v]++;
+    degree[agl::to(e)]++;
+  }
+  init(degree);
+  for (int v = 0; v < n_; v++) for (auto& e : g.edges(v)) {
+    arcs_.add_undirected_edge(v, agl::to(e));
+  }
+}
+
+template<class residual_graph_t>
+basic_push_relabel<residual_graph_t>::basic_push_relabel(vector<pair<V, V>>&& edges, int num_vs) : n_(num_vs) {
+  std::vector<int> degree(n_);
+  for (auto& uv : edges) degree[uv.first]++, degree[uv.second]++;
+  init(degree);
+
+  //こまめに解放しながら辺を追加していく
+  while (edges.size() >= 1) {
+    std::size_t loop = std::max(edges.size() / 2, size_t(10000));
+    loop = std::min(loop, edges.size());
+    while (loop--) {
+      auto& uv = edges.back();
+      arcs_.add_undirected_edge(uv.first, uv.second);
+      edges.pop_back();
+    }
+    edges.shrink_to_fit();
+  }
+}
+
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::init(const vector<int>& degree) {
+  s_ = t_ = root_ = -1;
+  use_root_distance_ = false;
+  reason_for_finishing_bfs_ = kQsIsEmpty;
+  resize_vertices();
+  arcs_.init(degree);
+}
+
+// 頂点毎の状態を n_ 頂点分に作り直す
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::resize_vertices() {
+  label_.assign(n_, 0);
+  label_stamp_.assign(n_, 0);
+  stamp_ = 1;
+  far_label_ = n_;
+  iter_.assign(n_, 0);
+  excess_.assign(n_, 0);
+  excess_vertices_.clear();
+  dead_vertices_.clear();
+  all_head_.assign(n_ + 1, -1);
+  all_next_.assign(n_, -1);
+  all_prev_.assign(n_, -1);
+  active_head_.assign(n_ + 1, -1);
+  active_next_.assign(n_, -1);
+  max_label_ = max_active_ = -1;
+  side_stamp_.assign(n_, 0);
+  side_stamp_base_ = 0;
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::add_vertex(int num_reserved_edges) {
+  label_.emplace_back();
+  label_stamp_.emplace_back();
+  iter_.emplace_back();
+  excess_.emplace_back();
+  all_head_.emplace_back(-1);
+  all_next_.emplace_back(-1);
+  all_prev_.emplace_back(-1);
+  active_head_.emplace_back(-1);
+  active_next_.emplace_back(-1);
+  side_stamp_.emplace_back();
+  root_ = -1;
+  arcs_.add_vertex(num_reserved_edges);
+  n_++;
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx) {
+  root_ = -1;
+  arcs_.reconnect_edge(rm, sside_vtx, tside_vtx);
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::compact(const vector<int>& new_id, int new_n) {
+  CHECK(int(new_id.size()) == n_);
+  arcs_.compact(new_id, new_n);
+  n_ = new_n;
+  s_ = t_ = root_ = -1;
+  resize_vertices();
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::clear_labels() {
+  if (stamp_ == numeric_limits<int>::max()) {
+    fill(label_stamp_.begin(), label_stamp_.end(), 0);
+    stamp_ = 0;
+  }
+  stamp_++;
+  far_label_ = n_;
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::set_label(int v, int d) {
+  label_stamp_[v] = stamp_;
+  label_[v] = d;
+  iter_[v] = 0;
+  if (d < n_) insert_label(v);
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::add_excess(int v, cap_t f) {
+  if (excess_[v] == 0 && v != s_ && v != t_) excess_vertices_.push_back(v);
+  excess_[v] += f;
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::insert_label(int v) {
+  const int d = label_[v];
+  all_prev_[v] = -1;
+  all_next_[v] = all_head_[d];
+  if (all_head_[d] != -1) all_prev_[all_head_[d]] = v;
+  all_head_[d] = v;
+  max_label_ = max(max_label_, d);
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::erase_label(int v) {
+  const int d = label_[v];
+  if (all_prev_[v] != -1) all_next_[all_prev_[v]] = all_next_[v];
+  else all_head_[d] = all_next_[v];
+  if (all_next_[v] != -1) all_prev_[all_next_[v]] = all_prev_[v];
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::push_active(int v) {
+  const int d = label_[v];
+  active_next_[v] = active_head_[d];
+  active_head_[d] = v;
+  max_active_ = max(max_active_, d);
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::clear_lists() {
+  if (max_label_ >= 0) fill(all_head_.begin(), all_head_.begin() + max_label_ + 1, -1);
+  if (max_active_ >= 0) fill(active_head_.begin(), active_head_.begin() + max_active_ + 1, -1);
+  max_label_ = max_active_ = -1;
+}
+
+// 超過のある頂点 (s の隣) にだけラベルを付ける
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::root_distance_relabel() {
+  clear_lists();
+  use_root_distance_ = true;
+  set_label(s_, n_);
+  set_label(t_, 0);
+  for (int v : excess_vertices_) {
+    if (excess_[v] == 0 || labeled(v)) continue;
+    set_label(v, root_distance_[v]);
+    if (label_[v] < n_) push_active(v);
+  }
+  relabel_work_ = 0;
+  relabel_budget_ = root_relabel_budget_;
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::global_relabel() {
+  // 超過の残っている頂点を数える. gap で n になった頂点は、この先も t に辿れないので除く
+  int num_excess = 0;
+  for (int v : excess_vertices_) {
+    if (excess_[v] == 0) continue;
+    if (labeled(v) && label_[v] == n_) dead_vertices_.push_back(v);
+    else excess_vertices_[num_excess++] = v;
+  }
+  excess_vertices_.resize(num_excess);
+
+  clear_lists();
+  clear_labels();
+  use_root_distance_ = false;
+
+  int64_t num_arcs = 0;
+  set_label(s_, n_);
+  set_label(t_, 0);
+  queue_.assign(1, t_);
+  for (size_t i = 0; i < queue_.size(); i++) {
+    const int v = queue_[i];
+    if (num_excess == 0 && i > 0 && label_[v] != label_[queue_[i - 1]]) {
+      far_label_ = label_[v] + 1;
+      break;
+    }
+    arcs_.scan(v);
+    num_arcs += degree(v);
+    for (auto a : arcs_.arcs(v)) {
+      const int w = arcs_.to(a);
+      if (labeled(w) || arcs_.rev_cap(a) == 0) continue;
+      set_label(w, label_[v] + 1);
+      if (excess_[w] > 0) {
+        push_active(w);
+        num_excess--;
+      }
+      queue_.push_back(w);
+    }
+  }
+
+  // 辿った部分の大きさに比例するだけ relabel したら、もう一度ラベルを求め直す
+  relabel_work_ = 0;
+  relabel_budget_ = 6 * int64_t(queue_.size()) + num_arcs;
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::relabel(int v) {
+  const int old = label_[v];
+  int d = n_;
+  for (auto a : arcs_.arcs(v)) {
+    if (arcs_.cap(a) > 0) d = min(d, label(arcs_.to(a)) + 1);
+  }
+  relabel_work_ += degree(v) + 12;
+
+  erase_label(v);
+  iter_[v] = 0;
+  if (!use_root_distance_ && old != far_label_ && all_head_[old] == -1) {
+    // gap: old より上のラベルの頂点は t に辿れない. old が far_label_ より下なら、ラベルの付いていない頂点も
+    for (int l = old + 1; l <= max_label_; l++) {
+      for (int w = all_head_[l]; w != -1; w = all_next_[w]) label_[w] = n_;
+      all_head_[l] = -1;
+    }
+    max_label_ = old - 1;
+    if (old < far_label_) far_label_ = n_;
+    label_[v] = n_;
+  } else {
+    label_[v] = d;
+    if (d < n_) insert_label(v);
+  }
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::discharge(int v) {
+  arcs_.scan(v);
+  const auto as = arcs_.arcs(v);
+  while (excess_[v] > 0) {
+    if (iter_[v] == int(as.size())) {
+      relabel(v);
+      if (label_[v] >= n_) return;
+      continue;
+    }
+    const arc_t a = as[iter_[v]];
+    const int w = arcs_.to(a);
+    const cap_t c = arcs_.cap(a);
+    if (c == 0 || label_[v] != label(w) + 1) {
+      iter_[v]++;
+      continue;
+    }
+    const cap_t f = min(excess_[v], c);
+    arcs_.push(a, f);
+    // w のラベルは v より低いので n 未満
+    if (!labeled(w)) set_label(w, label(w));
+    if (excess_[w] == 0 && w != t_) push_active(w);
+    add_excess(w, f);
+    excess_[v] -= f;
+  }
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::choose_cut_side() {
+  if (side_stamp_base_ >= numeric_limits<int>::max() - 2) {
+    fill(side_stamp_.begin(), side_stamp_.end(), 0);
+    side_stamp_base_ = 0;
+  }
+  side_stamp_base_ += 2;
+  const int s_side = side_stamp_base_, t_side = side_stamp_base_ + 1;
+  side_queue_[0].assign(1, s_);
+  side_queue_[1].assign(1, t_);
+  side_stamp_[s_] = s_side;
+  side_stamp_[t_] = t_side;
+  for (int v : excess_vertices_) {
+    if (excess_[v] == 0 || side_stamp_[v] == s_side) continue;
+    side_stamp_[v] = s_side;
+    side_queue_[0].push_back(v);
+  }
+  for (int v : dead_vertices_) {
+    if (side_stamp_[v] == s_side) continue;
+    side_stamp_[v] = s_side;
+    side_queue_[0].push_back(v);
+  }
+
+  // 辿った辺の数が少ない方を進める. 2つの側は残余グラフで行き来できないので交わらない
+  size_t head[2] = {0, 0};
+  int64_t num_arcs[2] = {0, 0};
+  for (;;) {
+    const int k = num_arcs[0] <= num_arcs[1] ? 0 : 1;
+    if (head[k] == side_queue_[k].size()) {
+      if (k == 0) return_excess();
+      reason_for_finishing_bfs_ = k == 0 ? kQsIsEmpty : kQtIsEmpty;
+      return;
+    }
+    const int v = side_queue_[k][head[k]++];
+    arcs_.scan(v);
+    num_arcs[k] += degree(v);
+    for (auto a : arcs_.arcs(v)) {
+      const int w = arcs_.to(a);
+      if (side_stamp_[w] == side_stamp_base_ + k) continue;
+      if ((k == 0 ? arcs_.cap(a) : arcs_.rev_cap(a)) == 0) continue;
+      side_stamp_[w] = side_stamp_base_ + k;
+      side_queue_[k].push_back(w);
+    }
+  }
+}
+
+// 超過のある頂点には入ってくる flow があるので、それを1つずつ打ち消しながら s まで戻る
+// flow は減る一方なので、辺を調べる位置 iter_ は戻さなくてよい. ラベルはもう使わないので、label_stamp_ を iter_ を初期化したかの印にする
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::return_excess() {
+  clear_labels();
+  auto return_from = [this](int v) {
+    while (excess_[v] > 0) {
+      for (int u = v; u != s_;) {
+        if (!labeled(u)) {
+          label_stamp_[u] = stamp_;
+          iter_[u] = 0;
+        }
+        arcs_.scan(u);
+        const auto as = arcs_.arcs(u);
+        // 容量1の無向辺では、u -> w の容量が 2 なら w -> u に flow がある
+        while (arcs_.cap(as[iter_[u]]) < 2) iter_[u]++;
+        const arc_t a = as[iter_[u]];
+        const int w = arcs_.to(a);
+        arcs_.push(a, 1);
+        excess_[u]--;
+        excess_[w]++;
+        u = w;
+      }
+    }
+  };
+  for (int v : excess_vertices_) return_from(v);
+  for (int v : dead_vertices_) return_from(v);
+}
+
+template<class residual_graph_t>
+typename basic_push_relabel<residual_graph_t>::cap_t basic_push_relabel<residual_graph_t>::max_flow(int s, int t) {
+  return max_flow(s, t, numeric_limits<cap_t>::max());
+}
+
+template<class residual_graph_t>
+typename basic_push_relabel<residual_graph_t>::cap_t basic_push_relabel<residual_graph_t>::max_flow(int s, int t, cap_t upper_bound) {
+  assert(s != t);
+  reset_graph();
+  s_ = s;
+  t_ = t;
+
+  // bi_dinitz と同じく、s, t の容量に達したらそれ以上流れないので打ち切る
+  // s の容量に達したら超過分は全て t に届いているので、s 側から辿っても cut になる
+  const cap_t capacity_s = arcs_.capacity(s), capacity_t = arcs_.capacity(t);
+  auto finished = [&]() {
+    const cap_t f = excess_[t_];
+    if (f >= capacity_s) {
+      reason_for_finishing_bfs_ = kQsIsEmpty;
+    } else if (f >= capacity_t) {
+      reason_for_finishing_bfs_ = kQtIsEmpty;
+    } else if (f >= upper_bound) {
+      reason_for_finishing_bfs_ = kReachedUpperBound;
+    } else {
+      return false;
+    }
+    return true;
+  };
+
+  arcs_.scan(s);
+  for (auto a : arcs_.arcs(s)) {
+    const cap_t c = arcs_.cap(a);
+    if (c == 0) continue;
+    arcs_.push(a, c);
+    add_excess(arcs_.to(a), c);
+  }
+  if (t == root_) root_distance_relabel();
+  else global_relabel();
+
+  while (!finished()) {
+    if (max_active_ < 0) {
+      choose_cut_side();
+      break;
+    }
+    const int v = active_head_[max_active_];
+    if (v == -1) {
+      max_active_--;
+      continue;
+    }
+    active_head_[max_active_] = active_next_[v];
+    if (label_[v] != max_active_ || excess_[v] == 0) continue;
+    discharge(v);
+    if (relabel_work_ > relabel_budget_) global_relabel();
+  }
+  return excess_[t_];
+}
+
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::goal_oriented_bfs_init(int root) {
+  root_ = root;
+  root_distance_.assign(n_, n_);
+  root_distance_[root] = 0;
+  queue_.assign(1, root);
+  int64_t num_arcs = 0;
+  for (size_t i = 0; i < queue_.size(); i++) {
+    const int v = queue_[i];
+    num_arcs += degree(v);
+    for (auto a : arcs_.arcs(v)) {
+      const int w = arcs_.to(a);
+      if (root_distance_[w] != n_) continue;
+      root_distance_[w] = root_distance_[v] + 1;
+      queue_.push_back(w);
+    }
+  }
+  // global_relabel で root から全て辿った時と同じだけ relabel してよい
+  root_relabel_budget_ = 6 * int64_t(queue_.size()) + num_arcs;
+
+  // 隣接頂点の距離の差は -1, 0, 1 のどれかなので、比較せずに並べる
+  const auto& dep = root_distance_;
+  for (int v = 0; v < n_; v++) {
+    const int base = dep[v] - 1;
+    arcs_.partition_arcs(v, [&dep, base](int w) { return dep[w] - base; });
+  }
+}
+
+// 容量と、前の max_flow の超過とラベルを戻す
+template<class residual_graph_t>
+void basic_push_relabel<residual_graph_t>::reset_graph() {
+  arcs_.next_revision();
+  clear_labels();
+  for (int v : excess_vertices_) excess_[v] = 0;
+  for (int v : dead_vertices_) excess_[v] = 0;
+  excess_vertices_.clear();
+  dead_vertices_.clear();
+  if (s_ >= 0) excess_[s_] = 0;
+  if (t_ >= 0) excess_[t_] = 0;
+}
+
+template class basic_push_relabel<aos_residual_graph>;
+template class basic_push_relabel<soa_residual_graph>;
+
+} //namespace agl
@@ -0,0 +1,145 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+#include <limits>
+#include "residual_graph.h"
+
+DECLARE_double(cut_tree_push_relabel_min_average_degree);
+
+namespace agl {
+
+// 容量1の無向グラフ用の push-relabel (highest-label, gap, global relabeling)
+// s から出る辺を全て飽和させ、ラベルの最も高い頂点から超過分を t 側に押し出す
+// 押し出せずに残った超過分は、cut を s 側から辿る時だけ s に戻す
+// 密な 2辺連結成分では、bi_dinitz のように増加路毎の bfs を繰り返さずに済む
+//
+// separator から見た interface は basic_bi_dinitz と同じ (cut_tree_with_2ecc.cc の separator を参照)
+// residual_graph_t は容量1の残余グラフ (aos_residual_graph, soa_residual_graph)
+template<class residual_graph_t>
+class basic_push_relabel {
+public:
+  typedef typename residual_graph_t::arc_t arc_t;
+  typedef typename residual_graph_t::const_arc_t const_arc_t;
+  typedef typename residual_graph_t::cap_t cap_t;
+
+  // maxflow が終了した理由
+  enum reason_for_finishing_bfs_t {
+    kQsIsEmpty,
+    kQtIsEmpty,
+    // upper_bound に達して打ち切った (残余グラフから cut は求まらない)
+    kReachedUpperBound,
+  };
+
+private:
+  // t から残余グラフを逆向きに bfs して、ラベルを t までの距離にする
+  // 超過のある頂点に全てラベルが付いたら、その段で打ち切る (残りの頂点は far_label_)
+  void global_relabel();
+  // t が goal_oriented_bfs_init の root なら、bfs の代わりに root からの距離をラベルにして始める
+  void root_distance_relabel();
+  void clear_lists();
+  // v の超過分を、押し出し切るかラベルが n になるまで押し出す
+  void discharge(int v);
+  // v のラベルを上げる. v のいたラベルが空になったら、それより上の頂点は t に辿れないので n にする (gap)
+  void relabel(int v);
+  // 流し終えた後、t 側と s 側 (s と超過の残った頂点から辿れる頂点) を交互に辿り、先に辿り終えた方を cut の側にする
+  // s 側なら、return_excess で超過を s に戻してから kQsIsEmpty にする
+  void choose_cut_side();
+  // 超過の残った頂点から flow を逆に辿って s に戻す. 戻した後の preflow は s から t への flow になる
+  void return_excess();
+
+  // bfs で打ち切った後、まだラベルの付いていない頂点のラベルは far_label_ とする
+  // 辿り終えた段の次の段 + 1 なので、ラベルの条件 (残余のある辺 u -> w で label(u) <= label(w) + 1) は崩れない
+  bool labeled(int v) const { return label_stamp_[v] == stamp_; }
+  int label(int v) const {
+    if (labeled(v)) return label_[v];
+    return use_root_distance_ ? root_distance_[v] : far_label_;
+  }
+  // 全ての頂点のラベルを消す
+  void clear_labels();
+  void set_label(int v, int d);
+  void add_excess(int v, cap_t f);
+
+  // ラベル毎の頂点のリスト (gap 用の全頂点の双方向リストと、active な頂点のスタック)
+  void insert_label(int v);
+  void erase_label(int v);
+  void push_active(int v);
+
+  void init(const std::vector<int>& degree);
+  void resize_vertices();
+  int degree(int v) const { return arcs_.degree(v); }
+
+public:
+  basic_push_relabel() : n_(0) {}
+  basic_push_relabel(const G& g);
+  basic_push_relabel(std::vector<std::pair<V, V>>&& edges, int num_vs);
+
+  void add_vertex(int num_reserved_edges);
+  void reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx);
+  void compact(const std::vector<int>& new_id, int new_n);
+
+  // 流量が s か t の容量 (次数) に達するか、upper_bound 以上流れた所で打ち切る
+  // 流し切った時は、t 側と s 側のうち小さい方を reason_for_finishing_bfs() で返す
+  cap_t max_flow(int s, int t);
+  cap_t max_flow(int s, int t, cap_t upper_bound);
+
+  void reset_graph();
+
+  // root からの距離を求めておき、root に流す時の最初のラベルにする
+  // 辺は bi_dinitz と同じく root に近い順に並べる. 縮約で辺をつなぎ直したら使わない
+  void goal_oriented_bfs_init(int root);
+
+  int n() const { return n_; }
+  reason_for_finishing_bfs_t reason_for_finishing_bfs() const { return reason_for_finishing_bfs_; }
+
+  arc_range<arc_t> edges(V v) { return arcs_.arcs(v); }
+  arc_range<const_arc_t> edges(V v) const { return arcs_.arcs(v); }
+  V to(const_arc_t e) const { return arcs_.to(e); }
+  cap_t cap(arc_t e) {
+    arcs_.scan(arcs_.from(e));
+    return arcs_.cap(e);
+  }
+  arc_t rev(const_arc_t e) { return arcs_.rev(e); }
+
+private:
+  int n_;
+  residual_graph_t arcs_;
+  int s_, t_;
+  reason_for_finishing_bfs_t reason_for_finishing_bfs_;
+
+  // label(v) は t までの距離の下界で、n_ なら t に辿れない. iter_[v] は v から次に調べる辺
+  // label_[v] は label_stamp_[v] == stamp_ の時だけ使う. global_relabel の度に stamp_ を上げて全て消す
+  std::vector<int> label_, label_stamp_, iter_;
+  int stamp_, far_label_;
+  std::vector<cap_t> excess_;
+  // この max_flow で超過を持った頂点 (s, t 以外). 次の max_flow の初めに超過を 0 に戻す
+  // gap で t に辿れなくなった頂点は、global_relabel で dead_vertices_ に移す
+  std::vector<int> excess_vertices_, dead_vertices_;
+
+  // all_head_[d] はラベル d の頂点の双方向リスト、active_head_[d] はラベル d で超過のある頂点のスタック
+  // ラベルが far_label_ のままの頂点は all_head_ に入っていないので、far_label_ では gap を調べない
+  // スタックには、gap でラベルが n になった頂点が残っていることがあるので、取り出す時に読み飛ばす
+  std::vector<int> all_head_, all_next_, all_prev_;
+  std::vector<int> active_head_, active_next_;
+  int max_label_, max_active_;
+
+  // 容量を戻した残余グラフでの root_ からの距離. 残余のある辺 u -> w で root_distance_[u] <= root_distance_[w] + 1 なので、
+  // s の辺を飽和させた直後のラベルにそのまま使える. use_root_distance_ の間は、ラベルの付いていない頂点のラベルになる
+  // (全ての頂点がリストに入っていないので、gap は調べない)
+  int root_;
+  std::vector<int> root_distance_;
+  bool use_root_distance_;
+  int64_t root_relabel_budget_;
+
+  // choose_cut_side で辿った頂点. side_stamp_[v] が side_stamp_base_ なら s 側、+1 なら t 側
+  std::vector<int> side_stamp_;
+  int side_stamp_base_;
+  std::vector<int> side_queue_[2];
+
+  // relabel で調べた辺の数. relabel_budget_ を超えたら global_relabel する
+  int64_t relabel_work_, relabel_budget_;
+  std::vector<int> queue_;
+};
+
+typedef basic_push_relabel<aos_residual_graph> push_relabel;
+typedef basic_push_relabel<soa_residual_graph> soa_push_relabel;
+} //namespace agl
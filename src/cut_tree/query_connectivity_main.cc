@@ -1,13 +1,21 @@
 #include <easy_cui.h>
 #include "cut_tree_query_handler.h"
+#include "cut_tree_binary.h"
 
 DEFINE_string(cut_tree_path, "", "");
 DEFINE_string(query_path, "", "");
 DEFINE_string(output_path, "", "");
+DEFINE_string(cut_tree_query_method, "index", "index, walk");
 
+// バイナリ形式なら mapped_cut_tree で mmap して読む
+template<class cut_tree_t>
 void from_file() {
-  cut_tree_query_handler tq;
-  tq = cut_tree_query_handler::from_file(FLAGS_cut_tree_path);
+  cut_tree_t tq;
+  JLOG_PUT_BENCHMARK("initialize_time") {
+    tq = cut_tree_t::from_file(FLAGS_cut_tree_path);
+  }
+  const bool walk = FLAGS_cut_tree_query_method == "walk";
+  CHECK_MSG(walk || FLAGS_cut_tree_query_method == "index", "unrecognized option -cut_tree_query_method");
   std::ifstream ifs(FLAGS_query_path.c_str());
   ostream* ost;
   if (FLAGS_output_path == "") {
@@ -15,16 +23,28 @@ void from_file() {
   } else {
     ost = new ofstream(FLAGS_output_path.c_str(), ios_base::out);
   }
+  vector<pair<V, V>> queries;
   V s, t;
-  while (ifs >> s >> t) {
-    *ost << tq.query(s, t) << endl;
+  while (ifs >> s >> t) queries.emplace_back(s, t);
+  vector<int> answers(queries.size());
+  JLOG_PUT_BENCHMARK("query_time") {
+    for (size_t i = 0; i < queries.size(); i++) {
+      tie(s, t) = queries[i];
+      answers[i] = walk ? tq.query_by_walk(s, t) : tq.query(s, t);
+    }
   }
+  for (int a : answers) *ost << a << endl;
 }
 
 int main(int argc, char** argv) {
+  JLOG_INIT(&argc, argv);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
 
-  from_file();
+  if (is_cut_tree_binary(FLAGS_cut_tree_path.c_str())) {
+    from_file<mapped_cut_tree>();
+  } else {
+    from_file<cut_tree_query_handler>();
+  }
 
   return 0;
 }
@@ -0,0 +1,241 @@
+#include "residual_graph.h"
+
+using namespace std;
+
+namespace agl {
+
+template<class arc_type>
+basic_aos_residual_graph<arc_type>::basic_aos_residual_graph(const basic_aos_residual_graph& other)
+  : revision_(other.revision_), arcs_first_(other.n()), arcs_last_(other.n()), arcs_limit_(other.n()),
+  arcs_free_first_(nullptr), arcs_free_last_(nullptr) {
+  const int n = other.n();
+  size_t num_arcs = 0;
+  for (int v = 0; v < n; v++) num_arcs += other.arcs_limit_[v] - other.arcs_first_[v];
+  E* cur = allocate_arcs(num_arcs, num_arcs);
+  for (int v = 0; v < n; v++) {
+    arcs_first_[v] = cur;
+    arcs_last_[v] = copy(other.arcs_first_[v], other.arcs_last_[v], cur);
+    arcs_limit_[v] = cur + (other.arcs_limit_[v] - other.arcs_first_[v]);
+    cur = arcs_limit_[v];
+  }
+}
+
+template<class arc_type>
+typename basic_aos_residual_graph<arc_type>::E* basic_aos_residual_graph<arc_type>::allocate_arcs(size_t num_edges, size_t block_size) {
+  if (size_t(arcs_free_last_ - arcs_free_first_) < num_edges) {
+    block_size = max(block_size, num_edges);
+    arcs_blocks_.emplace_back(new E[block_size]);
+    arcs_free_first_ = arcs_blocks_.back().get();
+    arcs_free_last_ = arcs_free_first_ + block_size;
+  }
+  E* ret = arcs_free_first_;
+  arcs_free_first_ += num_edges;
+  return ret;
+}
+
+template<class arc_type>
+void basic_aos_residual_graph<arc_type>::init(const vector<int>& degree) {
+  const int n = int(degree.size());
+  size_t num_arcs = 0;
+  for (int v = 0; v < n; v++) num_arcs += degree[v];
+  E* cur = allocate_arcs(num_arcs, num_arcs);
+  arcs_first_.resize(n);
+  arcs_last_.resize(n);
+  arcs_limit_.resize(n);
+  for (int v = 0; v < n; v++) {
+    arcs_first_[v] = arcs_last_[v] = cur;
+    cur += degree[v];
+    arcs_limit_[v] = cur;
+  }
+}
+
+template<class arc_type>
+void basic_aos_residual_graph<arc_type>::add_undirected_edge(int f, int t, cap_t c) {
+  E* fe = arcs_last_[f]++;
+  E* te = arcs_last_[t]++;
+  CHECK(arcs_last_[f] <= arcs_limit_[f] && arcs_last_[t] <= arcs_limit_[t]); // add_vertex で予約した本数を超えた
+  *fe = E(t, int(te - arcs_first_[t]), c);
+  *te = E(f, int(fe - arcs_first_[f]), c);
+}
+
+template<class arc_type>
+void basic_aos_residual_graph<arc_type>::add_vertex(int num_reserved_edges) {
+  // 縮約の度に領域を確保しないように、ある程度まとめて確保する
+  E* first = allocate_arcs(num_reserved_edges, size_t(1) << 12);
+  arcs_first_.push_back(first);
+  arcs_last_.push_back(first);
+  arcs_limit_.push_back(first + num_reserved_edges);
+}
+
+template<class arc_type>
+void basic_aos_residual_graph<arc_type>::reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx) {
+  const int to = rm->to_;
+  const int to_rev = rm->rev_;
+  E& rm_rev = arcs_first_[to][to_rev];
+  const int from = rm_rev.to_;
+  const int from_rev = rm_rev.rev_;
+
+  add_undirected_edge(sside_vtx, tside_vtx, rm->init_cap());
+  E& se = *arcs(sside_vtx).back();
+  E& te = *arcs(tside_vtx).back();
+
+  rm->to_ = sside_vtx;
+  rm->rev_ = te.rev_;
+  rm_rev.to_ = tside_vtx;
+  rm_rev.rev_ = se.rev_;
+
+  se.to_ = from;
+  se.rev_ = from_rev;
+  te.to_ = to;
+  te.rev_ = to_rev;
+}
+
+template<class arc_type>
+void basic_aos_residual_graph<arc_type>::compact(const vector<int>& new_id, int new_n) {
+  vector<int> old_id(new_n, -1);
+  size_t num_arcs = 0;
+  for (int v = 0; v < n(); v++) {
+    if (new_id[v] == -1) continue;
+    old_id[new_id[v]] = v;
+    num_arcs += degree(v);
+  }
+
+  // 頂点内の辺の順番は変えないので、rev_ (逆辺の行き先での位置) はそのまま使える
+  unique_ptr<E[]> block(new E[num_arcs]);
+  vector<E*> first(new_n), last(new_n);
+  E* cur = block.get();
+  for (int w = 0; w < new_n; w++) {
+    first[w] = cur;
+    if (old_id[w] != -1) cur = copy(arcs_first_[old_id[w]], arcs_last_[old_id[w]], cur);
+    last[w] = cur;
+  }
+  for (E* a = block.get(); a != cur; a++) {
+    CHECK(new_id[a->to_] != -1);
+    a->to_ = new_id[a->to_];
+  }
+
+  arcs_first_ = std::move(first);
+  arcs_limit_ = last;
+  arcs_last_ = std::move(last);
+  arcs_blocks_.clear();
+  arcs_blocks_.emplace_back(std::move(block));
+  arcs_free_first_ = arcs_free_last_ = cur;
+}
+
+template<class arc_type>
+void basic_aos_residual_graph<arc_type>::reset() {
+  for (int v = 0; v < n(); v++) for (auto e : arcs(v)) e->reset();
+  revision_ = 0;
+}
+
+template<class arc_type>
+typename basic_aos_residual_graph<arc_type>::cap_t basic_aos_residual_graph<arc_type>::capacity(int v) const {
+  cap_t ret = cap_t();
+  for (auto e : arcs(v)) ret += e->init_cap();
+  return ret;
+}
+
+template class basic_aos_residual_graph<unit_arc>;
+template class basic_aos_residual_graph<weighted_arc<int64_t>>;
+template class basic_aos_residual_graph<weighted_arc<double>>;
+
+void soa_residual_graph::init(const vector<int>& degree) {
+  const int n = int(degree.size());
+  first_.resize(n);
+  last_.resize(n);
+  limit_.resize(n);
+  vertex_revision_.assign(n, -1);
+  int cur = 0;
+  for (int v = 0; v < n; v++) {
+    first_[v] = last_[v] = cur;
+    cur += degree[v];
+    limit_[v] = cur;
+  }
+  to_.resize(cur);
+  rev_.resize(cur);
+  cap_.resize(cur);
+}
+
+void soa_residual_graph::add_undirected_edge(int f, int t, cap_t c) {
+  CHECK(c == 1);
+  const int fa = last_[f]++;
+  const int ta = last_[t]++;
+  CHECK(last_[f] <= limit_[f] && last_[t] <= limit_[t]); // add_vertex で予約した本数を超えた
+  to_[fa] = t; rev_[fa] = ta; cap_[fa] = 1;
+  to_[ta] = f; rev_[ta] = fa; cap_[ta] = 1;
+}
+
+void soa_residual_graph::add_vertex(int num_reserved_edges) {
+  const int first = int(to_.size());
+  first_.push_back(first);
+  last_.push_back(first);
+  limit_.push_back(first + num_reserved_edges);
+  vertex_revision_.push_back(-1);
+  to_.resize(first + num_reserved_edges);
+  rev_.resize(first + num_reserved_edges);
+  cap_.resize(first + num_reserved_edges);
+}
+
+void soa_residual_graph::reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx) {
+  const int rm_rev = rev_[rm];
+  const int to = to_[rm];
+  const int from = to_[rm_rev];
+
+  add_undirected_edge(sside_vtx, tside_vtx);
+  const int se = last_[sside_vtx] - 1;
+  const int te = last_[tside_vtx] - 1;
+
+  to_[rm] = sside_vtx; rev_[rm] = se;
+  to_[rm_rev] = tside_vtx; rev_[rm_rev] = te;
+  to_[se] = from; rev_[se] = rm;
+  to_[te] = to; rev_[te] = rm_rev;
+}
+
+void soa_residual_graph::compact(const vector<int>& new_id, int new_n) {
+  vector<int> old_id(new_n, -1);
+  for (int v = 0; v < n(); v++) {
+    if (new_id[v] != -1) old_id[new_id[v]] = v;
+  }
+
+  vector<int> first(new_n), last(new_n), vertex_revision(new_n, -1);
+  int num_arcs = 0;
+  for (int w = 0; w < new_n; w++) {
+    first[w] = num_arcs;
+    if (old_id[w] != -1) {
+      num_arcs += degree(old_id[w]);
+      vertex_revision[w] = vertex_revision_[old_id[w]];
+    }
+    last[w] = num_arcs;
+  }
+
+  // 逆辺 b の新しい位置は、b の属する頂点 (= a の行き先) の新しい先頭からのずれで決まる
+  vector<int> to(num_arcs), rev(num_arcs);
+  vector<int8_t> cap(num_arcs);
+  for (int w = 0; w < new_n; w++) {
+    if (old_id[w] == -1) continue;
+    const int v = old_id[w];
+    for (int a = first_[v]; a < last_[v]; a++) {
+      const int na = first[w] + (a - first_[v]);
+      const int u = to_[a];
+      CHECK(new_id[u] != -1);
+      to[na] = new_id[u];
+      rev[na] = first[new_id[u]] + (rev_[a] - first_[u]);
+      cap[na] = cap_[a];
+    }
+  }
+
+  first_ = std::move(first);
+  limit_ = last;
+  last_ = std::move(last);
+  vertex_revision_ = std::move(vertex_revision);
+  to_ = std::move(to);
+  rev_ = std::move(rev);
+  cap_ = std::move(cap);
+}
+
+void soa_residual_graph::reset() {
+  fill(vertex_revision_.begin(), vertex_revision_.end(), -1);
+  revision_ = 0;
+}
+
+} //namespace agl
@@ -0,0 +1,276 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+#include <memory>
+
+namespace agl {
+// bi_dinitz の残余グラフ
+// 辺は全て容量 c の無向辺で、辺 a とその逆辺の容量の和は常に 2c (weighted_arc 以外は c = 1)
+// 容量は revision を上げると初期値 c に戻る (実際に戻すのは次に触った時)
+//
+// 辺は値で渡すハンドル arc_t で表し、頂点 v の辺の容量を読み書きする前に scan(v) を呼ぶ
+// push(a, f) は a の逆辺側の頂点を自分で scan する
+
+// 連続して並んだ辺のハンドルの列
+template<class arc_t>
+class arc_range {
+public:
+  class iterator {
+  public:
+    explicit iterator(arc_t a) : a_(a) {}
+    arc_t operator*() const { return a_; }
+    iterator& operator++() { ++a_; return *this; }
+    bool operator==(const iterator& other) const { return a_ == other.a_; }
+    bool operator!=(const iterator& other) const { return a_ != other.a_; }
+  private:
+    arc_t a_;
+  };
+
+  arc_range(arc_t first, arc_t last) : first_(first), last_(last) {}
+  iterator begin() const { return iterator(first_); }
+  iterator end() const { return iterator(last_); }
+  std::size_t size() const { return last_ - first_; }
+  bool empty() const { return first_ == last_; }
+  arc_t operator[](std::size_t i) const { return first_ + i; }
+  arc_t back() const { return last_ - 1; }
+private:
+  arc_t first_;
+  arc_t last_;
+};
+
+// 容量1の辺
+class unit_arc {
+public:
+  typedef int cap_t;
+
+  unit_arc() : revision_(0), to_(-1), cap_(init_cap_), rev_(0) {}
+  unit_arc(int to, int rev, cap_t cap) : revision_(0), to_(to), cap_(init_cap_), rev_(rev) {
+    CHECK(init_cap_ == cap);
+  }
+
+  cap_t cap(int currenct_revision) {
+    if (revision_ != currenct_revision) {
+      revision_ = currenct_revision;
+      cap_ = init_cap_;
+    }
+    return cap_;
+  }
+  void add_cap(cap_t val, int currenct_revision) {
+    if (revision_ != currenct_revision) {
+      revision_ = currenct_revision;
+      cap_ = init_cap_;
+    }
+    cap_ += val;
+  }
+  cap_t init_cap() const { return init_cap_; }
+
+  void reset() {
+    revision_ = 0;
+    cap_ = init_cap_;
+  }
+
+private:
+  static const int init_cap_ = 1;
+  int revision_;
+  int to_;
+  int cap_ : 3;
+  unsigned int rev_ : 29;
+
+  template<class arc_type> friend class basic_aos_residual_graph;
+};
+
+// 容量が cap_t の辺
+// 浮動小数点の容量は誤差で僅かに残ったり負になったりするので、is_zero なら 0 として扱う
+template<class cap_type>
+class weighted_arc {
+public:
+  typedef cap_type cap_t;
+
+  weighted_arc() : revision_(0), to_(-1), rev_(0), cap_(), init_cap_() {}
+  weighted_arc(int to, int rev, cap_t cap) : revision_(0), to_(to), rev_(rev), cap_(cap), init_cap_(cap) {
+    CHECK(cap >= cap_t());
+  }
+
+  cap_t cap(int currenct_revision) {
+    if (revision_ != currenct_revision) {
+      revision_ = currenct_revision;
+      cap_ = init_cap_;
+    }
+    return is_zero(cap_) ? cap_t() : cap_;
+  }
+  void add_cap(cap_t val, int currenct_revision) {
+    if (revision_ != currenct_revision) {
+      revision_ = currenct_revision;
+      cap_ = init_cap_;
+    }
+    cap_ += val;
+  }
+  cap_t init_cap() const { return init_cap_; }
+
+  void reset() {
+    revision_ = 0;
+    cap_ = init_cap_;
+  }
+
+private:
+  int revision_;
+  int to_;
+  int rev_;
+  cap_t cap_;
+  cap_t init_cap_;
+
+  template<class arc_type> friend class basic_aos_residual_graph;
+};
+
+// 辺を構造体の配列で持つ (array of structures)
+// 辺毎に revision を持ち、容量の初期化は辺単位で遅延する
+// arc_type は unit_arc か weighted_arc
+template<class arc_type>
+class basic_aos_residual_graph {
+public:
+  typedef arc_type E;
+  typedef typename E::cap_t cap_t;
+  typedef E* arc_t;
+  typedef const E* const_arc_t;
+
+  basic_aos_residual_graph() : revision_(0), arcs_free_first_(nullptr), arcs_free_last_(nullptr) {}
+  // 辺は1つの領域に詰め直す
+  basic_aos_residual_graph(const basic_aos_residual_graph& other);
+  basic_aos_residual_graph& operator=(const basic_aos_residual_graph&) = delete;
+
+  // 各頂点の次数から CSR の領域を確保する. 辺は add_undirected_edge で張る
+  void init(const std::vector<int>& degree);
+  void add_undirected_edge(int f, int t, cap_t c = 1);
+  // 辺を num_reserved_edges 本まで追加できる頂点を追加する
+  void add_vertex(int num_reserved_edges);
+  // rm (from -> to) を from -> sside_vtx, tside_vtx -> to の2本につなぎ直す
+  void reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx);
+  // 頂点 v を new_id[v] に付け替え、辺を1つの領域に隙間なく詰め直す. 頂点数は new_n になる
+  // new_id[v] == -1 の頂点は辺ごと取り除く (残す頂点の辺が指していてはいけない). ハンドルは無効になる
+  void compact(const std::vector<int>& new_id, int new_n);
+
+  // 頂点 v の辺を key(行き先) の昇順に並べる. key は 0, 1, 2 のいずれかなので、比較せず O(次数) で3つに分ける
+  template<class key_t>
+  void partition_arcs(int v, const key_t& key) {
+    E *lo = arcs_first_[v], *mid = arcs_first_[v], *hi = arcs_last_[v];
+    while (mid < hi) {
+      const int k = key(mid->to_);
+      CHECK(0 <= k && k < 3);
+      if (k == 0) std::swap(*lo++, *mid++);
+      else if (k == 1) mid++;
+      else std::swap(*mid, *--hi);
+    }
+    for (int i = 0; i < degree(v); i++) rev(arcs_first_[v] + i)->rev_ = i;
+  }
+
+  // 全ての辺の容量を初期値に戻す
+  void next_revision() { revision_++; }
+  // revision を 0 に戻す
+  void reset();
+
+  int n() const { return int(arcs_first_.size()); }
+  int degree(int v) const { return int(arcs_last_[v] - arcs_first_[v]); }
+  // 頂点 v から出る辺の初期容量の和
+  cap_t capacity(int v) const;
+  arc_range<arc_t> arcs(int v) { return arc_range<arc_t>(arcs_first_[v], arcs_last_[v]); }
+  arc_range<const_arc_t> arcs(int v) const { return arc_range<const_arc_t>(arcs_first_[v], arcs_last_[v]); }
+  arc_t arc(int v, int i) { return arcs_first_[v] + i; }
+  int to(const_arc_t a) const { return a->to_; }
+  int from(const_arc_t a) const { return arcs_first_[a->to_][a->rev_].to_; }
+  arc_t rev(const_arc_t a) { return arcs_first_[a->to_] + a->rev_; }
+
+  void scan(int) {}
+  cap_t cap(arc_t a) { return a->cap(revision_); }
+  cap_t rev_cap(arc_t a) { return rev(a)->cap(revision_); }
+  void push(arc_t a, cap_t f) {
+    a->add_cap(-f, revision_);
+    rev(a)->add_cap(f, revision_);
+  }
+
+private:
+  // num_edges 本分の辺の領域を返す. 空きが足りなければ block_size 以上の領域を新たに確保する
+  E* allocate_arcs(std::size_t num_edges, std::size_t block_size);
+
+  int revision_;
+  // 頂点 v の辺は [arcs_first_[v], arcs_last_[v]) で、arcs_limit_[v] までは辺を追加できる
+  std::vector<E*> arcs_first_, arcs_last_, arcs_limit_;
+  // 辺の実体. init で全頂点分を1つの領域に確保し、add_vertex で足りなくなったら領域を足す
+  // 領域は動かさないので、add_vertex の後もハンドルは有効
+  std::vector<std::unique_ptr<E[]>> arcs_blocks_;
+  E* arcs_free_first_; // 最後の領域の空き
+  E* arcs_free_last_;
+};
+
+typedef basic_aos_residual_graph<unit_arc> aos_residual_graph;
+template<class cap_t> using weighted_residual_graph = basic_aos_residual_graph<weighted_arc<cap_t>>;
+
+// 辺の各要素を別々の配列で持つ (structure of arrays)
+// 容量は辺 a の分だけを 1 byte で持ち、逆辺の容量は 2 - cap_[a] とする
+// 容量の初期化は頂点単位で遅延するので、bfs で読むのは to_ と cap_ の連続領域だけになる
+class soa_residual_graph {
+public:
+  typedef int cap_t;
+  typedef int arc_t;
+  typedef int const_arc_t;
+
+  soa_residual_graph() : revision_(0) {}
+
+  void init(const std::vector<int>& degree);
+  void add_undirected_edge(int f, int t, cap_t c = 1);
+  void add_vertex(int num_reserved_edges);
+  void reconnect_edge(arc_t rm, int sside_vtx, int tside_vtx);
+  void compact(const std::vector<int>& new_id, int new_n);
+
+  template<class key_t>
+  void partition_arcs(int v, const key_t& key) {
+    auto swap_arcs = [this](int a, int b) {
+      std::swap(to_[a], to_[b]);
+      std::swap(rev_[a], rev_[b]);
+      std::swap(cap_[a], cap_[b]);
+    };
+    int lo = first_[v], mid = first_[v], hi = last_[v];
+    while (mid < hi) {
+      const int k = key(to_[mid]);
+      CHECK(0 <= k && k < 3);
+      if (k == 0) swap_arcs(lo++, mid++);
+      else if (k == 1) mid++;
+      else swap_arcs(mid, --hi);
+    }
+    for (int a = first_[v]; a < last_[v]; a++) rev_[rev_[a]] = a;
+  }
+
+  void next_revision() { revision_++; }
+  void reset();
+
+  int n() const { return int(first_.size()); }
+  int degree(int v) const { return last_[v] - first_[v]; }
+  cap_t capacity(int v) const { return degree(v); }
+  arc_range<arc_t> arcs(int v) const { return arc_range<arc_t>(first_[v], last_[v]); }
+  arc_t arc(int v, int i) const { return first_[v] + i; }
+  int to(arc_t a) const { return to_[a]; }
+  int from(arc_t a) const { return to_[rev_[a]]; }
+  arc_t rev(arc_t a) const { return rev_[a]; }
+
+  void scan(int v) {
+    if (vertex_revision_[v] == revision_) return;
+    vertex_revision_[v] = revision_;
+    std::fill(cap_.begin() + first_[v], cap_.begin() + last_[v], int8_t(1));
+  }
+  int cap(arc_t a) const { return cap_[a]; }
+  int rev_cap(arc_t a) const { return 2 - cap_[a]; }
+  void push(arc_t a, int f) {
+    scan(to_[a]);
+    cap_[a] -= f;
+    cap_[rev_[a]] += f;
+  }
+
+private:
+  int revision_;
+  // 頂点 v の辺は [first_[v], last_[v]) で、limit_[v] までは辺を追加できる
+  std::vector<int> first_, last_, limit_;
+  // 頂点 v の辺の cap_ を初期化した revision
+  std::vector<int> vertex_revision_;
+  std::vector<int> to_, rev_;
+  std::vector<int8_t> cap_;
+};
+} //namespace agl
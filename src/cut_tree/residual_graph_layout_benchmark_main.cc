@@ -0,0 +1,50 @@
+#include <cut_tree/cut_tree.h>
+#include <easy_cui.h>
+
+DEFINE_int32(cut_tree_num_query, 100000, "");
+DEFINE_int64(cut_tree_node_pair_random_seed, 922337203685477583LL, "");
+
+// 同じ頂点対の列について maxflow を求め、かかった時間を layout 毎に出力する
+template<class flow_t>
+long long benchmark(const G& g) {
+  const int n = g.num_vertices();
+  unique_ptr<flow_t> dz;
+  JLOG_PUT_BENCHMARK("initialize_time") {
+    dz.reset(new flow_t(g));
+  }
+
+  V root = 0;
+  for (V v = 0; v < n; v++) if (dz->edges(root).size() < dz->edges(v).size()) root = v;
+  dz->goal_oriented_bfs_init(root);
+
+  agl::random_type random(FLAGS_cut_tree_node_pair_random_seed);
+  long long sum = 0;
+  JLOG_PUT_BENCHMARK("max_flow_time") {
+    for (int i = 0; i < FLAGS_cut_tree_num_query; i++) {
+      V s = random() % n;
+      V t = random() % (n - 1);
+      if (s <= t) t++;
+      sum += dz->max_flow(s, t);
+    }
+  }
+  JLOG_PUT_BENCHMARK("goal_oriented_max_flow_time") {
+    for (int i = 0; i < FLAGS_cut_tree_num_query; i++) {
+      V s = random() % n;
+      if (s == root) continue;
+      sum += dz->max_flow(s, root);
+    }
+  }
+  return sum;
+}
+
+int main(int argc, char** argv) {
+  G g = easy_cui_init(argc, argv);
+  CHECK(g.num_vertices() >= 2);
+
+  long long aos = 0, soa = 0;
+  JLOG_OPEN("aos") aos = benchmark<bi_dinitz>(g);
+  JLOG_OPEN("soa") soa = benchmark<soa_bi_dinitz>(g);
+  CHECK_MSG(aos == soa, "aos and soa returned different flows");
+  JLOG_PUT("sum_of_flows", aos);
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include <cut_tree/cut_tree.h>
+#include <easy_cui.h>
+
+DEFINE_int32(cut_tree_num_components, 1000000, "number of 2-edge-connected components");
+DEFINE_int32(cut_tree_min_component_size, 3, "");
+DEFINE_int32(cut_tree_max_component_size, 16, "");
+DEFINE_int32(cut_tree_num_query, 1000000, "");
+DEFINE_int64(cut_tree_node_pair_random_seed, 922337203685477583LL, "");
+
+// 閉路に弦を足した小さい 2-edge-connected な成分を並べ、隣の成分と橋でつなぐ
+G generate_small_components() {
+  agl::random_type random(FLAGS_cut_tree_node_pair_random_seed);
+  const int width = FLAGS_cut_tree_max_component_size - FLAGS_cut_tree_min_component_size + 1;
+  CHECK(FLAGS_cut_tree_min_component_size >= 3 && width >= 1);
+  vector<pair<V, V>> es;
+  V n = 0;
+  for (int c = 0; c < FLAGS_cut_tree_num_components; c++) {
+    const int k = FLAGS_cut_tree_min_component_size + random() % width;
+    for (int i = 0; i < k; i++) es.emplace_back(n + i, n + (i + 1) % k);
+    for (int i = 0; i < k / 2; i++) {
+      const V u = random() % k, w = random() % k;
+      if (u != w && (u + 1) % k != w && (w + 1) % k != u) es.emplace_back(n + u, n + w);
+    }
+    if (c > 0) es.emplace_back(n - 1 - V(random() % FLAGS_cut_tree_min_component_size), n + V(random() % k));
+    n += k;
+  }
+  for (auto& e : es) if (e.first > e.second) swap(e.first, e.second);
+  sort(es.begin(), es.end());
+  es.erase(unique(es.begin(), es.end()), es.end());
+  return G(es, n);
+}
+
+// cut_tree を作り、同じ頂点対の列の答えの和を返す
+long long benchmark(const G& g) {
+  G h = g; // cut_tree はグラフを壊す
+  unique_ptr<cut_tree> ct;
+  JLOG_PUT_BENCHMARK("build_time") {
+    ct.reset(new cut_tree(h));
+  }
+  const int n = g.num_vertices();
+  agl::random_type random(FLAGS_cut_tree_node_pair_random_seed);
+  long long sum = 0;
+  JLOG_PUT_BENCHMARK("query_time") {
+    for (int i = 0; i < FLAGS_cut_tree_num_query; i++) {
+      V s = random() % n;
+      V t = s + 1 + random() % FLAGS_cut_tree_max_component_size;
+      if (t >= n) continue;
+      sum += ct->query(s, t);
+    }
+  }
+  return sum;
+}
+
+int main(int argc, char** argv) {
+  JLOG_INIT(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  G g;
+  JLOG_PUT_BENCHMARK("generate_time") {
+    g = generate_small_components();
+  }
+  JLOG_PUT("num_vertices", g.num_vertices());
+  JLOG_PUT("num_edges", g.num_edges());
+
+  // -cut_tree_small_component_size を指定しなければ 64 頂点まで bitset で解く
+  if (FLAGS_cut_tree_small_component_size == 0) FLAGS_cut_tree_small_component_size = cut_tree_internal::small_cut_tree_builder::kMaxVertices;
+  long long bitset = 0, handler = 0;
+  JLOG_OPEN("bitset") bitset = benchmark(g);
+  FLAGS_cut_tree_small_component_size = 0;
+  JLOG_OPEN("handler") handler = benchmark(g);
+  CHECK_MSG(bitset == handler, "bitset and handler returned different connectivities");
+  JLOG_PUT("sum_of_connectivities", bitset);
+  return 0;
+}
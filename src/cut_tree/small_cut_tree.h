@@ -0,0 +1,102 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace agl {
+namespace cut_tree_internal {
+// 64頂点以下の単純な無向グラフ (容量1) の Gomory-Hu 木を求める
+// 隣接行列を頂点毎の 64bit の bitset で持ち、maxflow の bfs を bit 演算で行う (Gusfield のアルゴリズム)
+// 配列は固定長なので、同じ builder を使い回せばどの連結成分でも heap を確保しない
+class small_cut_tree_builder {
+public:
+  static const int kMaxVertices = 64;
+  typedef uint64_t bits_t;
+
+  void reset(int n) {
+    CHECK(0 < n && n <= kMaxVertices);
+    n_ = n;
+    for (V v = 0; v < n_; v++) adj_[v] = 0;
+  }
+
+  // 多重辺なら false を返す. 自己ループは cut に関係ないので無視する
+  bool add_edge(V u, V v) {
+    if (u == v) return true;
+    if (adj_[u] >> v & 1) return false;
+    adj_[u] |= bit(v);
+    adj_[v] |= bit(u);
+    return true;
+  }
+
+  // parent_weight[v] = (親, 親への辺の重み) を書き込む. 根は 0 で親は -1
+  // 重みは upper_bound で頭打ちにする (cut_tree_connectivity_bound)
+  template<class weight_t>
+  void build(std::pair<V, weight_t>* parent_weight, int upper_bound = std::numeric_limits<int>::max()) {
+    int parent[kMaxVertices], weight[kMaxVertices];
+    for (V v = 0; v < n_; v++) parent[v] = 0, weight[v] = 0;
+    for (V s = 1; s < n_; s++) {
+      const V t = parent[s];
+      const int f = max_flow(s, t);
+      // visited_ は最後の bfs で s から残余グラフで届いた頂点 (s 側の mincut)
+      const bits_t side = visited_;
+      weight[s] = f;
+      for (V v = 0; v < n_; v++) {
+        if (v != s && (side >> v & 1) && parent[v] == t) parent[v] = s;
+      }
+      if (side >> parent[t] & 1) {
+        parent[s] = parent[t];
+        parent[t] = s;
+        weight[s] = weight[t];
+        weight[t] = f;
+      }
+    }
+    for (V v = 0; v < n_; v++) {
+      parent_weight[v] = v == 0 ? std::make_pair(V(-1), weight_t()) : std::make_pair(V(parent[v]), weight_t(std::min(weight[v], upper_bound)));
+    }
+  }
+
+private:
+  static bits_t bit(V v) { return bits_t(1) << v; }
+
+  // flow_[u] の bit w は u から w へ 1 流れていること. u から w の残余容量があるのは adj_[u] & ~flow_[u]
+  int max_flow(V s, V t) {
+    for (V v = 0; v < n_; v++) flow_[v] = 0;
+    int f = 0;
+    while (augment(s, t)) f++;
+    return f;
+  }
+
+  bool augment(V s, V t) {
+    V queue[kMaxVertices], prev[kMaxVertices];
+    int head = 0, tail = 0;
+    visited_ = bit(s);
+    queue[tail++] = s;
+    while (head < tail) {
+      const V u = queue[head++];
+      bits_t next = adj_[u] & ~flow_[u] & ~visited_;
+      visited_ |= next;
+      for (; next != 0; next &= next - 1) {
+        const V w = __builtin_ctzll(next);
+        prev[w] = u;
+        queue[tail++] = w;
+      }
+      if (visited_ >> t & 1) break;
+    }
+    if (!(visited_ >> t & 1)) return false;
+    for (V w = t; w != s; w = prev[w]) {
+      const V u = prev[w];
+      if (flow_[w] >> u & 1) flow_[w] &= ~bit(u); // 逆向きの流れを打ち消す
+      else flow_[u] |= bit(w);
+    }
+    return true;
+  }
+
+  int n_;
+  bits_t adj_[kMaxVertices], flow_[kMaxVertices];
+  bits_t visited_;
+};
+} // namespace cut_tree_internal
+} // namespace agl
@@ -0,0 +1,128 @@
+#include "sparse_certificate.h"
+#include <queue>
+
+DEFINE_bool(cut_tree_sparse_certificate, true, "with -cut_tree_connectivity_bound=k, replace each component with its Nagamochi-Ibaraki sparse k-certificate first");
+
+using namespace std;
+
+namespace agl {
+namespace {
+// 頂点毎に、接続する辺の番号を CSR で並べる
+void build_incident_edges(int num_vs, const vector<pair<V, V>>& endpoints, vector<int>* offset, vector<int>* incident) {
+  offset->assign(num_vs + 1, 0);
+  for (auto& uv : endpoints) (*offset)[uv.first + 1]++, (*offset)[uv.second + 1]++;
+  for (int v = 0; v < num_vs; v++) (*offset)[v + 1] += (*offset)[v];
+  incident->resize((*offset)[num_vs]);
+  vector<int> pos(offset->begin(), offset->end() - 1);
+  for (int i = 0; i < int(endpoints.size()); i++) {
+    (*incident)[pos[endpoints[i].first]++] = i;
+    (*incident)[pos[endpoints[i].second]++] = i;
+  }
+}
+
+template<class edge_t>
+vector<pair<V, V>> edge_endpoints(const vector<pair<V, edge_t>>& edges) {
+  vector<pair<V, V>> ret;
+  ret.reserve(edges.size());
+  for (auto& e : edges) ret.emplace_back(e.first, to(e.second));
+  return ret;
+}
+} // namespace
+
+// 容量1: r(v) は次数以下の整数なので、バケットの連結リストで最大のものを取り出す (全体で O(n + m))
+template<>
+void sparse_certificate<unweighted_edge>(int num_vs, int k, vector<pair<V, V>>* edges) {
+  vector<int> offset, incident;
+  build_incident_edges(num_vs, *edges, &offset, &incident);
+
+  int max_degree = 0;
+  for (V v = 0; v < num_vs; v++) max_degree = max(max_degree, offset[v + 1] - offset[v]);
+  vector<int> r(num_vs), head(max_degree + 1, -1), prev(num_vs, -1), next(num_vs, -1);
+  vector<bool> scanned(num_vs);
+  auto erase = [&](V v) {
+    if (prev[v] != -1) next[prev[v]] = next[v];
+    else head[r[v]] = next[v];
+    if (next[v] != -1) prev[next[v]] = prev[v];
+  };
+  auto insert = [&](V v) {
+    prev[v] = -1;
+    next[v] = head[r[v]];
+    if (head[r[v]] != -1) prev[head[r[v]]] = v;
+    head[r[v]] = v;
+  };
+  for (V v = num_vs - 1; v >= 0; v--) insert(v);
+
+  vector<bool> keep(edges->size());
+  vector<bool> edge_scanned(edges->size());
+  int max_r = 0;
+  for (int i = 0; i < num_vs; i++) {
+    while (head[max_r] == -1) max_r--;
+    const V u = head[max_r];
+    erase(u);
+    scanned[u] = true;
+    for (int j = offset[u]; j < offset[u + 1]; j++) {
+      const int id = incident[j];
+      if (edge_scanned[id]) continue;
+      edge_scanned[id] = true;
+      const auto& e = (*edges)[id];
+      const V v = e.first == u ? e.second : e.first;
+      if (scanned[v]) continue; // 自己ループ
+      keep[id] = r[v] < k;
+      erase(v);
+      r[v]++;
+      insert(v);
+      max_r = max(max_r, r[v]);
+    }
+  }
+
+  size_t num_kept = 0;
+  for (size_t i = 0; i < edges->size(); i++) {
+    if (keep[i]) (*edges)[num_kept++] = (*edges)[i];
+  }
+  edges->resize(num_kept);
+  edges->shrink_to_fit();
+}
+
+// 重み付き: r(v) を優先度付きキューで管理する (古い値は取り出した時に読み飛ばす)
+template<class edge_t>
+void sparse_certificate(int num_vs, decltype(weight(edge_t())) k, vector<pair<V, edge_t>>* edges) {
+  typedef decltype(weight(edge_t())) weight_t;
+  vector<int> offset, incident;
+  build_incident_edges(num_vs, edge_endpoints(*edges), &offset, &incident);
+
+  vector<weight_t> r(num_vs, weight_t());
+  vector<bool> scanned(num_vs), edge_scanned(edges->size());
+  priority_queue<pair<weight_t, V>> que;
+  for (V v = num_vs - 1; v >= 0; v--) que.emplace(weight_t(), v);
+
+  while (!que.empty()) {
+    const V u = que.top().second;
+    const weight_t ru = que.top().first;
+    que.pop();
+    if (scanned[u] || ru != r[u]) continue;
+    scanned[u] = true;
+    for (int j = offset[u]; j < offset[u + 1]; j++) {
+      const int id = incident[j];
+      if (edge_scanned[id]) continue;
+      edge_scanned[id] = true;
+      auto& e = (*edges)[id];
+      const V v = e.first == u ? to(e.second) : e.first;
+      if (scanned[v]) continue; // 自己ループ
+      // F_{r(v)+1} .. F_{r(v)+w} のうち F_k までの分だけ残す
+      const weight_t w = weight(e.second);
+      const weight_t kept = max(weight_t(), min(w, k - r[v]));
+      e.second = edge_t{to(e.second), kept};
+      r[v] += w;
+      que.emplace(r[v], v);
+    }
+  }
+
+  edges->erase(remove_if(edges->begin(), edges->end(), [](const pair<V, edge_t>& e) {
+    return is_zero(weight(e.second));
+  }), edges->end());
+  edges->shrink_to_fit();
+}
+
+template void sparse_certificate<weighted_edge<int64_t>>(int, int64_t, vector<pair<V, weighted_edge<int64_t>>>*);
+template void sparse_certificate<weighted_edge<double>>(int, double, vector<pair<V, weighted_edge<double>>>*);
+} // namespace agl
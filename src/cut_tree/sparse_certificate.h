@@ -0,0 +1,18 @@
+#pragma once
+#include <base/base.h>
+#include <graph/graph.h>
+
+DECLARE_bool(cut_tree_sparse_certificate);
+
+namespace agl {
+// Nagamochi-Ibaraki の疎な k-certificate
+// 最大隣接順序 (maximum adjacency ordering) で頂点を走査し、未走査の頂点 v への辺を
+// v への接続 r(v) の続きの森 F_{r(v)+1}, F_{r(v)+2}, ... に振り分けて、F_k までに入る分 (容量) だけ残す
+// 残る辺の容量の和は高々 k(n-1) で、任意の2頂点の連結度 λ について min(λ, k) が保たれる
+//
+// edges は (u, e) の無向辺のリストで、その場で置き換える. 容量 0 になった辺は取り除く
+template<class edge_t>
+void sparse_certificate(int num_vs, decltype(weight(edge_t())) k, std::vector<std::pair<V, edge_t>>* edges);
+template<>
+void sparse_certificate<unweighted_edge>(int num_vs, int k, std::vector<std::pair<V, V>>* edges);
+} // namespace agl
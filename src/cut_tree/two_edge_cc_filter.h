@@ -1,5 +1,6 @@
 #pragma once
 #include "connected_components_filter.h"
+#include "bridge_finder.h"
 
 namespace agl {
 namespace cut_tree_internal {
@@ -8,22 +9,6 @@ template<class handler_t>
 class two_edge_cc_filter {
 public:
 
-  void lowlink_dfs(int v, int par, int& cur_ord) {
-    lowlink_[v] = order_[v] = cur_ord++;
-    for (int dir = 0; dir < 2; dir++) for (auto to : g_.edges(v, D(dir))) {
-      if (to == par) continue;
-      if (order_[to] == -1) {
-        lowlink_dfs(to, v, cur_ord);
-        lowlink_[v] = std::min(lowlink_[v], lowlink_[to]);
-        if (order_[v] < lowlink_[to]) bridge_.emplace_back(v, to);
-        else biconnected_graphs_edges_.emplace_back(v, to);
-      } else {
-        lowlink_[v] = std::min(lowlink_[v], lowlink_[to]);
-        if (v < to) biconnected_graphs_edges_.emplace_back(v, to);
-      }
-    }
-  }
-
   std::vector<std::vector<int>> get_local_id2global_id() const {
     const int cc_size = int(biconnected_graph_handler_->handlers().size());
     std::vector<std::vector<int>> local_id2global_id(cc_size);
@@ -38,7 +23,8 @@ public:
     return local_id2global_id;
   }
 
-  two_edge_cc_filter(G& g) : n_(g.num_vertices()), g_(g), uf_(n_), lowlink_(n_, -1), order_(n_, -1) {
+  // hint_parent は前に作った Gomory-Hu 木の親 (connected_components_filter を参照)
+  two_edge_cc_filter(G& g, const std::vector<V>& hint_parent = std::vector<V>()) : n_(g.num_vertices()), g_(g), uf_(n_) {
 
     G new_g;
     for (int v = 0; v < n_; v++) for (auto& e : g_.edges(v)) {
@@ -47,9 +33,16 @@ public:
 
     const int num_edges = g_.num_edges();
 
-    for (int v = 0; v < n_; v++) if (uf_.root(v) == v) {
-      int cur_ord = 0;
-      lowlink_dfs(v, -1, cur_ord);
+    std::vector<V> roots;
+    for (int v = 0; v < n_; v++) if (uf_.root(v) == v) roots.push_back(v);
+    {
+      // 橋とそれ以外の辺に分ける
+      const std::vector<V> bridge_parent = find_bridges(g_, roots);
+      for (int v = 0; v < n_; v++) for (auto& e : g_.edges(v)) {
+        const V w = to(e);
+        if (bridge_parent[w] == v || bridge_parent[v] == w) bridge_.emplace_back(v, w);
+        else biconnected_graphs_edges_.emplace_back(v, w);
+      }
     }
 
     CHECK(bridge_.size() + biconnected_graphs_edges_.size() == std::size_t(num_edges));
@@ -58,12 +51,10 @@ public:
     new_g = G(biconnected_graphs_edges_, n_);
 
     //dealloc
-    lowlink_.clear(); lowlink_.shrink_to_fit();
-    order_.clear(); order_.shrink_to_fit();
     // bridge_.clear(); bridge_.shrink_to_fit();
     biconnected_graphs_edges_.clear(); biconnected_graphs_edges_.shrink_to_fit();
 
-    biconnected_graph_handler_.reset(new connected_components_filter<handler_t>(new_g));
+    biconnected_graph_handler_.reset(new connected_components_filter<handler_t>(new_g, hint_parent));
   }
 
 public:
@@ -76,34 +67,38 @@ public:
     return ans;
   }
 
-  void print_gomory_hu_tree(std::ostream& os) {
+  // Gomory-Hu 木の辺 (u, v, 重み) を f に渡す
+  template<class func_t>
+  void for_each_gomory_hu_tree_edge(const func_t& f) {
     std::vector<int> roots;
     for (int v = 0; v < n_; v++) if (uf_.root(v) == v) roots.push_back(v);
-    for (int i = 0; i < int(roots.size()) - 1; i++) os << roots[0] << " " << roots[i + 1] << " 0\n";
-    for (auto& e : bridge_) os << e.first << " " << e.second << " 1\n";
+    for (int i = 0; i < int(roots.size()) - 1; i++) f(roots[0], roots[i + 1], 0);
+    for (auto& e : bridge_) f(e.first, e.second, 1);
 
     std::vector<std::vector<int>> local_id2global_id = get_local_id2global_id();
 
     //weight2以上
     for (int i = 0; i < int(biconnected_graph_handler_->handlers().size()); i++) {
       const auto& l2g = local_id2global_id[i];
-      const auto& gusfield_core = biconnected_graph_handler_->handlers()[i];
-      for (int v = 0; v < int(gusfield_core->parent_weight().size()); v++) {
-        const auto& kv = gusfield_core->parent_weight()[v];
-        int u = kv.first;
-        if (u == -1) continue; // 親への辺が存在しない
-        int weight = kv.second;
+      biconnected_graph_handler_->for_each_local_tree_edge(i, [&f, &l2g](V v, V u, int weight) {
         CHECK(weight >= 2);
-        os << l2g[v] << " " << l2g[u] << " " << weight << "\n";
-      }
+        f(l2g[v], l2g[u], weight);
+      });
     }
   }
 
+  void print_gomory_hu_tree(std::ostream& os) {
+    for_each_gomory_hu_tree_edge([&os](V u, V v, int weight) {
+      os << u << " " << v << " " << weight << "\n";
+    });
+  }
+
+  int num_vertices() const { return n_; }
+
 private:
   const int n_;
   G& g_;
   union_find uf_;
-  std::vector<int> lowlink_, order_;
   std::vector<std::pair<V, V>> bridge_, biconnected_graphs_edges_;
 
   std::unique_ptr<connected_components_filter<handler_t>> biconnected_graph_handler_;
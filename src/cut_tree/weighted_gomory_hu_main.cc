@@ -0,0 +1,58 @@
+#include <cut_tree/cut_tree.h>
+#include <easy_cui.h>
+
+DEFINE_string(cut_tree_weight_type, "int64", "int64, double");
+DEFINE_string(cut_tree_output_path, "", "output gomory_hu tree path");
+
+// 各行 "u v w" を容量 w の無向辺として読む
+// 同じ頂点対の辺が複数あれば (逆向きの辺も同じ頂点対とみなす) 重みを足して1本にする
+template<class weight_t>
+weighted_graph<weight_t> read_weighted_undirected_graph() {
+  auto es = read_edge_list_tsv<weighted_graph<weight_t>>(FLAGS_graph.c_str());
+  return weighted_graph<weight_t>(merge_parallel_edges<weight_t>(es));
+}
+
+string graph_name() {
+  string x = FLAGS_graph;
+  string ret;
+  for (int i = int(x.size()) - 1; i >= 0; i--) {
+    if (x[i] == '/' || x[i] == '\\') break;
+    ret.push_back(x[i]);
+  }
+  reverse(ret.begin(), ret.end());
+  return ret;
+}
+
+template<class weight_t>
+void print_gomory_hu_tree() {
+  weighted_graph<weight_t> g = read_weighted_undirected_graph<weight_t>();
+  pretty_print(g);
+  fprintf(stderr, "load graph : memory %ld MB\n", jlog_internal::get_memory_usage() / 1024);
+
+  if (FLAGS_cut_tree_output_path == "") {
+    FLAGS_cut_tree_output_path = graph_name() + ".tree";
+  }
+  weighted_cut_tree<weight_t>* gf = nullptr;
+  JLOG_PUT_BENCHMARK("test_time") {
+    gf = new weighted_cut_tree<weight_t>(g);
+  }
+  CHECK(gf);
+
+  ofstream os(FLAGS_cut_tree_output_path.c_str(), ios_base::out);
+  gf->print_gomory_hu_tree(os);
+  delete gf;
+}
+
+int main(int argc, char** argv) {
+  JLOG_INIT(&argc, argv);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_cut_tree_weight_type == "int64") {
+    print_gomory_hu_tree<int64_t>();
+  } else if (FLAGS_cut_tree_weight_type == "double") {
+    print_gomory_hu_tree<double>();
+  } else {
+    fprintf(stderr, "unrecognized option -cut_tree_weight_type='%s'\n", FLAGS_cut_tree_weight_type.c_str());
+    exit(-1);
+  }
+}
@@ -28,6 +28,7 @@ using namespace agl;
 DEFINE_string(type, "auto", "auto, tsv, agl, built_in, gen");
 DEFINE_string(graph, "-", "input graph");
 DEFINE_bool(force_undirected, false, "Automatically add reverse edges?");
+DEFINE_int32(read_tsv_threads, 0, "number of threads to parse --type=tsv (0: hardware_concurrency)");
 
 template<typename GraphType = G>
 string guess_type() {
@@ -70,7 +71,7 @@ GraphType easy_cui_init(int argc, char **argv) {
 
   G::edge_list_type es;
   if (FLAGS_type == "tsv") {
-    es = read_edge_list_tsv(FLAGS_graph.c_str());
+    es = read_edge_list_tsv(FLAGS_graph.c_str(), FLAGS_read_tsv_threads);
   } else if (FLAGS_type == "built_in") {
     es = built_in_edge_list(FLAGS_graph.c_str());
   } else if (FLAGS_type == "gen") {
@@ -1,5 +1,6 @@
 #pragma once
 #include "base/base.h"
+#include "base/io.h"
 #include "direction.h"
 #include <vector>
 #include <cstdint>
@@ -9,17 +10,39 @@
 #include <memory>
 
 namespace agl {
+// 連続して並んだ辺の列. std::vector<EdgeType> と同じように読める
+template<typename EdgeType>
+class edge_range {
+ public:
+  using value_type = EdgeType;
+  using iterator = const EdgeType*;
+  using const_iterator = const EdgeType*;
+
+  edge_range(const EdgeType *first, const EdgeType *last) : first_(first), last_(last) {}
+
+  const EdgeType *begin() const { return first_; }
+  const EdgeType *end() const { return last_; }
+  size_t size() const { return last_ - first_; }
+  bool empty() const { return first_ == last_; }
+  const EdgeType &operator[](size_t i) const { return first_[i]; }
+  const EdgeType &front() const { return *first_; }
+  const EdgeType &back() const { return *(last_ - 1); }
+
+ private:
+  const EdgeType *first_, *last_;
+};
+
 template<typename EdgeType>
 class neighbor_range {
  public:
   struct iterator_type {
-    typename std::vector<EdgeType>::const_iterator ite;
+    const EdgeType *ite;
     V operator*() const { return to(*ite); }
     void operator++() { ++ite; }
     bool operator!=(const iterator_type &i) const { return ite < i.ite; }
   };
 
-  neighbor_range(const std::vector<EdgeType> &edges) :
+  neighbor_range(const edge_range<EdgeType> &edges) :
     i_{edges.begin()}, n_{edges.end()} {}
 
   iterator_type begin() { return i_; }
@@ -33,7 +56,7 @@ template<typename EdgeType>
 class undirected_neighbor_range {
  public:
   struct iterator_type {
-    typename std::vector<EdgeType>::const_iterator i0, i1;
+    const EdgeType *i0, *i1;
     const undirected_neighbor_range &p;
 
     V operator*() const {
@@ -58,8 +81,8 @@ class undirected_neighbor_range {
     }
   };
 
-  undirected_neighbor_range(const std::vector<EdgeType> &es0,
-                            const std::vector<EdgeType> &es1)
+  undirected_neighbor_range(const edge_range<EdgeType> &es0,
+                            const edge_range<EdgeType> &es1)
   : i_{es0.begin(), es1.begin(), *this}, n_{es0.end(), es1.end(), *this} {}
 
   iterator_type begin() { return i_; }
@@ -69,6 +92,18 @@ class undirected_neighbor_range {
   iterator_type i_, n_;
 };
 
+// 各方向の辺を CSR で持つ. 頂点 v の辺は edges[offsets[v], offsets[v + 1]) で、行き先の昇順に並ぶ
+// 配列は vector か、mmap した領域 (file) を指す. 作った後は書き換えない
+template<typename EdgeType>
+struct csr_graph_storage {
+  std::vector<size_t> offsets_vector[kNumDirections];
+  std::vector<EdgeType> edges_vector[kNumDirections];
+  std::unique_ptr<mapped_file> file;
+
+  const size_t *offsets[kNumDirections] = {};
+  const EdgeType *edges[kNumDirections] = {};
+};
+
 template<typename EdgeType>
 class basic_graph {
  public:
@@ -77,29 +112,27 @@ class basic_graph {
   using E = EdgeType;
   using W = decltype(weight(E()));
   using edge_list_type = std::vector<std::pair<V, E>>;
+  using storage_type = csr_graph_storage<E>;
 
-  basic_graph() = default;
+  basic_graph() : num_vertices_(0) {}
 
-  explicit basic_graph(const edge_list_type &es, V num_vs = -1) {
+  explicit basic_graph(const edge_list_type &es, V num_vs = -1) : num_vertices_(0) {
     assign(es, num_vs);
   }
 
-  basic_graph(const basic_graph<EdgeType> &g) : edges_from_{g.edges_from_[0], g.edges_from_[1]} {
-  }
-
-  basic_graph<EdgeType> &operator=(const basic_graph<EdgeType> &g) {
-    edges_from_[0] = g.edges_from_[0];
-    edges_from_[1] = g.edges_from_[1];
-    return *this;
-  }
+  // 辺は書き換えないので、コピーは領域を共有する
+  basic_graph(const basic_graph<EdgeType> &g) = default;
+  basic_graph<EdgeType> &operator=(const basic_graph<EdgeType> &g) = default;
 
   void clear_and_shrink_to_fit() {
-    edges_from_[0].clear(); edges_from_[0].shrink_to_fit();
-    edges_from_[1].clear(); edges_from_[1].shrink_to_fit();
+    storage_.reset();
+    num_vertices_ = 0;
   }
 
   void assign(const edge_list_type &es, V num_vs = -1);
   void assign(std::vector<std::vector<E>> edges_from);
+  // storage の kFwd の offsets, edges (行き先の昇順) を設定して渡す. kBwd が空なら kFwd から作る
+  void assign(std::unique_ptr<storage_type> storage, V num_vs);
 
   edge_list_type edge_list(D d = kFwd) const;
 
@@ -107,42 +140,51 @@ class basic_graph {
   // Graph access
   //
   inline V num_vertices() const {
-    assert(edges_from_[kFwd].size() == edges_from_[kBwd].size());
-    return edges_from_[kFwd].size();
+    return num_vertices_;
   }
 
   inline size_t num_edges() const {
-    size_t n = 0;
-    for (V v : vertices()) n += degree(v);
-    return n;
+    return num_vertices_ == 0 ? 0 : storage_->offsets[kFwd][num_vertices_];
   }
 
   inline irange<V> vertices() const {
     return make_irange(num_vertices());
   }
 
-  inline const std::vector<E> &edges(V v, D d = kFwd) const {
-    return edges_from_[d][v];
+  inline edge_range<E> edges(V v, D d = kFwd) const {
+    const size_t *o = storage_->offsets[d];
+    return edge_range<E>(storage_->edges[d] + o[v], storage_->edges[d] + o[v + 1]);
   }
 
   inline const E &edge(V v, size_t i, D d = kFwd) const {
-    return edges_from_[d][v][i];
+    return storage_->edges[d][storage_->offsets[d][v] + i];
   }
 
   inline neighbor_range<E> neighbors(V v, D d = kFwd) const {
-    return neighbor_range<E>(edges_from_[d][v]);
+    return neighbor_range<E>(edges(v, d));
   }
 
   inline V neighbor(V v, size_t i, D d = kFwd) const {
-    return to(edges_from_[d][v][i]);
+    return to(edge(v, i, d));
   }
 
   inline size_t degree(V v, D d = kFwd) const {
-    return edges_from_[d][v].size();
+    const size_t *o = storage_->offsets[d];
+    return o[v + 1] - o[v];
+  }
+
+  // CSR の配列そのもの. バイナリ形式で書き出す時に使う
+  inline const size_t *csr_offsets(D d = kFwd) const {
+    return num_vertices_ == 0 ? nullptr : storage_->offsets[d];
+  }
+
+  inline const E *csr_edges(D d = kFwd) const {
+    return num_vertices_ == 0 ? nullptr : storage_->edges[d];
   }
 
 private:
-  std::vector<std::vector<E>> edges_from_[kNumDirections];
+  V num_vertices_;
+  std::shared_ptr<const storage_type> storage_;
 };
 
 //
@@ -162,40 +204,83 @@ void basic_graph<EdgeType>::assign(const typename basic_graph<EdgeType>::edge_li
   if (num_vs == -1) {
     num_vs = num_vertices_from_edge_list(es);
   }
-  edges_from_[kFwd].assign(num_vs, {});
-  edges_from_[kBwd].assign(num_vs, {});
+  std::unique_ptr<storage_type> storage(new storage_type());
+  auto &offsets = storage->offsets_vector[kFwd];
+  auto &edges = storage->edges_vector[kFwd];
+  offsets.assign(num_vs + 1, 0);
   for (const auto &p : es) {
     assert(p.first < num_vs);
     assert(to(p.second) < num_vs);
-    edges_from_[kFwd][p.first].emplace_back(p.second);
-    edges_from_[kBwd][to(p.second)].emplace_back(reverse_edge(p.first, p.second));
-  }
-  for (D d : directions()) {
-    for (V v : vertices()) {
-      auto cmp = [](const EdgeType &e0, const EdgeType &e1) {
-        return to(e0) < to(e1);
-      };
-      std::sort(edges_from_[d][v].begin(), edges_from_[d][v].end(), cmp);
-    }
+    offsets[p.first + 1]++;
   }
+  for (V v = 0; v < num_vs; v++) offsets[v + 1] += offsets[v];
+  edges.resize(es.size());
+  {
+    std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+    for (const auto &p : es) edges[pos[p.first]++] = p.second;
+  }
+  auto cmp = [](const EdgeType &e0, const EdgeType &e1) {
+    return to(e0) < to(e1);
+  };
+  for (V v = 0; v < num_vs; v++) {
+    std::sort(edges.begin() + offsets[v], edges.begin() + offsets[v + 1], cmp);
+  }
+  storage->offsets[kFwd] = offsets.data();
+  storage->edges[kFwd] = edges.data();
+  assign(std::move(storage), num_vs);
 }
 
 template<typename EdgeType>
 void basic_graph<EdgeType>::assign(std::vector<std::vector<E>> sorted_edges_from) {
   V num_vs = static_cast<V>(sorted_edges_from.size());
-  edges_from_[kFwd] = std::move(sorted_edges_from);
-  edges_from_[kBwd].assign(num_vs, {});
-  for(V v = 0; v < num_vs; v++) {
-    for(size_t i = 0; i < edges_from_[kFwd][v].size(); i++) {
-      const auto& e = edges_from_[kFwd][v][i];
-      if(i != 0) {
-        //is sorted?
-        const auto& prev_e = edges_from_[kFwd][v][i-1];
-        CHECK(to(prev_e) < to(e));
+  std::unique_ptr<storage_type> storage(new storage_type());
+  auto &offsets = storage->offsets_vector[kFwd];
+  auto &edges = storage->edges_vector[kFwd];
+  offsets.assign(num_vs + 1, 0);
+  for (V v = 0; v < num_vs; v++) offsets[v + 1] = offsets[v] + sorted_edges_from[v].size();
+  edges.reserve(offsets[num_vs]);
+  for (V v = 0; v < num_vs; v++) {
+    for (size_t i = 1; i < sorted_edges_from[v].size(); i++) {
+      //is sorted?
+      CHECK(to(sorted_edges_from[v][i - 1]) < to(sorted_edges_from[v][i]));
+    }
+    edges.insert(edges.end(), sorted_edges_from[v].begin(), sorted_edges_from[v].end());
+    std::vector<E>().swap(sorted_edges_from[v]);
+  }
+  storage->offsets[kFwd] = offsets.data();
+  storage->edges[kFwd] = edges.data();
+  assign(std::move(storage), num_vs);
+}
+
+template<typename EdgeType>
+void basic_graph<EdgeType>::assign(std::unique_ptr<storage_type> storage, V num_vs) {
+  const size_t *fwd_offsets = storage->offsets[kFwd];
+  const E *fwd_edges = storage->edges[kFwd];
+  if (num_vs > 0) {
+    CHECK(fwd_offsets != nullptr);
+  }
+
+  if (storage->offsets[kBwd] == nullptr) {
+    // v の昇順に見るので、逆向きの辺も行き先の昇順に並ぶ
+    auto &offsets = storage->offsets_vector[kBwd];
+    auto &edges = storage->edges_vector[kBwd];
+    const size_t num_es = num_vs == 0 ? 0 : fwd_offsets[num_vs];
+    offsets.assign(num_vs + 1, 0);
+    for (size_t i = 0; i < num_es; i++) offsets[to(fwd_edges[i]) + 1]++;
+    for (V v = 0; v < num_vs; v++) offsets[v + 1] += offsets[v];
+    edges.resize(num_es);
+    std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+    for (V v = 0; v < num_vs; v++) {
+      for (size_t i = fwd_offsets[v]; i < fwd_offsets[v + 1]; i++) {
+        edges[pos[to(fwd_edges[i])]++] = reverse_edge(v, fwd_edges[i]);
       }
-      edges_from_[kBwd][to(e)].emplace_back(reverse_edge(v, e));
     }
+    storage->offsets[kBwd] = offsets.data();
+    storage->edges[kBwd] = edges.data();
   }
+
+  num_vertices_ = num_vs;
+  storage_ = std::move(storage);
 }
 
 template<typename EdgeType>
@@ -1,4 +1,8 @@
 #pragma once
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <type_traits>
 #include "base/base.h"
 #include "base/io.h"
 #include "graph.h"
@@ -8,6 +12,9 @@ namespace {
 const char kEndLine = '\n';
 const std::string kMagic = "AGL_BINARY";
 const std::string kVersion = "0.01";
+// CSR 形式
+const std::string kVersionCSR = "0.02";
+const uint64_t kGraphBinaryBackward = 1;
 
 // http://d.hatena.ne.jp/osyo-manga/20120211/1328922379
 extern void* enabler;
@@ -16,33 +23,157 @@ using enabler_if = typename std::enable_if<B, T>::type*&;
 }
 
 namespace agl {
+namespace io_internal {
+// 改行以外の空白
+inline bool is_tsv_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline void skip_tsv_space(const char *&p, const char *end) {
+  while (p < end && is_tsv_space(*p)) p++;
+}
+
+// [p, end) の先頭の空白を飛ばして値を1つ読み、p を進める. 読めなければ false
+template<typename T,
+  enabler_if<std::is_integral<T>::value> = enabler >
+  bool parse_tsv_value(const char *&p, const char *end, T *x) {
+  skip_tsv_space(p, end);
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+  if (p == end || !isdigit(*p)) return false;
+  if (negative && !std::is_signed<T>::value) return false;
+  const unsigned long long limit = negative
+    ? (unsigned long long)(-(std::numeric_limits<T>::min() + 1)) + 1
+    : (unsigned long long)std::numeric_limits<T>::max();
+  unsigned long long v = 0;
+  for (; p < end && isdigit(*p); p++) {
+    v = v * 10 + (*p - '0');
+    if (v > limit) return false;
+  }
+  *x = negative ? T(-(long long)(v - 1) - 1) : T(v);
+  return true;
+}
+
+template<typename T,
+  enabler_if<std::is_floating_point<T>::value> = enabler >
+  bool parse_tsv_value(const char *&p, const char *end, T *x) {
+  skip_tsv_space(p, end);
+  // strtod は終端文字が必要なので、トークンを写してから読む
+  char buf[64];
+  std::size_t len = 0;
+  while (p + len < end && len + 1 < sizeof(buf) && !isspace(p[len])) {
+    buf[len] = p[len];
+    len++;
+  }
+  buf[len] = '\0';
+  char *last;
+  const double v = strtod(buf, &last);
+  if (last == buf) return false;
+  p += last - buf;
+  *x = T(v);
+  return true;
+}
+
+inline bool parse_tsv_edge(const char *&p, const char *end, unweighted_edge *e) {
+  return parse_tsv_value(p, end, e);
+}
+
+template<typename WeightType>
+bool parse_tsv_edge(const char *&p, const char *end, weighted_edge<WeightType> *e) {
+  return parse_tsv_value(p, end, &e->to) && parse_tsv_value(p, end, &e->weight);
+}
+
+// 上記以外の辺は operator>> で読む
+template<typename EdgeType>
+bool parse_tsv_edge(const char *&p, const char *end, EdgeType *e) {
+  std::istringstream iss(std::string(p, end));
+  if (!(iss >> *e)) return false;
+  p = end;
+  return true;
+}
+}  // namespace io_internal
+
+// [data, data + size) の各行 "v e" を読む. 行の残りは読み飛ばす
+// 改行で区切った塊を num_threads 本のスレッドで読む (0 以下なら hardware_concurrency)
 template<typename GraphType = G>
-typename GraphType::edge_list_type read_edge_list_tsv(std::istream &is = std::cin) {
+typename GraphType::edge_list_type read_edge_list_tsv(const char *data, std::size_t size, int num_threads = 0) {
   using E = typename GraphType::E;
+  using edge_list_type = typename GraphType::edge_list_type;
+  static constexpr std::size_t kMinChunkSize = 1 << 20;
 
-  typename GraphType::edge_list_type es;
-  std::string line;
-  int line_no = 1; //1-origin
-  while (std::getline(is, line)) {
-    std::istringstream iss(line);
-    V v;
-    E e;
-    CHECK_MSG(iss >> v >> e, ("at line " + to_string(line_no) + ": \"" + line + "\"").c_str());
-    es.emplace_back(v, e);
-    line_no++;
+  num_threads = resolve_num_threads(num_threads);
+  const int num_chunks = int(std::min<std::size_t>(std::size_t(num_threads) * 4, size / kMinChunkSize + 1));
+  // 塊の境界は行頭に揃える
+  std::vector<std::size_t> bounds(num_chunks + 1, size);
+  bounds[0] = 0;
+  for (int i = 1; i < num_chunks; i++) {
+    std::size_t b = std::max(bounds[i - 1], size / num_chunks * i);
+    const void *nl = b < size ? memchr(data + b, '\n', size - b) : nullptr;
+    bounds[i] = nl == nullptr ? size : (static_cast<const char*>(nl) - data) + 1;
+  }
+
+  struct chunk_result {
+    edge_list_type es;
+    std::size_t num_lines = 0;
+    bool failed = false;
+    std::string failed_line;
+  };
+  std::vector<chunk_result> results(num_chunks);
+  parallel_for(num_chunks, num_threads, [&](int i, int) {
+    chunk_result &r = results[i];
+    const char *p = data + bounds[i], *end = data + bounds[i + 1];
+    while (p < end) {
+      const void *nl = memchr(p, '\n', end - p);
+      const char *line_end = nl == nullptr ? end : static_cast<const char*>(nl);
+      const char *q = p;
+      V v;
+      E e;
+      r.num_lines++;
+      if (!io_internal::parse_tsv_value(q, line_end, &v) || !io_internal::parse_tsv_edge(q, line_end, &e)) {
+        r.failed = true;
+        r.failed_line.assign(p, line_end);
+        return;
+      }
+      r.es.emplace_back(v, e);
+      p = line_end + 1;
+    }
+  });
+
+  std::size_t line_no = 0, num_edges = 0;
+  for (auto &r : results) {
+    line_no += r.num_lines;
+    CHECK_MSG(!r.failed, ("at line " + to_string(line_no) + ": \"" + r.failed_line + "\"").c_str());
+    num_edges += r.es.size();
+  }
+
+  edge_list_type es;
+  es.reserve(num_edges);
+  for (auto &r : results) {
+    es.insert(es.end(), r.es.begin(), r.es.end());
+    edge_list_type().swap(r.es);
   }
   return es;
 }
 
 template<typename GraphType = G>
-typename GraphType::edge_list_type read_edge_list_tsv(const char *filename) {
+typename GraphType::edge_list_type read_edge_list_tsv(std::istream &is = std::cin, int num_threads = 0) {
+  std::string buf((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+  return read_edge_list_tsv<GraphType>(buf.data(), buf.size(), num_threads);
+}
+
+template<typename GraphType = G>
+typename GraphType::edge_list_type read_edge_list_tsv(const char *filename, int num_threads = 0) {
   if (strcmp(filename, "-") == 0) {
-    return read_edge_list_tsv<GraphType>(std::cin);
-  } else {
+    return read_edge_list_tsv<GraphType>(std::cin, num_threads);
+  } else if (!is_regular_file(filename)) {
+    // パイプ等は mmap できないので、読み込んでから解析する
     std::ifstream ifs(filename);
-    ifs.sync_with_stdio(false);
     CHECK_PERROR(ifs);
-    return read_edge_list_tsv<GraphType>(ifs);
+    return read_edge_list_tsv<GraphType>(ifs, num_threads);
+  } else {
+    mapped_file file(filename);
+    file.advise_sequential();
+    return read_edge_list_tsv<GraphType>(file.data(), file.size(), num_threads);
   }
 }
 
@@ -145,8 +276,9 @@ template<typename EdgeType,
   write_binary(os, e);
 }
 
+// 0.01 形式. 頂点毎に次数と辺を並べる
 template<typename GraphType>
-void write_graph_binary(const GraphType &g, std::ostream &os = std::cout) {
+void write_graph_binary_v1(const GraphType &g, std::ostream &os = std::cout) {
   //header
   os << kMagic << kEndLine << kVersion << kEndLine << graph_binary_format<GraphType>() << kEndLine;
 
@@ -162,14 +294,60 @@ void write_graph_binary(const GraphType &g, std::ostream &os = std::cout) {
   os.flush();
 }
 
+namespace io_internal {
+inline void write_binary_padding(std::ostream &os, std::size_t written) {
+  static const char zeros[8] = {};
+  os.write(zeros, (8 - written % 8) % 8);
+}
+
+inline std::size_t graph_binary_header_size(const std::string &version, const std::string &format) {
+  return kMagic.size() + version.size() + format.size() + 3;
+}
+}  // namespace io_internal
+
+// 0.02 形式. mmap してそのまま使えるように、CSR の配列を 8 byte 境界に揃えて並べる
+//   header (3行), 8 byte 境界まで 0 埋め
+//   uint64 num_vertices, uint64 num_edges, uint64 flags
+//   uint64 offsets[num_vertices + 1], E edges[num_edges], 8 byte 境界まで 0 埋め
+//   flags に kGraphBinaryBackward があれば、続けて逆向きの offsets, edges
+template<typename GraphType>
+void write_graph_binary(const GraphType &g, std::ostream &os = std::cout, bool with_backward = true) {
+  using E = typename GraphType::E;
+  static_assert(sizeof(std::size_t) == sizeof(uint64_t), "offsets are written as uint64");
+  static_assert(alignof(E) <= 8, "edges must be 8 byte aligned at most");
+
+  //header
+  const std::string format = graph_binary_format<GraphType>();
+  os << kMagic << kEndLine << kVersionCSR << kEndLine << format << kEndLine;
+  io_internal::write_binary_padding(os, io_internal::graph_binary_header_size(kVersionCSR, format));
+
+  //body
+  const uint64_t num_vertices = g.num_vertices(), num_edges = g.num_edges();
+  write_binary(os, num_vertices);
+  write_binary(os, num_edges);
+  write_binary(os, with_backward ? kGraphBinaryBackward : uint64_t(0));
+  for (D d : directions()) {
+    if (d == kBwd && !with_backward) break;
+    if (num_vertices == 0) {
+      write_binary(os, uint64_t(0));
+    } else {
+      os.write(reinterpret_cast<const char*>(g.csr_offsets(d)), sizeof(uint64_t) * (num_vertices + 1));
+      os.write(reinterpret_cast<const char*>(g.csr_edges(d)), sizeof(E) * num_edges);
+    }
+    io_internal::write_binary_padding(os, sizeof(E) * num_edges);
+  }
+  os.flush();
+  CHECK_PERROR(os);
+}
+
 template<typename GraphType = G>
-void write_graph_binary(const GraphType &g, const char *filename) {
+void write_graph_binary(const GraphType &g, const char *filename, bool with_backward = true) {
   if (strcmp(filename, "-") == 0) {
-    write_graph_binary(g, std::cout);
+    write_graph_binary(g, std::cout, with_backward);
   } else {
-    std::ofstream ofs(filename);
+    std::ofstream ofs(filename, std::ios_base::out | std::ios_base::binary);
     CHECK_PERROR(ofs);
-    write_graph_binary(g, ofs);
+    write_graph_binary(g, ofs, with_backward);
   }
 }
 
@@ -180,8 +358,12 @@ template<typename EdgeType,
   read_binary(is, dst, edge_count);
 }
 
+// 0.01, 0.02 のどちらも読める
 template<typename GraphType = G>
 GraphType read_graph_binary(std::istream &is = std::cin) {
+  using E = typename GraphType::E;
+  using storage_type = typename GraphType::storage_type;
+
   //header
   std::string magic, version, format;
   std::getline(is, magic, kEndLine);
@@ -189,38 +371,111 @@ GraphType read_graph_binary(std::istream &is = std::cin) {
   std::getline(is, format, kEndLine);
 
   CHECK_MSG(magic == kMagic, "Invalid file magic.");
-  CHECK_MSG(version == kVersion, "Invalid file version.");
+  CHECK_MSG(version == kVersion || version == kVersionCSR, "Invalid file version.");
   CHECK_MSG(format == graph_binary_format<GraphType>(), "Invalid file format.");
 
-  //body
-  typename GraphType::V num_vertices;
-  std::size_t num_edges;
-  read_binary(is, &num_vertices);
-  read_binary(is, &num_edges);
+  std::unique_ptr<storage_type> storage(new storage_type());
+  auto &offsets = storage->offsets_vector[kFwd];
+  auto &edges = storage->edges_vector[kFwd];
+  V num_vs;
 
-  std::vector<std::vector<typename GraphType::E>> edges(num_vertices);
+  if (version == kVersion) {
+    //body
+    typename GraphType::V num_vertices;
+    std::size_t num_edges;
+    read_binary(is, &num_vertices);
+    read_binary(is, &num_edges);
+    num_vs = num_vertices;
+
+    offsets.assign(num_vertices + 1, 0);
+    edges.resize(num_edges);
+    for (V v = 0; v < num_vertices; v++) {
+      std::size_t degree;
+      read_binary(is, &degree);
+      offsets[v + 1] = offsets[v] + degree;
+      CHECK_MSG(offsets[v + 1] <= num_edges, "Invalid number of edges.");
+      read_edge_binary<E>(is, edges.data() + offsets[v], degree);
+    }
+  } else {
+    char pad[8];
+    const std::size_t header_size = io_internal::graph_binary_header_size(version, format);
+    read_binary(is, pad, (8 - header_size % 8) % 8);
+    uint64_t num_vertices, num_edges, flags;
+    read_binary(is, &num_vertices);
+    read_binary(is, &num_edges);
+    read_binary(is, &flags);
+    num_vs = V(num_vertices);
 
-  for (V v = 0; v < num_vertices; v++) {
-    std::size_t degree;
-    read_binary(is, &degree);
-    edges[v].resize(degree);
-    read_edge_binary<typename GraphType::E>(is, edges[v].data(), degree);
+    for (D d : directions()) {
+      if (d == kBwd && !(flags & kGraphBinaryBackward)) break;
+      storage->offsets_vector[d].resize(num_vertices + 1);
+      storage->edges_vector[d].resize(num_edges);
+      read_binary(is, storage->offsets_vector[d].data(), num_vertices + 1);
+      read_edge_binary<E>(is, storage->edges_vector[d].data(), num_edges);
+      read_binary(is, pad, (8 - sizeof(E) * num_edges % 8) % 8);
+      storage->offsets[d] = storage->offsets_vector[d].data();
+      storage->edges[d] = storage->edges_vector[d].data();
+    }
   }
+  storage->offsets[kFwd] = offsets.data();
+  storage->edges[kFwd] = edges.data();
 
   GraphType deserialized_graph;
-  deserialized_graph.assign(std::move(edges));
+  deserialized_graph.assign(std::move(storage), num_vs);
   return deserialized_graph;
 }
 
+// 0.02 形式なら mmap して、配列をコピーせずにそのまま使う
 template<typename GraphType = G>
 GraphType read_graph_binary(const char *filename) {
+  using E = typename GraphType::E;
+  using storage_type = typename GraphType::storage_type;
+
   if (strcmp(filename, "-") == 0) {
     return read_graph_binary<GraphType>(std::cin);
-  } else {
-    std::ifstream ifs(filename);
-    ifs.sync_with_stdio(false);
+  }
+
+  std::unique_ptr<mapped_file> file(new mapped_file(filename));
+  const char *p = file->data(), *end = p + file->size();
+  std::string lines[3];
+  for (auto &line : lines) {
+    const void *nl = p == nullptr ? nullptr : memchr(p, kEndLine, end - p);
+    if (nl == nullptr) break;
+    line.assign(p, static_cast<const char*>(nl));
+    p = static_cast<const char*>(nl) + 1;
+  }
+  if (lines[1] != kVersionCSR) {
+    file.reset();
+    std::ifstream ifs(filename, std::ios_base::in | std::ios_base::binary);
     CHECK_PERROR(ifs);
     return read_graph_binary<GraphType>(ifs);
   }
+
+  CHECK_MSG(lines[0] == kMagic, "Invalid file magic.");
+  CHECK_MSG(lines[2] == graph_binary_format<GraphType>(), "Invalid file format.");
+
+  std::size_t offset = io_internal::graph_binary_header_size(lines[1], lines[2]);
+  offset += (8 - offset % 8) % 8;
+  auto next = [&](std::size_t len) {
+    CHECK_MSG(offset + len <= file->size(), "Truncated graph file.");
+    const char *a = file->data() + offset;
+    offset += len + (8 - len % 8) % 8;
+    return a;
+  };
+  const uint64_t *counts = reinterpret_cast<const uint64_t*>(next(sizeof(uint64_t) * 3));
+  const uint64_t num_vertices = counts[0], num_edges = counts[1], flags = counts[2];
+
+  std::unique_ptr<storage_type> storage(new storage_type());
+  for (D d : directions()) {
+    if (d == kBwd && !(flags & kGraphBinaryBackward)) break;
+    storage->offsets[d] = reinterpret_cast<const std::size_t*>(next(sizeof(uint64_t) * (num_vertices + 1)));
+    storage->edges[d] = reinterpret_cast<const E*>(next(sizeof(E) * num_edges));
+    CHECK_MSG(storage->offsets[d][num_vertices] == num_edges, "Invalid number of edges.");
+  }
+  storage->file = std::move(file);
+
+  GraphType deserialized_graph;
+  deserialized_graph.assign(std::move(storage), V(num_vertices));
+  return deserialized_graph;
 }
 }  // namespace agl
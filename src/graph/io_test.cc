@@ -1,3 +1,5 @@
+#include <unistd.h>
+#include <thread>
 #include "graph.h"
 #include "gtest/gtest.h"
 using namespace std;
@@ -53,6 +55,54 @@ TYPED_TEST(graph_io_test, binary) {
   is_graph_eq(g1, g2);
 }
 
+TYPED_TEST(graph_io_test, binary_v1) {
+  using GraphType = TypeParam;
+  GraphType g1(add_random_weight<GraphType>(generate_erdos_renyi(100, 2)));
+
+  std::ostringstream oss (std::stringstream::binary);
+  write_graph_binary_v1(g1, oss);
+  ASSERT_EQ(0u, oss.str().find("AGL_BINARY\n0.01\n"));
+
+  std::istringstream iss(oss.str(), std::stringstream::binary);
+  auto g2 = read_graph_binary<GraphType>(iss);
+
+  is_graph_eq(g1, g2);
+}
+
+TYPED_TEST(graph_io_test, binary_mmap) {
+  using GraphType = TypeParam;
+  GraphType g1(add_random_weight<GraphType>(generate_erdos_renyi(100, 2)));
+
+  char path[] = "/tmp/graph_io_test_XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_NE(-1, fd);
+  close(fd);
+
+  for (bool with_backward : {true, false}) {
+    write_graph_binary(g1, path, with_backward);
+    auto g2 = read_graph_binary<GraphType>(path);
+    is_graph_eq(g1, g2);
+    for (auto v : g1.vertices()) {
+      ASSERT_EQ(g1.degree(v, kBwd), g2.degree(v, kBwd));
+      for (size_t i = 0; i < g1.degree(v, kBwd); i++) {
+        ASSERT_EQ(to(g1.edge(v, i, kBwd)), to(g2.edge(v, i, kBwd)));
+      }
+    }
+  }
+
+  // 0.01 形式のファイルも読める
+  {
+    std::ofstream ofs(path, std::ios_base::out | std::ios_base::binary);
+    write_graph_binary_v1(g1, ofs);
+  }
+  is_graph_eq(g1, read_graph_binary<GraphType>(path));
+
+  // 頂点数 0
+  write_graph_binary(GraphType(), path);
+  ASSERT_EQ(0, read_graph_binary<GraphType>(path).num_vertices());
+  unlink(path);
+}
+
 TYPED_TEST(graph_io_test, tsv) {
   using GraphType = TypeParam;
   GraphType g1(add_random_weight<GraphType>(generate_erdos_renyi(100, 2)));
@@ -77,6 +127,60 @@ TEST(graph_io_test, tsv_failed) {
   ASSERT_DEATH(read_graph_tsv<G>(iss), "CHECK Failed .* at line 2: \"3\".*");
 }
 
+TYPED_TEST(graph_io_test, tsv_parallel) {
+  using GraphType = TypeParam;
+  // 塊が複数になるように 1MB 以上にする
+  GraphType g1(add_random_weight<GraphType>(generate_erdos_renyi(50000, 4)));
+
+  std::ostringstream oss (std::stringstream::binary);
+  oss << std::setprecision(12);
+  write_graph_tsv(g1, oss);
+  const std::string s = oss.str();
+  ASSERT_GT(s.size(), 1u << 20);
+
+  for (int num_threads : {1, 4}) {
+    auto g2 = GraphType(read_edge_list_tsv<GraphType>(s.data(), s.size(), num_threads));
+    is_graph_eq(g1, g2);
+  }
+}
+
+TEST(graph_io_test, tsv_failed_parallel) {
+  string s;
+  for (int i = 0; i < 300000; i++) s += "12345 67890\n";
+  s += "-3 x\n";
+  s += "1 2";
+  ASSERT_DEATH(read_edge_list_tsv<G>(s.data(), s.size(), 4), "CHECK Failed .* at line 300001: \"-3 x\".*");
+
+  auto es = read_edge_list_tsv<G>(s.data(), s.size() - 9, 4);
+  ASSERT_EQ(300000u, es.size());
+  ASSERT_EQ(make_pair(12345, 67890), es.back());
+}
+
+TEST(graph_io_test, tsv_pipe) {
+  // パイプは mmap できないので、読み込んでから解析する
+  G g1(generate_erdos_renyi(1000, 4));
+  std::ostringstream oss;
+  write_graph_tsv(g1, oss);
+  const std::string s = oss.str();
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  std::thread writer([&s, &fds]() {
+    for (std::size_t i = 0; i < s.size();) {
+      const ssize_t k = write(fds[1], s.data() + i, s.size() - i);
+      if (k <= 0) break;
+      i += k;
+    }
+    close(fds[1]);
+  });
+  const std::string path = "/dev/fd/" + to_string(fds[0]);
+  ASSERT_FALSE(is_regular_file(path.c_str()));
+  G g2(read_edge_list_tsv<G>(path.c_str(), 4));
+  writer.join();
+  close(fds[0]);
+  is_graph_eq(g1, g2);
+}
+
 } // namespace
 
 